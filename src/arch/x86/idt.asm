@@ -1,6 +1,7 @@
 BITS 32
 
 extern syscall_dispatch
+extern tss
 
 extern isr_0_handler
 extern isr_1_handler
@@ -14,6 +15,8 @@ extern isr_14_handler
 extern irq0_handler
 extern irq1_handler
 extern irq12_handler
+extern irq14_handler
+extern irq15_handler
 
 extern isr_default_handler
 extern isr_error_handler
@@ -21,8 +24,11 @@ extern isr_error_handler
 global asm_do_nop
 global asm_do_sti
 global asm_do_cli
+global asm_irq_save
+global asm_irq_restore
 
 global asm_syscall
+global asm_sysenter
 global asm_isr0_wrapper
 global asm_isr1_wrapper
 global asm_isr2_wrapper
@@ -34,6 +40,8 @@ global asm_isr14_wrapper
 global asm_irq0_timer
 global asm_irq1_keyboard
 global asm_irq12_mouse
+global asm_irq14_ata
+global asm_irq15_ata
 global asm_idt_loader
 
 global asm_interrupt_default
@@ -51,6 +59,21 @@ asm_do_cli:
     cli
     ret
 
+; uint32_t asm_irq_save(void)
+; returns EFLAGS and disables interrupts, for critical sections that may be entered with IF = 0 (syscalls)
+asm_irq_save:
+    pushfd
+    pop eax
+    cli
+    ret
+
+; void asm_irq_restore(const uint32_t eflags)
+; restores IF (and the rest of EFLAGS) as returned by asm_irq_save
+asm_irq_restore:
+    push dword [esp + 4]
+    popfd
+    ret
+
 asm_idt_loader:
     push dword ebp        ; Save old base pointer
     mov ebp, esp          ; Use the current stack pointer 'asm_idt_loader' as new base pointer for the caller frame (return address +4, argument 1 = +8, argument n = +4)
@@ -68,6 +91,30 @@ asm_syscall:
     popad
     iretd
 
+; SYSENTER entry (MSR_SYSENTER_EIP), libc calls it with
+;   EAX = syscall id, EBX/ECX/EDX = arguments, ESI = user return EIP, EBP = user ESP
+; The CPU pushes nothing, so an iret frame is built by hand: task_save() and a task
+; switch inside the syscall see the same interrupt_frame_t as for int 0x80.
+asm_sysenter:
+    mov esp, [tss + 4]      ; SYSENTER_ESP is a scratch stack, switch to the task's kernel stack (TSS.esp0)
+    push dword 0x23         ; SS  (GDT_USER_DATA_SEGMENT | 3)
+    push ebp                ; ESP
+    pushfd                  ; EFLAGS, SYSENTER cleared IF, the user had it set
+    or dword [esp], 0x200
+    push dword 0x1B         ; CS  (GDT_USER_CODE_SEGMENT | 3)
+    push esi                ; EIP
+    pushad
+    push dword esp
+    push dword eax
+    call syscall_dispatch
+    add esp, 8
+    popad
+    mov edx, [esp]          ; SYSEXIT: EIP = EDX, ESP = ECX (libc treats both as clobbered)
+    mov ecx, [esp + 12]
+    add esp, 20
+    sti                     ; Takes effect after SYSEXIT, no interrupt on the kernel stack in between
+    sysexit
+
 asm_isr0_wrapper:
     cli
     pushad        
@@ -152,16 +199,22 @@ asm_isr13_wrapper:
 asm_isr14_wrapper:
     cli                             ; Disable interrupts to prevent reentrancy
     pushad                          ; Save general-purpose registers: EAX, ECX, EDX, EBX, ESP (as placeholder), EBP, ESI, EDI
-    push dword esp                  ; Pass current stack pointer as interrupt_frame_t* to handler
-    mov eax, [esp + 36]             ; Retrieve CPU-pushed error code from stack (after pushad + push esp)
-    push dword eax                  ; Push error code as second argument
     mov eax, cr2                    ; Read faulting virtual address from CR2
+    mov edx, [esp + 32]             ; Retrieve CPU-pushed error code from stack (after pushad)
+    mov ecx, 8                      ; Slide the pushad block over the error code, so interrupt_frame_t lines up with EIP/CS/EFLAGS
+.slide:
+    mov ebx, [esp + ecx * 4 - 4]
+    mov [esp + ecx * 4], ebx
+    loop .slide
+    add esp, 4
+    push dword esp                  ; Pass current stack pointer as interrupt_frame_t* to handler
+    push dword edx                  ; Push error code as second argument
     push dword eax                  ; Push faulting address as first argument
     ; void isr_14_handler(uint32_t fault_addr, uint32_t error_code, interrupt_frame_t* frame)
+    ; the handler may redirect frame->eip (uaccess fixup)
     call isr_14_handler             
     add esp, 12                     ; Clean up pushed arguments: fault_addr, error_code, frame pointer
     popad                           ; Restore general-purpose registers
-    add esp, 4                      ; Discard CPU-pushed error code (which wasn’t included in pushad)
     sti                             ; Re-enable interrupts
     iretd                           ; Return from interrupt (restores CS, EIP, EFLAGS, [optional ESP, SS])            
     
@@ -193,6 +246,22 @@ asm_irq12_mouse:
     sti                             ; Enable interrupts
     iretd                           ; Return from interrupt
 
+asm_irq14_ata:
+    cli                             ; Disable interrupts to prevent nested interrupts
+    pushad
+    call irq14_handler              ; Ends the block or command, wakes the waiting task
+    popad                           ; Restore the saved state
+    sti                             ; Enable interrupts
+    iretd                           ; Return from interrupt
+
+asm_irq15_ata:
+    cli                             ; Disable interrupts to prevent nested interrupts
+    pushad
+    call irq15_handler
+    popad                           ; Restore the saved state
+    sti                             ; Enable interrupts
+    iretd                           ; Return from interrupt
+
 asm_interrupt_default:
     cli
     pushad                          ; Save general-purpose registers
@@ -8,17 +8,21 @@
 #include <stdint.h>
 
 #include "ata.h"
+#include "clock.h"
 #include "fifo.h"
 #include "icarius.h"
 #include "idt.h"
 #include "io.h"
 #include "kernel.h"
 #include "keyboard.h"
+#include "kwork.h"
+#include "mmap.h"
 #include "mouse.h"
 #include "ps2.h"
 #include "rr.h"
 #include "scheduler.h"
 #include "string.h"
+#include "uaccess.h"
 #include "wq.h"
 
 /* EXTERNAL API */
@@ -57,12 +61,16 @@ void isr_14_handler(const uint32_t fault_addr, const uint32_t error_code, interr
 void irq0_handler(interrupt_frame_t* frame);
 void irq1_handler(interrupt_frame_t* frame);
 void irq12_handler(void);
+void irq14_handler(void);
+void irq15_handler(void);
 void isr_default_handler(interrupt_frame_t* frame);
 
 /* INTERNAL API */
 static void _pic1_send_eoi(void);
 static void _pic2_send_eoi(void);
 static void _init_isr(void);
+static void _kbd_bottom_half(const uint32_t scancode);
+static void _mouse_bottom_half(const uint32_t data);
 
 /*
  * Interrupt Vector Table (IVT) Reference
@@ -444,6 +452,16 @@ void isr_13_handler(const uint32_t error_code, interrupt_frame_t* frame)
 
 void isr_14_handler(const uint32_t fault_addr, const uint32_t error_code, interrupt_frame_t* frame)
 {
+	const task_t* curr = task_get_curr();
+
+	// First touch of an mmap page, from user space or from a syscall copying to/from it
+	if (fault_addr < KERNEL_VIRTUAL_START && curr && mmap_fault(curr->parent, fault_addr, error_code)) {
+		return;
+	};
+	// A syscall touching a bad user pointer gets -EFAULT, not a panic
+	if ((frame->cs & 0x3) == 0 && uaccess_fixup(frame, fault_addr)) {
+		return;
+	};
 	kprintf("\n----------------------------------------------------\n");
 	kprintf("[ERROR] Page Fault (#PF) Exception\n");
 	kprintf("----------------------------------------------------\n");
@@ -529,22 +547,26 @@ void isr_14_handler(const uint32_t fault_addr, const uint32_t error_code, interr
 void irq0_handler(interrupt_frame_t* frame)
 {
 	timer.ticks++;
+	clock_tick();
+	wq_tick(timer.ticks);
+	ata_tick(&ata_dev, timer.ticks);
+	// Flush the cpu time of the interrupted task, a task that is never preempted still shows up in its counters
+	task_stat_tick(task_get_curr());
 	// An interrupt handler must always send its own EOI before relinquishing control flow (e.g., through a task switch)
 	_pic1_send_eoi();
 	scheduler_schedule(frame);
 	return;
 };
 
+/**
+ * Top halves only take the byte off the controller, queue it and acknowledge the PIC.
+ * The controller raises IRQ1/IRQ12 only with a full output buffer, one status read is
+ * enough, no ps2_wait spinning with interrupts off. Everything else happens in kworker.
+ */
 void irq1_handler(interrupt_frame_t* frame)
 {
-	if (ps2_wait(PS2_BUFFER_OUTPUT) == 0) {
-		const uint8_t scancode = inb(PS2_DATA_PORT);
-		process_t* fg_proc = tty_get_foreground();
-
-		if (fg_proc && fg_proc->keyboard_buffer) {
-			fifo_enqueue(fg_proc->keyboard_buffer, scancode);
-		};
-		wq_wakeup(WAIT_KEYBOARD);
+	if (inb(PS2_STATUS_COMMAND_PORT) & PS2_BUFFER_OUTPUT) {
+		kwork_queue(_kbd_bottom_half, inb(PS2_DATA_PORT));
 	};
 	_pic1_send_eoi();
 	return;
@@ -552,14 +574,52 @@ void irq1_handler(interrupt_frame_t* frame)
 
 void irq12_handler(void)
 {
-	if (ps2_wait(PS2_BUFFER_OUTPUT) == 0) {
-		const uint8_t data = inb(PS2_DATA_PORT);
-		fifo_enqueue(&fifo_mouse, data);
+	if (inb(PS2_STATUS_COMMAND_PORT) & PS2_BUFFER_OUTPUT) {
+		kwork_queue(_mouse_bottom_half, inb(PS2_DATA_PORT));
 	};
 	_pic2_send_eoi();
 	return;
 };
 
+// IRQ14 is cheap: one status read per block or command, the waiting task does the copying
+void irq14_handler(void)
+{
+	ata_irq(&ata_dev);
+	_pic2_send_eoi();
+	return;
+};
+
+// Nothing is attached to the secondary channel, acknowledge the drive and both PICs so IRQ15 can't stay in service
+void irq15_handler(void)
+{
+	inb(ATA_SECONDARY_STATUS_REGISTER);
+	_pic2_send_eoi();
+	return;
+};
+
+static void _kbd_bottom_half(const uint32_t scancode)
+{
+	// The keyboard FIFO and the wait/ready queues are shared with syscalls and the scheduler
+	asm_do_cli();
+	process_t* fg_proc = tty_get_foreground();
+
+	if (fg_proc && fg_proc->keyboard_buffer) {
+		fifo_enqueue(fg_proc->keyboard_buffer, (uint8_t)scancode);
+	};
+	wq_wakeup(WAIT_KEYBOARD);
+	wq_wakeup(WAIT_POLL);
+	asm_do_sti();
+	return;
+};
+
+static void _mouse_bottom_half(const uint32_t data)
+{
+	asm_do_cli();
+	fifo_enqueue(&fifo_mouse, (uint8_t)data);
+	asm_do_sti();
+	return;
+};
+
 void isr_default_handler(interrupt_frame_t* frame)
 {
 	_pic1_send_eoi();
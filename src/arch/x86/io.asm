@@ -3,10 +3,12 @@ BITS 32
 global outb
 global outw
 global outl
+global outsw
 
 global inb
 global inw
 global inl
+global insw
 
 ;=============================================================================
 ; Reads a byte from a specified I/O port
@@ -104,5 +106,49 @@ outl:
 
     out dx, eax             ; Send the value in EAX (32 bit) to the specified I/O port in EDX
 
+    pop ebp
+    ret
+
+;=============================================================================
+; Reads count words from a specified I/O port into memory (rep insw)
+; @param [ebp+8]: The address of the I/O port (16 bits)
+; @param [ebp+12]: Destination buffer
+; @param [ebp+16]: Number of words
+;=============================================================================
+insw:
+    push ebp
+    mov ebp, esp
+    push edi                 ; EDI is callee-saved
+
+    mov edx, [ebp+8]         ; Copy the 16 bit address to receiving data from (first argument +8) into EDX
+    mov edi, [ebp+12]        ; Destination (second argument +12)
+    mov ecx, [ebp+16]        ; Word count (third argument +16)
+
+    cld
+    rep insw                 ; One instruction for the whole block, no loop overhead per word
+
+    pop edi
+    pop ebp
+    ret
+
+;=============================================================================
+; Sends count words from memory to a specified I/O port (rep outsw)
+; @param [ebp+8]: The address of the I/O port (16 bits)
+; @param [ebp+12]: Source buffer
+; @param [ebp+16]: Number of words
+;=============================================================================
+outsw:
+    push ebp
+    mov ebp, esp
+    push esi                 ; ESI is callee-saved
+
+    mov edx, [ebp+8]         ; Copy the 16 bit address to send (first argument +8) into EDX
+    mov esi, [ebp+12]        ; Source (second argument +12)
+    mov ecx, [ebp+16]        ; Word count (third argument +16)
+
+    cld
+    rep outsw                ; One instruction for the whole block, no loop overhead per word
+
+    pop esi
     pop ebp
     ret
\ No newline at end of file
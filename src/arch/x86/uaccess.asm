@@ -0,0 +1,60 @@
+BITS 32
+
+global asm_copy_user
+global asm_strncpy_user
+global asm_uaccess_start
+global asm_uaccess_end
+global asm_uaccess_fixup
+
+; Every load/store on a user pointer lives between asm_uaccess_start and asm_uaccess_end.
+; A ring 0 #PF inside that range is not a kernel bug, isr_14_handler resumes at asm_uaccess_fixup
+; which returns -EFAULT. Both routines keep the same stack layout (esi, edi pushed) for the fixup.
+
+asm_uaccess_start:
+
+; int32_t asm_copy_user(void* dst, const void* src, const uint32_t n)
+; returns 0, or -EFAULT if a user page faulted
+asm_copy_user:
+    push esi
+    push edi
+    mov edi, [esp + 12]   ; dst
+    mov esi, [esp + 16]   ; src
+    mov ecx, [esp + 20]   ; n
+    cld
+    rep movsb
+    xor eax, eax
+    pop edi
+    pop esi
+    ret
+
+; int32_t asm_strncpy_user(char* dst, const char* src, const uint32_t n)
+; copies up to and including the 0 terminator, at most n bytes
+; returns the string length, n if there was no terminator within n bytes, or -EFAULT
+asm_strncpy_user:
+    push esi
+    push edi
+    mov edi, [esp + 12]   ; dst
+    mov esi, [esp + 16]   ; src
+    mov ecx, [esp + 20]   ; n
+    xor eax, eax
+.next:
+    cmp eax, ecx
+    je .done
+    mov dl, [esi + eax]
+    mov [edi + eax], dl
+    test dl, dl
+    jz .done
+    inc eax
+    jmp .next
+.done:
+    pop edi
+    pop esi
+    ret
+
+asm_uaccess_end:
+
+asm_uaccess_fixup:
+    mov eax, -14          ; -EFAULT
+    pop edi
+    pop esi
+    ret
\ No newline at end of file
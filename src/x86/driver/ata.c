@@ -6,12 +6,23 @@
  */
 
 #include "ata.h"
+#include "idt.h"
 #include "io.h"
 #include "kernel.h"
+#include "page.h"
+#include "pci.h"
+#include "pfa.h"
 #include "string.h"
+#include "timer.h"
+#include "wq.h"
 
 #define ATA_DEBUG_DELAY 0
 
+/* EXTERNAL API */
+extern timer_t timer;
+extern void asm_irq14_ata(void);
+extern void asm_irq15_ata(void);
+
 ata_t ata_dev = {
     .dev = {"A"},
     .sector_size = 0x0,
@@ -19,6 +30,7 @@ ata_t ata_dev = {
     .buffer = {0},
     .fs = 0x0,
     .features = 0x0,
+    .busy = false,
 };
 
 /* PUBLIC API */
@@ -26,10 +38,18 @@ void ata_init(ata_t* self);
 void ata_mount_fs(ata_t* self);
 ata_t* ata_get(const char dev[2]);
 int32_t ata_read(ata_t* self, const size_t start_block, const size_t n_blocks);
+int32_t ata_read_into(ata_t* self, const size_t lba, const size_t count, uint8_t* buffer);
 int32_t ata_write(ata_t* self, const size_t start_block, const size_t n_blocks, const uint8_t* buffer);
+int32_t ata_flush(ata_t* self);
+void ata_set_mode(ata_t* self, const uint16_t bm_base, const uint8_t multiple, const bool word_io);
+coro_step_t ata_read_coro(coro_t* self);
+void ata_irq(ata_t* self);
+void ata_tick(ata_t* self, const uint64_t now);
 
 /* INTERNAL API */
 static void _load_into_buffer(uint16_t* buffer, const size_t size);
+static void _load_words(uint16_t* buffer, const size_t size);
+static void _store_from_buffer(const uint16_t* buffer, const size_t size);
 static uint8_t _get_drive_select_code(const uint8_t type);
 static void _send_identify_req(const uint8_t target_drive);
 static void _dump_ata(ata_t* self, const int32_t delay);
@@ -37,16 +57,49 @@ static void _detect_pio_mode(ata_t* self, uint16_t* buffer);
 static void _check_bsy(uint8_t* status);
 static void _check_drq_err(uint8_t* status);
 static int32_t _init_identify(ata_t* self, const uint8_t type);
-static int32_t _read_pio48(ata_t* self, const uint64_t lba, const uint16_t sectors);
-static int32_t _read_pio28(ata_t* self, const uint32_t lba, const uint8_t sectors);
+static int32_t _read_pio48(ata_t* self, const uint64_t lba, const size_t sectors, uint8_t* buffer);
+static int32_t _read_pio28(ata_t* self, const uint32_t lba, const size_t sectors, uint8_t* buffer);
 static uint64_t _calculate_total_sectors_pio48(uint16_t* buffer);
 static uint64_t _calculate_total_sectors_pio28(uint16_t* buffer);
 static inline uint64_t _calculate_capacity(const uint64_t total_sectors, const uint16_t sector_size);
 static void set_pio_features(ata_t* self, const bool is_pio48);
-static int32_t _write_pio28(ata_t* self, const uint32_t lba, const uint8_t sectors, const uint8_t* buffer);
-static int32_t _write_pio48(ata_t* self, const uint64_t lba, const uint16_t sectors, const uint8_t* buffer);
+static int32_t _write_pio28(ata_t* self, const uint32_t lba, const size_t sectors, const uint8_t* buffer);
+static int32_t _write_pio48(ata_t* self, const uint64_t lba, const size_t sectors, const uint8_t* buffer);
+static void _send_read_pio48(const uint64_t lba, const uint16_t sectors, const uint8_t cmd);
+static void _send_read_pio28(const uint32_t lba, const uint8_t sectors, const uint8_t cmd);
+static bool _try_lock(ata_t* self);
+static void _lock(ata_t* self);
+static void _unlock(ata_t* self);
+static void _init_dma(ata_t* self);
+static void _send_dma(const uint64_t lba, const uint16_t sectors, const bool is_lba48, const bool write);
+static int32_t _transfer_dma(ata_t* self, const uint64_t lba, const size_t sectors, const bool write);
+static int32_t _read_dma(ata_t* self, const uint64_t lba, const size_t sectors, uint8_t* buffer);
+static int32_t _write_dma(ata_t* self, const uint64_t lba, const size_t sectors, const uint8_t* buffer);
+static void _settle(void);
+static bool _irqs_enabled(void);
+static void _arm_irq(ata_t* self, coro_t* coro);
+static void _wake_owner(ata_t* self);
+static bool _poll_irq(ata_t* self);
+static int32_t _irq_result(ata_t* self);
+static int32_t _wait_irq(ata_t* self);
+static int32_t _wait_drq(ata_t* self);
+static void _reset(ata_t* self);
+static int32_t _read_pio_data(ata_t* self, const uint64_t lba, const size_t sectors, uint8_t* buffer);
+static size_t _max_sectors(const ata_t* self);
+static int32_t _write_pio_data(ata_t* self, const uint64_t lba, const size_t sectors, const uint8_t* buffer);
+static int32_t _flush_cache(ata_t* self);
+static void _init_multiple(ata_t* self);
+static size_t _block_sectors(const ata_t* self);
 
+// size in words, rep insw moves the whole block in one instruction
 static void _load_into_buffer(uint16_t* buffer, const size_t size)
+{
+	insw(ATA_DATA_PORT, buffer, size);
+	return;
+};
+
+// size in words, one inw per word, only the baseline of test_ata_throughput (ata_t.word_io)
+static void _load_words(uint16_t* buffer, const size_t size)
 {
 	for (size_t i = 0; i < size; i++) {
 		buffer[i] = inw(ATA_DATA_PORT);
@@ -54,6 +107,12 @@ static void _load_into_buffer(uint16_t* buffer, const size_t size)
 	return;
 };
 
+static void _store_from_buffer(const uint16_t* buffer, const size_t size)
+{
+	outsw(ATA_DATA_PORT, buffer, size);
+	return;
+};
+
 static uint8_t _get_drive_select_code(const uint8_t type)
 {
 	switch (type) {
@@ -144,7 +203,8 @@ static void _detect_pio_mode(ata_t* self, uint16_t* buffer)
 
 static void _check_bsy(uint8_t* status)
 {
-	while (*status & ATA_STATUS_BSY) {
+	// Bounded, a missing or hung drive must not stop the boot
+	for (uint32_t spins = 0; (*status & ATA_STATUS_BSY) && spins < ATA_POLL_SPINS; spins++) {
 		*status = inb(ATA_STATUS_REGISTER);
 	};
 	return;
@@ -152,7 +212,7 @@ static void _check_bsy(uint8_t* status)
 
 static void _check_drq_err(uint8_t* status)
 {
-	while (!(*status & (ATA_STATUS_ERR | ATA_STATUS_DRQ))) {
+	for (uint32_t spins = 0; !(*status & (ATA_STATUS_ERR | ATA_STATUS_DRQ)) && spins < ATA_POLL_SPINS; spins++) {
 		*status = inb(ATA_STATUS_REGISTER);
 	};
 	return;
@@ -177,12 +237,18 @@ static int32_t _init_identify(ata_t* self, const uint8_t type)
 	};
 	_check_drq_err(&status);
 
-	if (status & ATA_STATUS_ERR) {
+	if ((status & ATA_STATUS_ERR) || !(status & ATA_STATUS_DRQ)) {
 		return -EIO;
 	};
 	uint16_t buffer[256] = {};
 	_load_into_buffer(buffer, self->sector_size / 2);
 	_detect_pio_mode(self, buffer);
+
+	if (buffer[49] & (1 << 8)) {
+		self->features |= (1 << 2); // Set bit 2 to indicate DMA support
+	};
+	// Largest READ/WRITE MULTIPLE block the drive supports, _init_multiple turns it on
+	self->multiple = buffer[47] & 0xFF;
 	_dump_ata(self, ATA_DEBUG_DELAY);
 	return 1;
 };
@@ -195,11 +261,24 @@ void ata_init(ata_t* self)
 	self->total_sectors = 0x0;
 	self->capacity = 0x0;
 	self->features = 0x0;
+	self->multiple = 0x0;
+	self->bm_base = 0x0;
+	self->irq_pending = false;
+	self->irq_coro = 0x0;
 	memset(self->buffer, 0x0, sizeof(self->buffer));
 
 	if (!_init_identify(self, ATA_DRIVE_MASTER)) {
 		panic("[CRITICAL] Failed to Identify ATA.\n");
 	};
+
+	if (self->features & (1 << 2)) {
+		_init_dma(self);
+	};
+	_init_multiple(self);
+	// nIEN clear: the drive raises INTRQ per data block and at the end of every command
+	outb(ATA_DEVICE_CONTROL_PORT, 0x0);
+	idt_set(ATA_IRQ_VECTOR, asm_irq14_ata, IDT_KERNEL_INT_GATE);
+	idt_set(ATA_SECONDARY_IRQ_VECTOR, asm_irq15_ata, IDT_KERNEL_INT_GATE);
 	return;
 };
 
@@ -209,10 +288,8 @@ void ata_mount_fs(ata_t* self)
 	return;
 };
 
-static int32_t _read_pio48(ata_t* self, const uint64_t lba, const uint16_t sectors)
+static void _send_read_pio48(const uint64_t lba, const uint16_t sectors, const uint8_t cmd)
 {
-	uint16_t* ptr_ata_buffer = (uint16_t*)self->buffer;
-
 	outb(ATA_CONTROL_PORT, 0x40);			    // Select master
 	outb(ATA_SECTOR_COUNT_PORT, (sectors >> 8) & 0xFF); // sectors high
 	outb(ATA_LBA_LOW_PORT, (lba >> 24) & 0xFF);	    // LBA4
@@ -222,51 +299,72 @@ static int32_t _read_pio48(ata_t* self, const uint64_t lba, const uint16_t secto
 	outb(ATA_LBA_LOW_PORT, lba & 0xFF);		    // LBA1
 	outb(ATA_LBA_MID_PORT, (lba >> 8) & 0xFF);	    // LBA2
 	outb(ATA_LBA_HIGH_PORT, (lba >> 16) & 0xFF);	    // LBA3
-	outb(ATA_STATUS_REGISTER, 0x24);
-
-	for (size_t i = 0; i < sectors; ++i) {
-		for (;;) {
-			const uint8_t status = inb(ATA_COMMAND_PORT);
-
-			if (status & ATA_STATUS_DRQ) {
-				break;
-			};
+	outb(ATA_COMMAND_PORT, cmd);			    // READ SECTORS EXT or READ MULTIPLE EXT
+	return;
+};
 
-			if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF)) {
-				kprintf("[CRITICAL] ATA Read Error on LBA %d\n", lba);
-				return -EIO;
-			};
-		};
-		_load_into_buffer(ptr_ata_buffer, self->sector_size / 2);
-	};
-	return 0;
+// sectors is at most 65536, the register value 0 stands for 65536
+static int32_t _read_pio48(ata_t* self, const uint64_t lba, const size_t sectors, uint8_t* buffer)
+{
+	_arm_irq(self, 0x0);
+	_send_read_pio48(lba, sectors & 0xFFFF, self->multiple ? ATA_CMD_READ_MULTIPLE_EXT : ATA_CMD_READ_SECTORS_EXT);
+	return _read_pio_data(self, lba, sectors, buffer);
 };
 
-static int32_t _read_pio28(ata_t* self, const uint32_t lba, const uint8_t sectors)
+static void _send_read_pio28(const uint32_t lba, const uint8_t sectors, const uint8_t cmd)
 {
-	uint16_t* ptr_ata_buffer = (uint16_t*)self->buffer;
 	outb(ATA_CONTROL_PORT, ATA_DRIVE_MASTER | ((lba >> 24) & 0x0F));
 	outb(ATA_PRIMARY_ERROR, 0x00);
 	outb(ATA_SECTOR_COUNT_PORT, sectors);
 	outb(ATA_LBA_LOW_PORT, lba & 0xFF);
 	outb(ATA_LBA_MID_PORT, (lba >> 8) & 0xFF);
 	outb(ATA_LBA_HIGH_PORT, (lba >> 16) & 0xFF);
-	outb(ATA_COMMAND_PORT, ATA_CMD_READ_SECTORS);
+	outb(ATA_COMMAND_PORT, cmd);
+	return;
+};
+
+// sectors is at most 256, the register value 0 stands for 256
+static int32_t _read_pio28(ata_t* self, const uint32_t lba, const size_t sectors, uint8_t* buffer)
+{
+	_arm_irq(self, 0x0);
+	_send_read_pio28(lba, sectors & 0xFF, self->multiple ? ATA_CMD_READ_MULTIPLE : ATA_CMD_READ_SECTORS);
+	return _read_pio_data(self, lba, sectors, buffer);
+};
+
+/**
+ * @brief Drains the sectors of a PIO read command into buffer, one IRQ14 per block.
+ *
+ * A block is one sector, or self->multiple sectors for READ MULTIPLE. The interrupt for the
+ * next block is armed before the current one is drained, the drive may raise it as soon as
+ * the last word left the data port.
+ */
+static int32_t _read_pio_data(ata_t* self, const uint64_t lba, const size_t sectors, uint8_t* buffer)
+{
+	const size_t block = _block_sectors(self);
 
-	for (size_t i = 0; i < sectors; ++i) {
-		for (;;) {
-			const uint8_t status = inb(ATA_COMMAND_PORT);
+	for (size_t i = 0; i < sectors; i += block) {
+		const size_t n = (sectors - i > block) ? block : sectors - i;
+		const int32_t status = _wait_irq(self);
 
-			if (status & ATA_STATUS_DRQ) {
-				break;
-			};
+		if (status < 0) {
+			return status;
+		};
 
-			if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF)) {
-				kprintf("[CRITICAL] ATA Read Error on LBA %u\n", lba);
-				return -EIO;
-			};
+		if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF) || !(status & ATA_STATUS_DRQ)) {
+			kprintf("[CRITICAL] ATA Read Error on LBA %d\n", (uint32_t)(lba + i));
+			return -EIO;
+		};
+
+		if (i + n < sectors) {
+			_arm_irq(self, 0x0);
+		};
+		uint16_t* dest = (uint16_t*)(buffer + i * self->sector_size);
+
+		if (self->word_io) {
+			_load_words(dest, n * self->sector_size / 2);
+		} else {
+			_load_into_buffer(dest, n * self->sector_size / 2);
 		};
-		_load_into_buffer(ptr_ata_buffer, self->sector_size / 2);
 	};
 	return 0;
 };
@@ -279,17 +377,65 @@ ata_t* ata_get(const char dev[2])
 	return 0x0;
 };
 
+// Reads into self->buffer, every sector overwrites the previous one, the last one stays
 int32_t ata_read(ata_t* self, const size_t start_block, const size_t n_blocks)
 {
 	if (!self) {
 		return -EIO;
 	};
+
+	for (size_t i = 0; i < n_blocks; i++) {
+		const int32_t res = ata_read_into(self, start_block + i, 1, self->buffer);
+
+		if (res < 0) {
+			return res;
+		};
+	};
+	return 0;
+};
+
+// Largest transfer of one command: the sector count register (LBA28 / LBA48), for DMA the bounce buffer
+static size_t _max_sectors(const ata_t* self)
+{
+	const size_t max = (self->features & (1 << 1)) ? 65536 : 256;
+
+	if (self->bm_base && max > ATA_DMA_MAX_SECTORS) {
+		return ATA_DMA_MAX_SECTORS;
+	};
+	return max;
+};
+
+/**
+ * @brief Reads count sectors starting at lba into buffer (count * sector_size bytes).
+ *
+ * Sectors go straight into buffer, one command per _max_sectors (an 8 KiB cluster is
+ * a single command). self->buffer is not touched.
+ */
+int32_t ata_read_into(ata_t* self, const size_t lba, const size_t count, uint8_t* buffer)
+{
+	if (!self || !buffer) {
+		return -EIO;
+	};
 	const bool has_pio48 = self->features & (1 << 1);
+	const size_t max = _max_sectors(self);
+	int32_t res = 0;
+	_lock(self);
+
+	for (size_t done = 0; done < count && res >= 0;) {
+		const size_t chunk = (count - done > max) ? max : count - done;
+		uint8_t* dest = buffer + done * self->sector_size;
 
-	if (has_pio48) {
-		return _read_pio48(self, start_block, n_blocks);
+		if (self->bm_base) {
+			res = _read_dma(self, lba + done, chunk, dest);
+		} else if (has_pio48) {
+			res = _read_pio48(self, lba + done, chunk, dest);
+		} else {
+			res = _read_pio28(self, lba + done, chunk, dest);
+		};
+		done += chunk;
 	};
-	return _read_pio28(self, start_block, n_blocks);
+	_unlock(self);
+	return res;
 };
 
 int32_t ata_write(ata_t* self, const size_t start_block, const size_t n_blocks, const uint8_t* buffer)
@@ -298,55 +444,203 @@ int32_t ata_write(ata_t* self, const size_t start_block, const size_t n_blocks,
 		return -EIO;
 	};
 	const bool has_pio48 = self->features & (1 << 1);
+	const size_t max = _max_sectors(self);
+	int32_t res = 0;
+	_lock(self);
+
+	// One command per _max_sectors, like ata_read_into
+	for (size_t done = 0; done < n_blocks && res >= 0;) {
+		const size_t chunk = (n_blocks - done > max) ? max : n_blocks - done;
+		const uint8_t* src = buffer + done * self->sector_size;
+
+		if (self->bm_base) {
+			res = _write_dma(self, start_block + done, chunk, src);
+		} else if (has_pio48) {
+			res = _write_pio48(self, start_block + done, chunk, src);
+		} else {
+			res = _write_pio28(self, start_block + done, chunk, src);
+		};
+		done += chunk;
+	};
+	// Even a failed write may have left sectors in the drive cache
+	self->dirty = true;
+	_unlock(self);
+	return res;
+};
+
+/**
+ * @brief Write barrier, everything ata_write completed so far is on the medium afterwards.
+ *
+ * Writes only land in the drive's write cache, callers flush where ordering or durability
+ * matters (fsync, close, before a directory entry points at new data). Nothing written since
+ * the last flush means no command at all.
+ * @return 0 or -EIO
+ */
+int32_t ata_flush(ata_t* self)
+{
+	if (!self) {
+		return -EIO;
+	};
+	int32_t res = 0;
+	_lock(self);
+
+	if (self->dirty) {
+		self->dirty = false;
+		res = _flush_cache(self);
+
+		if (res < 0) {
+			self->dirty = true;
+		};
+	};
+	_unlock(self);
+	return res;
+};
 
-	if (has_pio48) {
-		return _write_pio48(self, start_block, n_blocks, buffer);
+/**
+ * @brief Switches the transfer mode under the device lock, for test_ata_throughput.
+ *
+ * bm_base and multiple must be 0x0 or the values ata_init set up, the drive is not
+ * reprogrammed. word_io reads PIO data one inw at a time instead of rep insw.
+ */
+void ata_set_mode(ata_t* self, const uint16_t bm_base, const uint8_t multiple, const bool word_io)
+{
+	if (!self) {
+		return;
 	};
-	return _write_pio28(self, start_block, n_blocks, buffer);
+	_lock(self);
+	self->bm_base = bm_base;
+	self->multiple = multiple;
+	self->word_io = word_io;
+	_unlock(self);
+	return;
 };
 
-static int32_t _write_pio28(ata_t* self, const uint32_t lba, const uint8_t sectors, const uint8_t* buffer)
+/**
+ * @brief Coroutine version of ata_read, ctx is an ata_request_t.
+ *
+ * Never spins: waiting for the drive (device lock, IRQ14 per sector) is a suspension
+ * point. The coroutine parks until the interrupt (or the timeout in ata_tick) calls
+ * coro_wake, only when it is stepped with interrupts off (boot) it polls instead.
+ * Sectors go straight into req->buffer instead of the shared ata_t buffer.
+ * Result: number of sectors read, -EINVAL for more than one command (_max_sectors) or -EIO.
+ */
+coro_step_t ata_read_coro(coro_t* self)
+{
+	ata_request_t* req = (ata_request_t*)self->ctx;
+
+	CORO_BEGIN(self);
+
+	if (!req || !req->dev || !req->buffer || !req->count) {
+		CORO_EXIT(self, -EINVAL);
+	};
+
+	// One command per request, the sector count register would silently drop the rest
+	if (req->count > _max_sectors(req->dev)) {
+		CORO_EXIT(self, -EINVAL);
+	};
+	CORO_POLL_UNTIL(self, _try_lock(req->dev));
+	_arm_irq(req->dev, self);
+
+	if (req->dev->features & (1 << 1)) {
+		_send_read_pio48(req->lba, req->count, ATA_CMD_READ_SECTORS_EXT);
+	} else {
+		_send_read_pio28(req->lba, req->count, ATA_CMD_READ_SECTORS);
+	};
+
+	for (req->done = 0; req->done < req->count; req->done++) {
+		if (_irqs_enabled()) {
+			CORO_WAIT_UNTIL(self, !req->dev->irq_pending);
+		} else {
+			CORO_POLL_UNTIL(self, _poll_irq(req->dev));
+		};
+		req->status = _irq_result(req->dev);
+
+		if (req->status < 0 || (req->status & ATA_STATUS_ERR) || (req->status & ATA_STATUS_DF) || !(req->status & ATA_STATUS_DRQ)) {
+			kprintf("[CRITICAL] ATA Read Error on LBA %d\n", (uint32_t)(req->lba + req->done));
+			_unlock(req->dev);
+			CORO_EXIT(self, -EIO);
+		};
+
+		if (req->done + 1 < req->count) {
+			_arm_irq(req->dev, self);
+		};
+		_load_into_buffer((uint16_t*)(req->buffer + req->done * req->dev->sector_size), req->dev->sector_size / 2);
+	};
+	_unlock(req->dev);
+	CORO_EXIT(self, req->count);
+
+	CORO_END(self);
+};
+
+static bool _try_lock(ata_t* self)
+{
+	const uint32_t eflags = asm_irq_save();
+	const bool acquired = !self->busy;
+
+	if (acquired) {
+		self->busy = true;
+	};
+	asm_irq_restore(eflags);
+	return acquired;
+};
+
+/**
+ * @brief Takes the device for a synchronous command.
+ *
+ * A coroutine may own the drive across suspension points. A task sleeps until it
+ * is released, without a task (boot) the coroutines are driven inline.
+ */
+static void _lock(ata_t* self)
+{
+	while (!_try_lock(self)) {
+		if (!task_get_curr()) {
+			coro_run();
+			continue;
+		};
+		const uint32_t eflags = asm_irq_save();
+		// Re-check with interrupts off, the owner may have released it in between
+		if (self->busy) {
+			wq_sleep(WAIT_ATA);
+		};
+		asm_irq_restore(eflags);
+	};
+	return;
+};
+
+static void _unlock(ata_t* self)
+{
+	const uint32_t eflags = asm_irq_save();
+	self->busy = false;
+	wq_wakeup(WAIT_ATA);
+	asm_irq_restore(eflags);
+	return;
+};
+
+static int32_t _write_pio28(ata_t* self, const uint32_t lba, const size_t sectors, const uint8_t* buffer)
 {
 	if (!self || !buffer) {
 		return -EIO;
 	};
 	// Select master/slave and set LBA mode
 	outb(ATA_CONTROL_PORT, ATA_DRIVE_MASTER | ((lba >> 24) & 0x0F));
-	// Set number of sectors & LBA address (28-bit)
-	outb(ATA_SECTOR_COUNT_PORT, sectors);
+	// Set number of sectors (256 is sent as 0) & LBA address (28-bit)
+	outb(ATA_SECTOR_COUNT_PORT, sectors & 0xFF);
 	outb(ATA_LBA_LOW_PORT, lba & 0xFF);
 	outb(ATA_LBA_MID_PORT, (lba >> 8) & 0xFF);
 	outb(ATA_LBA_HIGH_PORT, (lba >> 16) & 0xFF);
-	// Send “WRITE SECTORS” command (0x30)
-	outb(ATA_COMMAND_PORT, ATA_CMD_WRITE_SECTORS);
-
-	for (size_t i = 0; i < sectors; ++i) {
-		// Wait for DRQ (Data Request)
-		while (!(inb(ATA_COMMAND_PORT) & ATA_STATUS_DRQ))
-			;
-		// Write 512 bytes with delay between `outw()` and `outw()`
-		for (size_t j = 0; j < 256; j++) {
-			outw(ATA_DATA_PORT, ((uint16_t*)buffer)[j]);
-			__asm__ __volatile__("jmp 1f\n1: jmp 1f\n1:");
-		};
-		buffer += 512;
-	};
-	// Cache flush (send ATA command `0xE7`)
-	outb(ATA_COMMAND_PORT, ATA_CMD_CACHE_FLUSH);
-	// Wait for BSY (Busy Flag) → Confirms that the flush is complete
-	while (inb(ATA_COMMAND_PORT) & ATA_STATUS_BSY)
-		;
-	return 0;
+	// Send “WRITE SECTORS” command (0x30) or “WRITE MULTIPLE” (0xC5)
+	outb(ATA_COMMAND_PORT, self->multiple ? ATA_CMD_WRITE_MULTIPLE : ATA_CMD_WRITE_SECTORS);
+	return _write_pio_data(self, lba, sectors, buffer);
 };
 
-static int32_t _write_pio48(ata_t* self, const uint64_t lba, const uint16_t sectors, const uint8_t* buffer)
+static int32_t _write_pio48(ata_t* self, const uint64_t lba, const size_t sectors, const uint8_t* buffer)
 {
 	if (!self || !buffer) {
 		return -EIO;
 	};
 	// Select master/slave and set LBA mode (bit 6 = 0x40 must be set)
 	outb(ATA_CONTROL_PORT, 0x40 | ATA_DRIVE_MASTER);
-	// Write the **upper bytes** of the number of sectors & LBA first
+	// Write the **upper bytes** of the number of sectors (65536 is sent as 0) & LBA first
 	outb(ATA_SECTOR_COUNT_PORT, (sectors >> 8) & 0xFF);
 	outb(ATA_LBA_LOW_PORT, (lba >> 24) & 0xFF);
 	outb(ATA_LBA_MID_PORT, (lba >> 32) & 0xFF);
@@ -356,25 +650,428 @@ static int32_t _write_pio48(ata_t* self, const uint64_t lba, const uint16_t sect
 	outb(ATA_LBA_LOW_PORT, lba & 0xFF);
 	outb(ATA_LBA_MID_PORT, (lba >> 8) & 0xFF);
 	outb(ATA_LBA_HIGH_PORT, (lba >> 16) & 0xFF);
-	// Send “WRITE SECTORS EXT” command (0x34)
-	outb(ATA_COMMAND_PORT, ATA_CMD_WRITE_SECTORS_EXT);
+	// Send “WRITE SECTORS EXT” command (0x34) or “WRITE MULTIPLE EXT” (0x39)
+	outb(ATA_COMMAND_PORT, self->multiple ? ATA_CMD_WRITE_MULTIPLE_EXT : ATA_CMD_WRITE_SECTORS_EXT);
+	return _write_pio_data(self, lba, sectors, buffer);
+};
 
-	for (size_t i = 0; i < sectors; ++i) {
-		// Wait for DRQ (data request)
-		while (!(inb(ATA_COMMAND_PORT) & ATA_STATUS_DRQ))
-			;
+/**
+ * @brief Feeds the sectors of a PIO write command, the drive interrupts after every block.
+ *
+ * The first DRQ comes without an interrupt and is polled (bounded), the interrupt after
+ * the last block ends the command. Every wait times out and resets the channel.
+ */
+static int32_t _write_pio_data(ata_t* self, const uint64_t lba, const size_t sectors, const uint8_t* buffer)
+{
+	const size_t block = _block_sectors(self);
+
+	for (size_t i = 0; i < sectors; i += block) {
+		const size_t n = (sectors - i > block) ? block : sectors - i;
+		const int32_t status = (i == 0) ? _wait_drq(self) : _wait_irq(self);
+
+		if (status < 0) {
+			return status;
+		};
 
-		// Write 512 bytes to the ATA data port (no `rep outsw`)
-		for (size_t j = 0; j < 256; j++) {
-			outw(ATA_DATA_PORT, ((uint16_t*)buffer)[j]);
-			__asm__ __volatile__("jmp 1f\n1: jmp 1f\n1:");
+		if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF) || !(status & ATA_STATUS_DRQ)) {
+			kprintf("[CRITICAL] ATA Write Error on LBA %d\n", (uint32_t)(lba + i));
+			return -EIO;
 		};
-		buffer += 512;
+		_arm_irq(self, 0x0);
+		// rep outsw, the drive keeps up without delays between the words
+		_store_from_buffer((const uint16_t*)buffer, n * self->sector_size / 2);
+		buffer += n * self->sector_size;
+	};
+	const int32_t status = _wait_irq(self);
+
+	if (status < 0) {
+		return status;
+	};
+
+	if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF)) {
+		kprintf("[CRITICAL] ATA Write Error on LBA %d\n", (uint32_t)lba);
+		return -EIO;
 	};
-	// Send cache flush (0xE7) to ensure that data is on the hard disk
+	// The data may still sit in the drive's write cache, ata_flush is the barrier
+	return 0;
+};
+
+// Cache flush (send ATA command `0xE7`), completion comes as an interrupt like every other command
+static int32_t _flush_cache(ata_t* self)
+{
+	_arm_irq(self, 0x0);
 	outb(ATA_COMMAND_PORT, ATA_CMD_CACHE_FLUSH);
-	//  Wait until the write process is complete
-	while (inb(ATA_COMMAND_PORT) & ATA_STATUS_BSY)
-		;
+	const int32_t status = _wait_irq(self);
+
+	if (status < 0) {
+		return status;
+	};
+
+	if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF)) {
+		kprintf("[CRITICAL] ATA Cache Flush Error\n");
+		return -EIO;
+	};
 	return 0;
+};
+
+/**
+ * @brief Looks for the PCI IDE controller (PIIX3/4 on QEMU) and turns on bus mastering.
+ *
+ * One 4 MiB frame holds the PRD table and the bounce buffer behind it. The frame is physically
+ * contiguous and 4 MiB aligned, so no PRD entry crosses a 64 KiB boundary.
+ * Without a controller bm_base stays 0x0 and every transfer goes through PIO.
+ */
+static void _init_dma(ata_t* self)
+{
+	pci_dev_t pci = {};
+
+	if (!pci_find_class(&pci, PCI_CLASS_MASS_STORAGE, PCI_SUBCLASS_IDE)) {
+		kprintf("[INFO] No PCI IDE controller, ATA stays in PIO mode\n");
+		return;
+	};
+	const uint32_t bar4 = pci_read32(pci.bus, pci.device, pci.function, PCI_BAR4_REG_OFFSET);
+
+	// Bit 0 marks an I/O BAR, the bus master registers are never memory mapped on PIIX
+	if (!(bar4 & 0x1) || !(bar4 & PCI_BAR_IO_MASK)) {
+		kprintf("[INFO] IDE controller without bus master, ATA stays in PIO mode\n");
+		return;
+	};
+	const uint32_t phys_addr = pfa_alloc();
+
+	if (!phys_addr) {
+		kprintf("[ERROR] No frame for the ATA DMA buffer, ATA stays in PIO mode\n");
+		return;
+	};
+	const uint32_t virt_addr = (uint32_t)p2v(phys_addr);
+	page_map_kernel(virt_addr, phys_addr, PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE);
+	pci_write16(pci.bus, pci.device, pci.function, PCI_COMMAND_REG_OFFSET, pci.command | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+
+	self->bm_base = bar4 & PCI_BAR_IO_MASK;
+	self->dma_phys = phys_addr;
+	self->prdt = (ata_prd_t*)virt_addr;
+	self->dma_buffer = (uint8_t*)(virt_addr + ATA_DMA_PRD_SIZE);
+
+	// The table has the first 64 KiB to itself, entry i covers the i-th 64 KiB of the bounce buffer
+	for (size_t i = 0; i < ATA_DMA_PRD_ENTRIES; i++) {
+		self->prdt[i].phys_addr = phys_addr + ATA_DMA_PRD_SIZE + i * ATA_DMA_PRD_SIZE;
+		self->prdt[i].size = 0x0;
+		self->prdt[i].flags = 0x0;
+	};
+
+	outl(self->bm_base + ATA_BM_PRDT, phys_addr);
+	outb(self->bm_base + ATA_BM_COMMAND, 0x0);
+	outb(self->bm_base + ATA_BM_STATUS, ATA_BM_STATUS_DRV0 | ATA_BM_STATUS_ERR | ATA_BM_STATUS_IRQ);
+	kprintf("[INFO] ATA bus master DMA at I/O 0x%x\n", self->bm_base);
+	return;
+};
+
+static void _send_dma(const uint64_t lba, const uint16_t sectors, const bool is_lba48, const bool write)
+{
+	if (is_lba48) {
+		outb(ATA_CONTROL_PORT, 0x40);			    // Select master, LBA mode
+		outb(ATA_SECTOR_COUNT_PORT, (sectors >> 8) & 0xFF); // sectors high
+		outb(ATA_LBA_LOW_PORT, (lba >> 24) & 0xFF);	    // LBA4
+		outb(ATA_LBA_MID_PORT, (lba >> 32) & 0xFF);	    // LBA5
+		outb(ATA_LBA_HIGH_PORT, (lba >> 40) & 0xFF);	    // LBA6
+		outb(ATA_SECTOR_COUNT_PORT, sectors & 0xFF);	    // sectors low
+		outb(ATA_LBA_LOW_PORT, lba & 0xFF);		    // LBA1
+		outb(ATA_LBA_MID_PORT, (lba >> 8) & 0xFF);	    // LBA2
+		outb(ATA_LBA_HIGH_PORT, (lba >> 16) & 0xFF);	    // LBA3
+		outb(ATA_COMMAND_PORT, write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT);
+		return;
+	};
+	outb(ATA_CONTROL_PORT, ATA_DRIVE_MASTER | ((lba >> 24) & 0x0F));
+	outb(ATA_SECTOR_COUNT_PORT, sectors & 0xFF);
+	outb(ATA_LBA_LOW_PORT, lba & 0xFF);
+	outb(ATA_LBA_MID_PORT, (lba >> 8) & 0xFF);
+	outb(ATA_LBA_HIGH_PORT, (lba >> 16) & 0xFF);
+	outb(ATA_COMMAND_PORT, write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+	return;
+};
+
+// One command of at most _max_sectors between the drive and the bounce buffer, caller holds the lock
+static int32_t _transfer_dma(ata_t* self, const uint64_t lba, const size_t sectors, const bool write)
+{
+	const bool is_lba48 = self->features & (1 << 1);
+	const uint32_t bytes = sectors * self->sector_size;
+	const uint32_t entries = (bytes + ATA_DMA_PRD_SIZE - 1) / ATA_DMA_PRD_SIZE;
+
+	// Full entries are 0 (64 KiB), the last one gets the rest and EOT
+	for (uint32_t i = 0; i < entries; i++) {
+		self->prdt[i].size = (i + 1 < entries) ? 0x0 : bytes & 0xFFFF;
+		self->prdt[i].flags = (i + 1 < entries) ? 0x0 : ATA_PRD_EOT;
+	};
+
+	outl(self->bm_base + ATA_BM_PRDT, self->dma_phys);
+	outb(self->bm_base + ATA_BM_COMMAND, write ? 0x0 : ATA_BM_CMD_READ);
+	outb(self->bm_base + ATA_BM_STATUS, ATA_BM_STATUS_DRV0 | ATA_BM_STATUS_ERR | ATA_BM_STATUS_IRQ);
+
+	_arm_irq(self, 0x0);
+	_send_dma(lba, sectors & 0xFFFF, is_lba48, write);
+	outb(self->bm_base + ATA_BM_COMMAND, (write ? 0x0 : ATA_BM_CMD_READ) | ATA_BM_CMD_START);
+	const int32_t status = _wait_irq(self);
+
+	if (status < 0) {
+		return status;
+	};
+
+	if ((status & ATA_STATUS_ERR) || (status & ATA_STATUS_DF)) {
+		kprintf("[CRITICAL] ATA DMA %s Error on LBA %d\n", write ? "Write" : "Read", (uint32_t)lba);
+		return -EIO;
+	};
+	return 0;
+};
+
+// DMA counterpart of _read_pio48/_read_pio28, one command through the bounce buffer
+static int32_t _read_dma(ata_t* self, const uint64_t lba, const size_t sectors, uint8_t* buffer)
+{
+	const int32_t res = _transfer_dma(self, lba, sectors, false);
+
+	if (res < 0) {
+		return res;
+	};
+	memcpy(buffer, self->dma_buffer, sectors * self->sector_size);
+	return 0;
+};
+
+static int32_t _write_dma(ata_t* self, const uint64_t lba, const size_t sectors, const uint8_t* buffer)
+{
+	const size_t max = _max_sectors(self);
+
+	for (size_t done = 0; done < sectors;) {
+		const size_t chunk = (sectors - done > max) ? max : sectors - done;
+		memcpy(self->dma_buffer, buffer + done * self->sector_size, chunk * self->sector_size);
+		const int32_t res = _transfer_dma(self, lba + done, chunk, true);
+
+		if (res < 0) {
+			return res;
+		};
+		done += chunk;
+	};
+	return 0;
+};
+
+// 400 ns for the drive to raise BSY after a command or a data block, four alternate status reads
+static void _settle(void)
+{
+	for (size_t i = 0; i < 4; i++) {
+		inb(ATA_ALT_STATUS_PORT);
+	};
+	return;
+};
+
+// IRQ14 can only arrive with interrupts on, otherwise completion has to be polled
+static bool _irqs_enabled(void)
+{
+	const uint32_t eflags = asm_irq_save();
+	asm_irq_restore(eflags);
+	return eflags & EFLAGS_IF;
+};
+
+/**
+ * @brief Expects the next interrupt of the drive, must happen before the command (or block) that raises it.
+ * @param coro Coroutine to wake, 0x0 wakes the task sleeping on WAIT_ATA
+ */
+static void _arm_irq(ata_t* self, coro_t* coro)
+{
+	const uint32_t eflags = asm_irq_save();
+	self->irq_coro = coro;
+	self->irq_timeout = false;
+	self->irq_spins = 0;
+	self->irq_deadline = timer.ticks + (ATA_TIMEOUT_MS * timer.hz) / 1000;
+	self->irq_pending = true;
+	asm_irq_restore(eflags);
+	return;
+};
+
+static void _wake_owner(ata_t* self)
+{
+	if (self->irq_coro) {
+		coro_wake(self->irq_coro);
+	} else {
+		wq_wakeup(WAIT_ATA);
+	};
+	return;
+};
+
+/**
+ * @brief Called from IRQ14, takes the status of the finished block or command and wakes its owner.
+ *
+ * Reading the status register acknowledges INTRQ. With a bus master the controller latches
+ * the interrupt in its status register (PIO commands included), anything else is not ours.
+ */
+void ata_irq(ata_t* self)
+{
+	if (self->bm_base) {
+		if (!(inb(self->bm_base + ATA_BM_STATUS) & ATA_BM_STATUS_IRQ)) {
+			return;
+		};
+		outb(self->bm_base + ATA_BM_COMMAND, 0x0);
+		outb(self->bm_base + ATA_BM_STATUS, ATA_BM_STATUS_DRV0 | ATA_BM_STATUS_ERR | ATA_BM_STATUS_IRQ);
+	};
+	const uint8_t status = inb(ATA_STATUS_REGISTER);
+
+	if (!self->irq_pending) {
+		return;
+	};
+	self->irq_status = status;
+	self->irq_pending = false;
+	_wake_owner(self);
+	return;
+};
+
+// Called from IRQ0, gives up on a command whose interrupt did not show up within ATA_TIMEOUT_MS
+void ata_tick(ata_t* self, const uint64_t now)
+{
+	if (!self->irq_pending || now < self->irq_deadline) {
+		return;
+	};
+	self->irq_timeout = true;
+	self->irq_pending = false;
+	_wake_owner(self);
+	return;
+};
+
+/**
+ * @brief Completion without interrupts (boot, IF = 0), the same checks as IRQ14 with a spin budget as timeout.
+ * @return true once the armed interrupt is done or timed out
+ */
+static bool _poll_irq(ata_t* self)
+{
+	if (!self->irq_pending) {
+		return true;
+	};
+
+	if (++self->irq_spins > ATA_POLL_SPINS) {
+		self->irq_timeout = true;
+		self->irq_pending = false;
+		return true;
+	};
+
+	if (self->bm_base) {
+		ata_irq(self);
+		return !self->irq_pending;
+	};
+
+	// Without a bus master the block is done once BSY drops, after the drive had time to raise it
+	if (self->irq_spins == 1) {
+		_settle();
+	};
+	const uint8_t status = inb(ATA_STATUS_REGISTER);
+
+	if (!(status & ATA_STATUS_BSY)) {
+		self->irq_status = status;
+		self->irq_pending = false;
+	};
+	return !self->irq_pending;
+};
+
+// Status of the finished interrupt, a timeout resets the channel and becomes -EIO
+static int32_t _irq_result(ata_t* self)
+{
+	if (self->irq_timeout) {
+		_reset(self);
+		return -EIO;
+	};
+	return self->irq_status;
+};
+
+/**
+ * @brief Waits for the interrupt armed by _arm_irq.
+ *
+ * A task sleeps on WAIT_ATA until IRQ14 (or ata_tick on timeout) clears irq_pending,
+ * the cpu runs other tasks in the meantime. Without a task (boot) the drive is polled.
+ * @return The ATA status at the interrupt or -EIO
+ */
+static int32_t _wait_irq(ata_t* self)
+{
+	if (!task_get_curr()) {
+		while (!_poll_irq(self))
+			;
+		return _irq_result(self);
+	};
+	const uint32_t eflags = asm_irq_save();
+	// Checked with interrupts off, IRQ14 can't slip in between the test and the sleep
+	while (self->irq_pending) {
+		wq_sleep(WAIT_ATA);
+	};
+	asm_irq_restore(eflags);
+	return _irq_result(self);
+};
+
+// The first DRQ of a write comes without an interrupt, bounded poll
+static int32_t _wait_drq(ata_t* self)
+{
+	_settle();
+
+	for (uint32_t spins = 0; spins < ATA_POLL_SPINS; spins++) {
+		const uint8_t status = inb(ATA_STATUS_REGISTER);
+
+		if (!(status & ATA_STATUS_BSY) && (status & (ATA_STATUS_DRQ | ATA_STATUS_ERR | ATA_STATUS_DF))) {
+			return status;
+		};
+	};
+	_reset(self);
+	return -EIO;
+};
+
+/**
+ * @brief Software reset of the channel after a timeout.
+ *
+ * SRST aborts whatever the drive is stuck in, the bus master is stopped as well.
+ * The next command starts from a clean channel, the caller gets -EIO.
+ */
+static void _reset(ata_t* self)
+{
+	kprintf("[CRITICAL] ATA Timeout, resetting the Channel\n");
+	self->irq_pending = false;
+
+	if (self->bm_base) {
+		outb(self->bm_base + ATA_BM_COMMAND, 0x0);
+		outb(self->bm_base + ATA_BM_STATUS, ATA_BM_STATUS_DRV0 | ATA_BM_STATUS_ERR | ATA_BM_STATUS_IRQ);
+	};
+	outb(ATA_DEVICE_CONTROL_PORT, ATA_CONTROL_SRST);
+	// SRST has to be held for at least 5 us
+	for (size_t i = 0; i < 16; i++) {
+		_settle();
+	};
+	outb(ATA_DEVICE_CONTROL_PORT, 0x0);
+	_settle();
+
+	for (uint32_t spins = 0; spins < ATA_POLL_SPINS; spins++) {
+		if (!(inb(ATA_ALT_STATUS_PORT) & ATA_STATUS_BSY)) {
+			break;
+		};
+	};
+	outb(ATA_CONTROL_PORT, ATA_DRIVE_MASTER);
+	return;
+};
+
+// Sectors per PIO data block, the drive raises one interrupt per block
+static size_t _block_sectors(const ata_t* self) { return self->multiple ? self->multiple : 1; }
+
+/**
+ * @brief SET MULTIPLE MODE with the largest block from IDENTIFY (word 47).
+ *
+ * READ/WRITE MULTIPLE then move self->multiple sectors per DRQ/interrupt instead of one.
+ * If the drive refuses, self->multiple is cleared and PIO stays at one sector per interrupt.
+ */
+static void _init_multiple(ata_t* self)
+{
+	if (!self->multiple) {
+		return;
+	};
+	_arm_irq(self, 0x0);
+	outb(ATA_CONTROL_PORT, ATA_DRIVE_MASTER);
+	outb(ATA_SECTOR_COUNT_PORT, self->multiple);
+	outb(ATA_COMMAND_PORT, ATA_CMD_SET_MULTIPLE);
+	const int32_t status = _wait_irq(self);
+
+	if (status < 0 || (status & ATA_STATUS_ERR)) {
+		kprintf("[INFO] ATA refused SET MULTIPLE, one Sector per Interrupt\n");
+		self->multiple = 0x0;
+		return;
+	};
+	kprintf("[INFO] ATA READ/WRITE MULTIPLE with %d Sectors per Block\n", self->multiple);
+	return;
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+/**
+ * @file clock.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Time page, the kernel half of the libc clock_gettime fast path
+ */
+
+#include "clock.h"
+#include "cmos.h"
+#include "page.h"
+#include "pfa.h"
+#include "tsc.h"
+
+/* EXTERNAL API */
+extern pfa_t pfa;
+
+/* PUBLIC API */
+void clock_init(const uint32_t hz);
+void clock_tick(void);
+void clock_map(uint32_t* dir);
+
+/* INTERNAL API */
+static uint32_t _div64_32(const uint64_t dividend, const uint32_t divisor);
+static uint32_t _rtc_epoch(void);
+static void _calibrate(clock_page_t* page, const uint64_t tsc);
+
+static clock_page_t* _page = 0x0;
+static uint32_t _frame = 0;
+static uint32_t _tick_nsec = 0;
+static uint64_t _calib_tsc = 0;
+
+// No libgcc: 64 / 32 bit division with a single DIV, the quotient has to fit into 32 bit
+static uint32_t _div64_32(const uint64_t dividend, const uint32_t divisor)
+{
+	uint32_t quotient = 0;
+	uint32_t remainder = 0;
+	asm("divl %4" : "=a"(quotient), "=d"(remainder) : "a"((uint32_t)dividend), "d"((uint32_t)(dividend >> 32)), "rm"(divisor));
+	return quotient;
+};
+
+static uint32_t _rtc_epoch(void)
+{
+	const date_t date = cmos_date(&cmos);
+	const time_t time = cmos_time(&cmos);
+	// date.year mixes the raw century register in, the year register (BCD yy) is decoded on its own
+	int32_t year = 2000 + cmos_bcd_to_decimal(cmos.values[9]);
+	const int32_t month = date.month;
+	// Days since 1970-01-01 (civil calendar, March based year so the leap day comes last)
+	year -= (month <= 2);
+	const int32_t era = year / 400;
+	const int32_t yoe = year - era * 400;
+	const int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + date.day - 1;
+	const int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	const int32_t days = era * 146097 + doe - 719468;
+	return (uint32_t)days * 86400 + time.hour * 3600 + time.minute * 60 + time.second;
+};
+
+/**
+ * @brief Derives ns per TSC cycle from CLOCK_CALIBRATE_TICKS timer ticks.
+ */
+static void _calibrate(clock_page_t* page, const uint64_t tsc)
+{
+	if (page->ticks == 1) {
+		_calib_tsc = tsc;
+		return;
+	};
+
+	if (page->ticks != 1 + CLOCK_CALIBRATE_TICKS) {
+		return;
+	};
+	const uint32_t cycles = (uint32_t)(tsc - _calib_tsc) / CLOCK_CALIBRATE_TICKS;
+
+	if (cycles <= _tick_nsec >> (32 - CLOCK_TSC_SHIFT)) {
+		// Multiplier would not fit, stay at tick resolution
+		return;
+	};
+	page->tsc_shift = CLOCK_TSC_SHIFT;
+	page->tsc_mult = _div64_32((uint64_t)_tick_nsec << CLOCK_TSC_SHIFT, cycles);
+	kprintf("[INFO] TSC calibrated: %d cycles per tick\n", (int)cycles);
+	return;
+};
+
+void clock_init(const uint32_t hz)
+{
+	const uint32_t phys_addr = pfa_alloc();
+
+	if (!phys_addr) {
+		kprintf("[ERROR] No frame for the time page, no user clock\n");
+		return;
+	};
+	const uint32_t virt_addr = (uint32_t)p2v(phys_addr);
+	page_map_kernel(virt_addr, phys_addr, PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE);
+	_page = (clock_page_t*)virt_addr;
+	_frame = phys_addr;
+	_tick_nsec = 1000000000 / hz;
+
+	memset(_page, 0, sizeof(clock_page_t));
+	_page->hz = hz;
+	_page->tick_nsec = _tick_nsec;
+	_page->tsc_tick = tsc_read();
+	_page->boot_time = _rtc_epoch();
+	kprintf("[INFO] Time page at 0x%x, boot time %d\n", virt_addr, (int)_page->boot_time);
+	return;
+};
+
+/**
+ * @brief Called from irq0_handler, every tick.
+ */
+void clock_tick(void)
+{
+	clock_page_t* page = _page;
+
+	if (!page) {
+		return;
+	};
+	const uint64_t tsc = tsc_read();
+	page->seq++;
+	asm volatile("" ::: "memory");
+
+	page->ticks++;
+	page->tsc_tick = tsc;
+	page->mono_nsec += _tick_nsec;
+
+	if (page->mono_nsec >= 1000000000) {
+		page->mono_nsec -= 1000000000;
+		page->mono_sec++;
+	};
+	_calibrate(page, tsc);
+
+	asm volatile("" ::: "memory");
+	page->seq++;
+	return;
+};
+
+/**
+ * @brief Maps the time page read-only at USER_CLOCK_START, the reference goes away with the address space.
+ */
+void clock_map(uint32_t* dir)
+{
+	if (!_page) {
+		return;
+	};
+	pfa_ref(&pfa, _frame / PAGE_SIZE);
+	page_map_dir(dir, USER_CLOCK_START, _frame, PAGE_PS | PAGE_PRESENT | PAGE_USER);
+	return;
+};
\ No newline at end of file
@@ -31,6 +31,8 @@ static int32_t _bcd_to_decimal(const int32_t bcd)
 	return decimal;
 };
 
+int32_t cmos_bcd_to_decimal(const int32_t bcd) { return _bcd_to_decimal(bcd); };
+
 static void _dump_cmos(cmos_t* self)
 {
 	for (uint16_t i = 0; i < 128; i++) {
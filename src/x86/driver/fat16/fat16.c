@@ -54,13 +54,18 @@ fat16_node_t* fat16_get_node_from_path(ata_t* dev, pathnode_t* path);
 void* fat16_open(ata_t* dev, pathnode_t* path, uint8_t mode);
 uint32_t fat16_get_cluster_from_descriptor(fat16_fd_t* fat16_descriptor);
 size_t fat16_read(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_bytes, const size_t n_blocks);
+size_t fat16_pread(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_bytes, const size_t n_blocks, const uint32_t offset);
 int32_t fat16_close(void* internal);
 int32_t fat16_stat(ata_t* dev, void* internal, vstat_t* vstat);
 int32_t fat16_seek(void* internal, const uint32_t offset, const uint8_t origin);
 size_t fat16_write(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks);
+size_t fat16_pwrite(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset);
 int32_t fat16_readdir(ata_t* dev, void* internal, vfs_dirent_t* dir, uint32_t dir_offset);
+int32_t fat16_sync(ata_t* dev, void* internal);
 /* INTERNAL API */
 bool _is_valid_fat16_header(const fat16_internal_header_t* header);
+static uint16_t _fat16_next_or_append_cluster(ata_t* dev, stream_t* fat_stream, const uint32_t partition_offset, const uint16_t curr_cluster);
+static int32_t _fat16_update_file_entry(ata_t* dev, fat16_fd_t* fd);
 
 fs_t fat16 = {
     .resolve_cb = 0x0,
@@ -70,6 +75,11 @@ fs_t fat16 = {
     .stat_cb = 0x0,
     .seek_cb = 0x0,
     .readdir_cb = 0x0,
+    .pread_cb = 0x0,
+    .pwrite_cb = 0x0,
+    .poll_cb = 0x0,
+    .map_cb = 0x0,
+    .sync_cb = 0x0,
     .name = "FAT16",
 };
 
@@ -136,6 +146,9 @@ fs_t* fat16_init(void)
 	fat16.seek_cb = fat16_seek;
 	fat16.write_cb = fat16_write;
 	fat16.readdir_cb = fat16_readdir;
+	fat16.pread_cb = fat16_pread;
+	fat16.pwrite_cb = fat16_pwrite;
+	fat16.sync_cb = fat16_sync;
 	return &fat16;
 };
 
@@ -295,6 +308,11 @@ fat16_node_t* fat16_create_file(ata_t* dev, pathnode_t* path, fat16_node_t* node
 	// Mark the cluster from the new entry itself as end of chain
 	fat16_create_fat_entry(dev, free_cluster, FAT16_VALUE_END_OF_CHAIN);
 
+	// The cluster must be taken on disk before a directory entry can point at it
+	if (ata_flush(dev) < 0) {
+		return 0x0;
+	};
+
 	stream_t dir_stream = {};
 	stream_init(&dir_stream, dev);
 	stream_seek(&dir_stream, free_entry_offset);
@@ -426,7 +444,7 @@ void fat16_create_file_stat(fat16_fd_t* fat16_descriptor, ata_t* dev, vstat_t* v
 		vstat->st_blksize = max_cluster_size_bytes;
 		vstat->st_blocks = (used_blocks * max_cluster_size_bytes) / dev->sector_size;
 		vstat->st_atime = fat16_descriptor->entry->dir->entry->last_access_date;
-		vstat->st_mtime = fat16_descriptor->entry->dir->entry->modification_date;
+		vstat->st_mtime = (fat16_descriptor->entry->dir->entry->modification_date << 16) | fat16_descriptor->entry->dir->entry->modification_time;
 		vstat->st_ctime = fat16_descriptor->entry->dir->entry->creation_time_ms;
 		break;
 	};
@@ -437,7 +455,7 @@ void fat16_create_file_stat(fat16_fd_t* fat16_descriptor, ata_t* dev, vstat_t* v
 		vstat->st_blksize = max_cluster_size_bytes;
 		vstat->st_blocks = (used_blocks * max_cluster_size_bytes) / dev->sector_size;
 		vstat->st_atime = fat16_descriptor->entry->file->last_access_date;
-		vstat->st_mtime = fat16_descriptor->entry->file->modification_date;
+		vstat->st_mtime = (fat16_descriptor->entry->file->modification_date << 16) | fat16_descriptor->entry->file->modification_time;
 		vstat->st_ctime = fat16_descriptor->entry->file->creation_time_ms;
 		break;
 	};
@@ -1146,8 +1164,17 @@ uint32_t fat16_get_cluster_from_descriptor(fat16_fd_t* fat16_descriptor)
 	return start_cluster;
 };
 
-// Read data from a FAT16 filesystem
+// Read data from a FAT16 filesystem at the descriptor position and advance it
 size_t fat16_read(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_bytes, const size_t n_blocks)
+{
+	fat16_fd_t* fat16_descriptor = descriptor;
+	const size_t bytes_read = fat16_pread(dev, descriptor, buffer, n_bytes, n_blocks, fat16_descriptor->pos);
+	fat16_descriptor->pos += bytes_read;
+	return bytes_read;
+};
+
+// Read data from a FAT16 filesystem at an explicit offset, the descriptor position is left alone
+size_t fat16_pread(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_bytes, const size_t n_blocks, const uint32_t offset)
 {
 	// Define the offset of the partition
 	const uint32_t partition_offset = 0x100000;
@@ -1157,29 +1184,47 @@ size_t fat16_read(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_
 	stream_init(&data_stream, dev);
 	// Cast the vfs internal back to the concrete fat16 descriptor
 	fat16_fd_t* fat16_descriptor = descriptor;
+	// Initialize remaining_bytes for tracking the termination of the following read loop
+	size_t remaining_bytes = n_bytes * n_blocks;
 
-	if (fat16_descriptor->entry->type == FAT16_ENTRY_TYPE_FILE && fat16_descriptor->pos >= fat16_descriptor->entry->file->file_size) {
-		return 0;
+	if (fat16_descriptor->entry->type == FAT16_ENTRY_TYPE_FILE) {
+		const uint32_t file_size = fat16_descriptor->entry->file->file_size;
+
+		if (offset >= file_size) {
+			return 0;
+		};
+		// Never hand out the slack behind the end of the file in its last cluster
+		if (remaining_bytes > file_size - offset) {
+			remaining_bytes = file_size - offset;
+		};
 	};
 	// Maximum cluster size in bytes of a single FAT16 cluster
 	const uint16_t max_cluster_size_bytes = fat16_header.bpb.sec_per_clus * fat16_header.bpb.byts_per_sec;
 	// The given file descriptor holds a pointer to the root dir entry, which holds the fat16 start cluster number to read
 	const uint32_t start_cluster = fat16_get_cluster_from_descriptor(fat16_descriptor);
-	// Determine the starting cluster for reading
-	uint16_t curr_cluster = (fat16_descriptor->pos / max_cluster_size_bytes) + start_cluster;
-	const uint16_t first_cluster_offset = fat16_descriptor->pos % max_cluster_size_bytes;
+	// Determine the starting cluster for reading, clusters of a file are not necessarily contiguous so follow the chain
+	uint16_t curr_cluster = start_cluster;
+
+	for (uint32_t i = offset / max_cluster_size_bytes; i > 0; i--) {
+		curr_cluster = fat16_get_next_cluster(&fat_stream, partition_offset, curr_cluster);
+
+		if (curr_cluster >= FAT16_VALUE_END_OF_CHAIN) {
+			return 0;
+		};
+	};
+	// Only the first cluster is entered in the middle, all following ones are read from their start
+	uint16_t cluster_offset = offset % max_cluster_size_bytes;
 	// Initialize bytes_read for tracking read progress and return to the  caller of the function the amount of readed bytes
 	size_t bytes_read = 0;
-	// Initialize remaining_bytes for tracking the termination of the following read loop
-	size_t remaining_bytes = n_bytes * n_blocks - bytes_read;
-	// Limit read_size to the smaller of remaining_bytes and the max cluster size in FAT16 filesystem
-	size_t read_size = remaining_bytes < max_cluster_size_bytes ? remaining_bytes : max_cluster_size_bytes;
+	// Limit read_size to the smaller of remaining_bytes and what is left of the first cluster
+	const size_t first_chunk = max_cluster_size_bytes - cluster_offset;
+	size_t read_size = remaining_bytes < first_chunk ? remaining_bytes : first_chunk;
 
 	while (remaining_bytes) {
 		// Convert the logical fat16 cluster number to a physical sector
 		const uint32_t sector = fat16_get_sector_from_cluster(curr_cluster);
 		// Use the previously calculated sector and add the partition offset and the first cluster to get the data position on die ata device
-		const uint32_t data_pos = partition_offset + (sector * fat16_header.bpb.byts_per_sec) + first_cluster_offset;
+		const uint32_t data_pos = partition_offset + (sector * fat16_header.bpb.byts_per_sec) + cluster_offset;
 		// Seek to the data position and read data into the buffer
 		stream_seek(&data_stream, data_pos);
 		// Ensure that new data is appended to the buffer + bytes_read ensures the correct position so that previously written data is not
@@ -1192,8 +1237,11 @@ size_t fat16_read(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_
 		};
 		// Update read progress
 		bytes_read += read_size;
-		fat16_descriptor->pos += read_size;
 		remaining_bytes -= read_size;
+
+		if (!remaining_bytes) {
+			break;
+		};
 		// Determine the next cluster from the FAT table
 		const uint16_t next_cluster = fat16_get_next_cluster(&fat_stream, partition_offset, curr_cluster);
 		// Check if end of file is reached, if yes, exit loop
@@ -1202,6 +1250,7 @@ size_t fat16_read(ata_t* dev, void* descriptor, uint8_t* buffer, const size_t n_
 		};
 		// Update current cluster for the next iteration
 		curr_cluster = next_cluster;
+		cluster_offset = 0;
 		// Adjust read_size based on remaining bytes and cluster size
 		read_size = remaining_bytes < max_cluster_size_bytes ? remaining_bytes : max_cluster_size_bytes;
 	};
@@ -1500,31 +1549,159 @@ size_t fat16_write(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_b
 	};
 	if (bytes_written > file_entry->file_size) {
 		file_entry->file_size = bytes_written;
-		const uint32_t parent_cluster = fat16_get_parent_cluster(dev, fd->entry->file->file_name);
-		const uint32_t entry_offset = fat16_find_entry_offset(dev, parent_cluster, fd->entry->file->file_name);
 
-		if (!entry_offset) {
+		if (_fat16_update_file_entry(dev, fd) < 0) {
 			return -EIO;
 		};
-		fat16_time_t current_time = fat16_get_curr_time();
-		fat16_date_t current_date = fat16_get_curr_date();
+	};
+	return bytes_written;
+};
+
+/**
+ * Write data at an explicit offset without truncating the file or touching the descriptor position.
+ * The cluster chain is extended as needed, a gap between the old end of file and offset is filled with zeros
+ * in the same pass, the directory entry is written once at the end.
+ */
+size_t fat16_pwrite(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset)
+{
+	if (!dev || !internal || !buffer || n_bytes == 0 || n_blocks == 0) {
+		return -EINVAL;
+	};
+	fat16_fd_t* fd = (fat16_fd_t*)internal;
+
+	if (fd->entry->type != FAT16_ENTRY_TYPE_FILE) {
+		return -EISDIR;
+	};
+	static const uint8_t zeros[512] = {0};
+	fat16_dir_entry_t* file_entry = fd->entry->file;
+	const uint32_t partition_offset = 0x100000;
+	const uint16_t max_cluster_size_bytes = fat16_header.bpb.sec_per_clus * fat16_header.bpb.byts_per_sec;
+	// FAT16 has no holes, writing starts at the old end of file if offset lies behind it
+	const uint32_t start = (file_entry->file_size < offset) ? file_entry->file_size : offset;
+	const uint32_t end = offset + n_bytes * n_blocks;
+	uint32_t pos = start;
+	int32_t err = 0;
 
-		file_entry->modification_time = fat16_get_packed_time(current_time);
-		file_entry->modification_date = fat16_get_packed_date(current_date);
+	stream_t fat_stream = {}, data_stream = {};
+	stream_init(&fat_stream, dev);
+	stream_init(&data_stream, dev);
+	// Follow the chain to the cluster holding start, a start right at the end of the last cluster needs a new one
+	uint16_t curr_cluster = fat16_get_combined_cluster(file_entry->high_cluster, file_entry->low_cluster);
 
-		stream_t dir_stream = {};
-		stream_init(&dir_stream, dev);
-		stream_seek(&dir_stream, entry_offset);
-		const int32_t res = stream_write(&dir_stream, (uint8_t*)file_entry, sizeof(fat16_dir_entry_t));
+	for (uint32_t i = start / max_cluster_size_bytes; i > 0; i--) {
+		curr_cluster = _fat16_next_or_append_cluster(dev, &fat_stream, partition_offset, curr_cluster);
 
-		if (res < 0) {
-			kprintf("[ERROR] Writing Error\n");
+		if (!curr_cluster) {
+			return -ENOSPC;
+		};
+	};
+	uint32_t cluster_offset = start % max_cluster_size_bytes;
+
+	while (pos < end) {
+		const bool gap = pos < offset;
+		const size_t free_space_in_cluster = max_cluster_size_bytes - cluster_offset;
+		const size_t remaining_bytes = gap ? offset - pos : end - pos;
+		size_t write_size = (remaining_bytes > free_space_in_cluster) ? free_space_in_cluster : remaining_bytes;
+
+		if (gap && write_size > sizeof(zeros)) {
+			write_size = sizeof(zeros);
+		};
+		const uint32_t sector = fat16_get_sector_from_cluster(curr_cluster);
+		const uint32_t data_pos = partition_offset + (sector * fat16_header.bpb.byts_per_sec);
+		stream_seek(&data_stream, data_pos + cluster_offset);
+
+		if (stream_write(&data_stream, gap ? zeros : buffer + (pos - offset), write_size) < 0) {
+			kprintf("[ERROR] Writing Error.\n");
+			err = -EIO;
+			break;
+		};
+		pos += write_size;
+		cluster_offset += write_size;
+
+		if (cluster_offset >= max_cluster_size_bytes && pos < end) {
+			curr_cluster = _fat16_next_or_append_cluster(dev, &fat_stream, partition_offset, curr_cluster);
+
+			if (!curr_cluster) {
+				err = -ENOSPC;
+				break;
+			};
+			cluster_offset = 0;
+		};
+	};
+
+	if (pos > file_entry->file_size) {
+		file_entry->file_size = pos;
+
+		if (_fat16_update_file_entry(dev, fd) < 0) {
 			return -EIO;
 		};
-		kprintf("[FAT16] SUCCESS: File-Entry updated: Size %d Bytes, Timestamp %d:%d:%d %d-%d-%d\n", file_entry->file_size, current_time.hour,
-			current_time.minute, current_time.second, current_date.day, current_date.month, current_date.year);
 	};
-	return bytes_written;
+	// Short write once data got through, the error only if not a byte of it did
+	return (pos > offset) ? pos - offset : (size_t)err;
+};
+
+// Next cluster in the chain of curr_cluster, a free one is linked in at the end of the chain, 0 if the disk is full
+static uint16_t _fat16_next_or_append_cluster(ata_t* dev, stream_t* fat_stream, const uint32_t partition_offset, const uint16_t curr_cluster)
+{
+	const uint16_t next_cluster = fat16_get_next_cluster(fat_stream, partition_offset, curr_cluster);
+
+	if (next_cluster < FAT16_VALUE_END_OF_CHAIN) {
+		return next_cluster;
+	};
+	const uint16_t new_cluster = fat16_get_next_free_cluster(fat_stream, partition_offset);
+
+	if (!new_cluster) {
+		return 0;
+	};
+	// Mark the new cluster as end of chain first, so it is never seen as free while being linked
+	fat16_create_fat_entry(dev, new_cluster, FAT16_VALUE_END_OF_CHAIN);
+	fat16_create_fat_entry(dev, curr_cluster, new_cluster);
+	return new_cluster;
+};
+
+// Write the size and a fresh modification time of an open file back to its directory entry
+static int32_t _fat16_update_file_entry(ata_t* dev, fat16_fd_t* fd)
+{
+	fat16_dir_entry_t* file_entry = fd->entry->file;
+	const uint32_t parent_cluster = fat16_get_parent_cluster(dev, file_entry->file_name);
+	const uint32_t entry_offset = fat16_find_entry_offset(dev, parent_cluster, file_entry->file_name);
+
+	if (!entry_offset) {
+		return -EIO;
+	};
+	fat16_time_t current_time = fat16_get_curr_time();
+	fat16_date_t current_date = fat16_get_curr_date();
+
+	file_entry->modification_time = fat16_get_packed_time(current_time);
+	file_entry->modification_date = fat16_get_packed_date(current_date);
+
+	// Barrier, the data and the cluster chain reach the disk before the new size does
+	if (ata_flush(dev) < 0) {
+		return -EIO;
+	};
+	stream_t dir_stream = {};
+	stream_init(&dir_stream, dev);
+	stream_seek(&dir_stream, entry_offset);
+	const int32_t res = stream_write(&dir_stream, (uint8_t*)file_entry, sizeof(fat16_dir_entry_t));
+
+	if (res < 0) {
+		kprintf("[ERROR] Writing Error\n");
+		return -EIO;
+	};
+	kprintf("[FAT16] SUCCESS: File-Entry updated: Size %d Bytes, Timestamp %d:%d:%d %d-%d-%d\n", file_entry->file_size, current_time.hour,
+		current_time.minute, current_time.second, current_date.day, current_date.month, current_date.year);
+	return 0;
+};
+
+/**
+ * fsync/close barrier, the drive cache holds the writes of every file so the whole device is flushed.
+ */
+int32_t fat16_sync(ata_t* dev, void* internal)
+{
+	if (!dev || !internal) {
+		return -EINVAL;
+	};
+	return ata_flush(dev);
 };
 
 int32_t fat16_readdir(ata_t* dev, void* internal, vfs_dirent_t* dir, uint32_t dir_offset)
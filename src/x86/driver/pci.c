@@ -16,8 +16,10 @@
 
 /* PUBLIC API */
 uint16_t pci_read16(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset);
+uint32_t pci_read32(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset);
 void pci_write16(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset, const uint16_t data);
 void pci_enumerate_bus(void);
+bool pci_find_class(pci_dev_t* dev, const uint8_t class_code, const uint8_t subclass);
 
 /* INTERNAL API */
 static inline uint32_t _build_config_addr(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset);
@@ -36,6 +38,13 @@ uint16_t pci_read16(const uint32_t bus, const uint32_t device, const uint32_t fu
 	return (inl(PCI_CONFIG_DATA) >> ((offset & 2) * 8)) & 0xFFFF;
 };
 
+uint32_t pci_read32(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset)
+{
+	const uint32_t config_address = _build_config_addr(bus, device, function, offset);
+	outl(PCI_CONFIG_ADDR, config_address);
+	return inl(PCI_CONFIG_DATA);
+};
+
 void pci_write16(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset, const uint16_t data)
 {
 	const uint32_t config_address = _build_config_addr(bus, device, function, offset);
@@ -104,4 +113,21 @@ void pci_enumerate_bus(void)
 		};
 	};
 	return;
+};
+
+// Fills dev with the first function of the given class/subclass, bus 0 holds everything on QEMU/PC chipsets
+bool pci_find_class(pci_dev_t* dev, const uint8_t class_code, const uint8_t subclass)
+{
+	for (size_t bus = 0; bus < 256; ++bus) {
+		for (size_t device = 0; device < 32; ++device) {
+			for (size_t function = 0; function < 8; ++function) {
+				_populate_dev(dev, bus, device, function);
+
+				if (dev->vendor_id != PCI_DEV_NOT_FOUND && dev->class_code == class_code && dev->subclass == subclass) {
+					return true;
+				};
+			};
+		};
+	};
+	return false;
 };
\ No newline at end of file
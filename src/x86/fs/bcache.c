@@ -0,0 +1,415 @@
+/**
+ * @file bcache.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Block buffer cache between the streams and the ATA driver
+ *
+ * Sectors are cached by (device, LBA) in a hash table, a miss reuses the least recently used
+ * buffer that is not pinned. The cache is write-through: bcache_write hands the sector to the
+ * drive right away, so the disk is never older than a cached copy and long reads may go past
+ * the cache. When the data is durable is still up to the write barriers (ata_flush).
+ */
+
+#include "bcache.h"
+#include "errno.h"
+#include "heap.h"
+#include "idt.h"
+#include "kernel.h"
+#include "string.h"
+
+bcache_t bcache = {
+    .bufs = 0x0,
+    .data = 0x0,
+    .buckets = {0},
+    .lru_head = 0x0,
+    .lru_tail = 0x0,
+    .hits = 0,
+    .misses = 0,
+    .evictions = 0,
+    .bypassed = 0,
+};
+
+/* PUBLIC API */
+void bcache_init(bcache_t* self);
+bcache_buf_t* bcache_get(ata_t* dev, const uint32_t lba);
+void bcache_put(bcache_buf_t* buf);
+int32_t bcache_write(bcache_buf_t* buf);
+int32_t bcache_overwrite(ata_t* dev, const uint32_t lba, const uint8_t* data);
+int32_t bcache_read(ata_t* dev, const uint32_t lba, const size_t count, uint8_t* buffer);
+void bcache_dump(const bcache_t* self);
+
+/* INTERNAL API */
+static inline uint32_t _bucket(const ata_t* dev, const uint32_t lba);
+static bcache_buf_t* _lookup(bcache_t* self, const ata_t* dev, const uint32_t lba);
+static void _hash_insert(bcache_t* self, bcache_buf_t* buf, ata_t* dev, const uint32_t lba);
+static void _hash_remove(bcache_t* self, bcache_buf_t* buf);
+static void _lru_remove(bcache_t* self, bcache_buf_t* buf);
+static void _lru_push(bcache_t* self, bcache_buf_t* buf, const bool head);
+static bcache_buf_t* _evict(bcache_t* self);
+static void _release(bcache_t* self, bcache_buf_t* buf);
+static void _fill(bcache_t* self, ata_t* dev, const uint32_t lba, const uint8_t* data);
+
+// Consecutive sectors land in consecutive buckets
+static inline uint32_t _bucket(const ata_t* dev, const uint32_t lba) { return (lba ^ ((uintptr_t)dev >> 4)) & BCACHE_BUCKET_MASK; };
+
+static bcache_buf_t* _lookup(bcache_t* self, const ata_t* dev, const uint32_t lba)
+{
+	for (bcache_buf_t* buf = self->buckets[_bucket(dev, lba)]; buf; buf = buf->hash_next) {
+		if (buf->dev == dev && buf->lba == lba) {
+			return buf;
+		};
+	};
+	return 0x0;
+};
+
+static void _hash_insert(bcache_t* self, bcache_buf_t* buf, ata_t* dev, const uint32_t lba)
+{
+	bcache_buf_t** bucket = &self->buckets[_bucket(dev, lba)];
+	buf->dev = dev;
+	buf->lba = lba;
+	buf->flags = BCACHE_VALID;
+	buf->hash_next = *bucket;
+	*bucket = buf;
+	return;
+};
+
+static void _hash_remove(bcache_t* self, bcache_buf_t* buf)
+{
+	bcache_buf_t** link = &self->buckets[_bucket(buf->dev, buf->lba)];
+
+	while (*link && *link != buf) {
+		link = &(*link)->hash_next;
+	};
+
+	if (*link) {
+		*link = buf->hash_next;
+	};
+	buf->hash_next = 0x0;
+	buf->flags = 0;
+	return;
+};
+
+static void _lru_remove(bcache_t* self, bcache_buf_t* buf)
+{
+	if (buf->lru_prev) {
+		buf->lru_prev->lru_next = buf->lru_next;
+	} else {
+		self->lru_head = buf->lru_next;
+	};
+
+	if (buf->lru_next) {
+		buf->lru_next->lru_prev = buf->lru_prev;
+	} else {
+		self->lru_tail = buf->lru_prev;
+	};
+	buf->lru_prev = 0x0;
+	buf->lru_next = 0x0;
+	return;
+};
+
+// head = just used, tail = reused first (buffers without valid data)
+static void _lru_push(bcache_t* self, bcache_buf_t* buf, const bool head)
+{
+	if (head) {
+		buf->lru_next = self->lru_head;
+
+		if (self->lru_head) {
+			self->lru_head->lru_prev = buf;
+		};
+		self->lru_head = buf;
+
+		if (!self->lru_tail) {
+			self->lru_tail = buf;
+		};
+	} else {
+		buf->lru_prev = self->lru_tail;
+
+		if (self->lru_tail) {
+			self->lru_tail->lru_next = buf;
+		};
+		self->lru_tail = buf;
+
+		if (!self->lru_head) {
+			self->lru_head = buf;
+		};
+	};
+	return;
+};
+
+/**
+ * @brief The least recently used buffer that is not pinned, out of the hash table.
+ * @return The buffer (not pinned yet) or 0x0 if every buffer is pinned
+ */
+static bcache_buf_t* _evict(bcache_t* self)
+{
+	for (bcache_buf_t* buf = self->lru_tail; buf; buf = buf->lru_prev) {
+		if (buf->pins) {
+			continue;
+		};
+
+		if (buf->flags & BCACHE_VALID) {
+			_hash_remove(self, buf);
+			self->evictions++;
+		};
+		return buf;
+	};
+	return 0x0;
+};
+
+// Drops a buffer that never made it into the hash table, it is reused first
+static void _release(bcache_t* self, bcache_buf_t* buf)
+{
+	buf->pins = 0;
+	_lru_remove(self, buf);
+	_lru_push(self, buf, false);
+	return;
+};
+
+// Caches a sector read past bcache_get, a copy that is already cached is at least as new
+static void _fill(bcache_t* self, ata_t* dev, const uint32_t lba, const uint8_t* data)
+{
+	if (_lookup(self, dev, lba)) {
+		return;
+	};
+	bcache_buf_t* buf = _evict(self);
+
+	if (!buf) {
+		return;
+	};
+	memcpy(buf->data, data, BCACHE_BLOCK_SIZE);
+	_hash_insert(self, buf, dev, lba);
+	_lru_remove(self, buf);
+	_lru_push(self, buf, true);
+	return;
+};
+
+/**
+ * @brief Allocates BCACHE_BUFFERS buffers, all of them empty at the eviction end of the list.
+ */
+void bcache_init(bcache_t* self)
+{
+	self->bufs = kzalloc(BCACHE_BUFFERS * sizeof(bcache_buf_t));
+	self->data = kzalloc(BCACHE_BUFFERS * BCACHE_BLOCK_SIZE);
+
+	if (!self->bufs || !self->data) {
+		panic("[CRITICAL] Failed to allocate the Buffer Cache.\n");
+	};
+
+	for (size_t i = 0; i < BCACHE_BUFFERS; i++) {
+		bcache_buf_t* buf = &self->bufs[i];
+		buf->data = self->data + i * BCACHE_BLOCK_SIZE;
+		_lru_push(self, buf, false);
+	};
+	kprintf("[BCACHE] %d Buffers of %d Bytes, %d Buckets\n", BCACHE_BUFFERS, BCACHE_BLOCK_SIZE, BCACHE_BUCKETS);
+	return;
+};
+
+/**
+ * @brief Pins the buffer of sector lba, it is read from the disk on a miss.
+ *
+ * The data stays valid and in place until bcache_put. Changes go to the disk with bcache_write.
+ * @return The pinned buffer or 0x0 on a read error or when every buffer is pinned
+ */
+bcache_buf_t* bcache_get(ata_t* dev, const uint32_t lba)
+{
+	if (!dev || dev->sector_size != BCACHE_BLOCK_SIZE) {
+		return 0x0;
+	};
+	uint32_t eflags = asm_irq_save();
+	bcache_buf_t* buf = _lookup(&bcache, dev, lba);
+
+	if (buf) {
+		buf->pins++;
+		bcache.hits++;
+		asm_irq_restore(eflags);
+		return buf;
+	};
+	buf = _evict(&bcache);
+
+	if (!buf) {
+		asm_irq_restore(eflags);
+		kprintf("[BCACHE] ERROR: Every Buffer is pinned\n");
+		return 0x0;
+	};
+	// Pinned and out of the hash table, nobody touches the buffer while the read sleeps
+	buf->pins = 1;
+	asm_irq_restore(eflags);
+	const int32_t res = ata_read_into(dev, lba, 1, buf->data);
+	eflags = asm_irq_save();
+
+	if (res < 0) {
+		_release(&bcache, buf);
+		asm_irq_restore(eflags);
+		return 0x0;
+	};
+	bcache_buf_t* raced = _lookup(&bcache, dev, lba);
+
+	// Another task cached the sector in the meantime, its copy may already be newer
+	if (raced) {
+		_release(&bcache, buf);
+		raced->pins++;
+		bcache.hits++;
+		asm_irq_restore(eflags);
+		return raced;
+	};
+	_hash_insert(&bcache, buf, dev, lba);
+	bcache.misses++;
+	asm_irq_restore(eflags);
+	return buf;
+};
+
+/**
+ * @brief Unpins a buffer from bcache_get, it becomes the most recently used one.
+ */
+void bcache_put(bcache_buf_t* buf)
+{
+	if (!buf) {
+		return;
+	};
+	const uint32_t eflags = asm_irq_save();
+
+	if (buf->pins) {
+		buf->pins--;
+	};
+	_lru_remove(&bcache, buf);
+	_lru_push(&bcache, buf, buf->flags & BCACHE_VALID);
+	asm_irq_restore(eflags);
+	return;
+};
+
+/**
+ * @brief Writes a pinned buffer through to the disk.
+ *
+ * On failure nobody knows what reached the disk, the buffer leaves the cache and the next
+ * bcache_get reads the sector again.
+ * @return 0, -EINVAL or -EIO
+ */
+int32_t bcache_write(bcache_buf_t* buf)
+{
+	if (!buf || !(buf->flags & BCACHE_VALID)) {
+		return -EINVAL;
+	};
+	const int32_t res = ata_write(buf->dev, buf->lba, 1, buf->data);
+
+	if (res < 0) {
+		const uint32_t eflags = asm_irq_save();
+
+		if (buf->flags & BCACHE_VALID) {
+			_hash_remove(&bcache, buf);
+		};
+		asm_irq_restore(eflags);
+		return -EIO;
+	};
+	return 0;
+};
+
+/**
+ * @brief Writes a whole sector through the cache without reading it from the disk first.
+ *
+ * A cached copy is overwritten in place, a missing sector gets a buffer that is filled before
+ * anyone can look it up (nothing sleeps in between).
+ * @return 0, -EINVAL or -EIO
+ */
+int32_t bcache_overwrite(ata_t* dev, const uint32_t lba, const uint8_t* data)
+{
+	if (!dev || !data || dev->sector_size != BCACHE_BLOCK_SIZE) {
+		return -EINVAL;
+	};
+	const uint32_t eflags = asm_irq_save();
+	bcache_buf_t* buf = _lookup(&bcache, dev, lba);
+
+	if (buf) {
+		bcache.hits++;
+	} else {
+		buf = _evict(&bcache);
+
+		if (!buf) {
+			asm_irq_restore(eflags);
+			kprintf("[BCACHE] ERROR: Every Buffer is pinned\n");
+			return -EIO;
+		};
+		_hash_insert(&bcache, buf, dev, lba);
+	};
+	buf->pins++;
+	memcpy(buf->data, data, BCACHE_BLOCK_SIZE);
+	asm_irq_restore(eflags);
+	const int32_t res = bcache_write(buf);
+	bcache_put(buf);
+	return res;
+};
+
+/**
+ * @brief Copies count sectors starting at lba into buffer.
+ *
+ * Cached sectors come from memory, each run of missing ones is read with one command straight
+ * into the caller's buffer and copied into the cache afterwards. Reads longer than
+ * BCACHE_BYPASS_BLOCKS (file data) go to the disk without evicting anything.
+ * @return 0, -EINVAL or -EIO
+ */
+int32_t bcache_read(ata_t* dev, const uint32_t lba, const size_t count, uint8_t* buffer)
+{
+	if (!dev || !buffer || dev->sector_size != BCACHE_BLOCK_SIZE) {
+		return -EINVAL;
+	};
+
+	if (count > BCACHE_BYPASS_BLOCKS) {
+		bcache.bypassed += count;
+		return ata_read_into(dev, lba, count, buffer) < 0 ? -EIO : 0;
+	};
+
+	for (size_t i = 0; i < count;) {
+		uint32_t eflags = asm_irq_save();
+		bcache_buf_t* buf = _lookup(&bcache, dev, lba + i);
+
+		if (buf) {
+			memcpy(buffer + i * BCACHE_BLOCK_SIZE, buf->data, BCACHE_BLOCK_SIZE);
+			_lru_remove(&bcache, buf);
+			_lru_push(&bcache, buf, true);
+			bcache.hits++;
+			asm_irq_restore(eflags);
+			i++;
+			continue;
+		};
+		size_t run = 1;
+
+		while (i + run < count && !_lookup(&bcache, dev, lba + i + run)) {
+			run++;
+		};
+		asm_irq_restore(eflags);
+
+		if (ata_read_into(dev, lba + i, run, buffer + i * BCACHE_BLOCK_SIZE) < 0) {
+			return -EIO;
+		};
+		eflags = asm_irq_save();
+
+		for (size_t j = i; j < i + run; j++) {
+			_fill(&bcache, dev, lba + j, buffer + j * BCACHE_BLOCK_SIZE);
+		};
+		bcache.misses += run;
+		asm_irq_restore(eflags);
+		i += run;
+	};
+	return 0;
+};
+
+void bcache_dump(const bcache_t* self)
+{
+	const uint32_t lookups = self->hits + self->misses;
+	size_t used = 0, pinned = 0;
+
+	for (size_t i = 0; i < BCACHE_BUFFERS; i++) {
+		used += (self->bufs[i].flags & BCACHE_VALID) ? 1 : 0;
+		pinned += self->bufs[i].pins ? 1 : 0;
+	};
+	kprintf("\n====================================\n");
+	kprintf("           BUFFER CACHE DUMP        \n");
+	kprintf("====================================\n");
+	kprintf("Buffers Used:             %d / %d\n", used, BCACHE_BUFFERS);
+	kprintf("Buffers Pinned:           %d\n", pinned);
+	kprintf("Hits:                     %d\n", self->hits);
+	kprintf("Misses:                   %d\n", self->misses);
+	kprintf("Hit Rate:                 %d%%\n", lookups ? self->hits * 100 / lookups : 0);
+	kprintf("Evictions:                %d\n", self->evictions);
+	kprintf("Bypassed Blocks:          %d\n", self->bypassed);
+	return;
+};
\ No newline at end of file
@@ -0,0 +1,212 @@
+/**
+ * @file pipe.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Anonymous pipes, an in-memory fs_t behind pipe() descriptors
+ *
+ * Readers sleep on WAIT_PIPE while the buffer is empty, writers while it is full. Every transfer
+ * and every close wakes WAIT_PIPE (and WAIT_POLL), the sleepers check their pipe again.
+ */
+
+#include "pipe.h"
+#include "errno.h"
+#include "heap.h"
+#include "string.h"
+#include "vfs.h"
+#include "wq.h"
+
+/* PUBLIC API */
+pipe_t* pipe_create(void);
+pipe_end_t* pipe_open(pipe_t* self, const fd_t* file, const bool writer);
+size_t pipe_read(ata_t* dev, void* internal, uint8_t* buffer, size_t n_bytes, size_t n_blocks);
+size_t pipe_write(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks);
+int32_t pipe_close(void* internal);
+int16_t pipe_poll(void* internal, const int16_t events);
+
+/* INTERNAL API */
+static inline uint32_t _used(const pipe_t* self);
+static void _wakeup(void);
+
+fs_t pipe_fs = {
+    .resolve_cb = 0x0,
+    .open_cb = 0x0,
+    .read_cb = pipe_read,
+    .close_cb = pipe_close,
+    .stat_cb = 0x0,
+    .seek_cb = 0x0,
+    .write_cb = pipe_write,
+    .readdir_cb = 0x0,
+    .pread_cb = 0x0,
+    .pwrite_cb = 0x0,
+    .poll_cb = pipe_poll,
+    .map_cb = 0x0,
+    .sync_cb = 0x0,
+    .name = "PIPE",
+};
+
+static inline uint32_t _used(const pipe_t* self) { return self->head - self->tail; };
+
+static void _wakeup(void)
+{
+	wq_wakeup(WAIT_PIPE);
+	wq_wakeup(WAIT_POLL);
+	return;
+};
+
+pipe_t* pipe_create(void)
+{
+	pipe_t* self = kzalloc(sizeof(pipe_t));
+
+	if (!self) {
+		return 0x0;
+	};
+	self->buffer = kzalloc(PIPE_BUFFER_SIZE);
+
+	if (!self->buffer) {
+		kfree(self);
+		return 0x0;
+	};
+	return self;
+};
+
+/**
+ * @brief Creates one end of the pipe, the pipe is freed when the last end is closed.
+ */
+pipe_end_t* pipe_open(pipe_t* self, const fd_t* file, const bool writer)
+{
+	pipe_end_t* end = kzalloc(sizeof(pipe_end_t));
+
+	if (!end) {
+		return 0x0;
+	};
+	end->pipe = self;
+	end->file = file;
+	end->writer = writer;
+
+	if (writer) {
+		self->writers++;
+	} else {
+		self->readers++;
+	};
+	return end;
+};
+
+/**
+ * @brief Reads what is there (at most n_bytes), sleeps only while the pipe is empty.
+ * @return Bytes read, 0 at EOF (no writer left), -EAGAIN for an empty non-blocking end
+ */
+size_t pipe_read(ata_t* dev, void* internal, uint8_t* buffer, size_t n_bytes, size_t n_blocks)
+{
+	pipe_end_t* end = internal;
+	pipe_t* self = end->pipe;
+	const size_t count = n_bytes * n_blocks;
+
+	if (end->writer) {
+		return -EBADF;
+	};
+
+	while (!_used(self)) {
+		if (!self->writers) {
+			return 0;
+		};
+
+		if (end->file->flags & VFS_NONBLOCK) {
+			return -EAGAIN;
+		};
+		wq_sleep(WAIT_PIPE);
+	};
+	const size_t n = (count < _used(self)) ? count : _used(self);
+
+	for (size_t i = 0; i < n; i++) {
+		buffer[i] = self->buffer[self->tail & PIPE_BUFFER_MASK];
+		self->tail++;
+	};
+	_wakeup();
+	return n;
+};
+
+/**
+ * @brief Writes all n_bytes, sleeping whenever the pipe is full.
+ * @return Bytes written, short (or -EAGAIN) only for a non-blocking end, -EPIPE without a reader
+ */
+size_t pipe_write(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks)
+{
+	pipe_end_t* end = internal;
+	pipe_t* self = end->pipe;
+	const size_t count = n_bytes * n_blocks;
+	size_t done = 0;
+
+	if (!end->writer) {
+		return -EBADF;
+	};
+
+	while (done < count) {
+		if (!self->readers) {
+			return done ? done : (size_t)-EPIPE;
+		};
+		const uint32_t space = PIPE_BUFFER_SIZE - _used(self);
+
+		if (!space) {
+			if (end->file->flags & VFS_NONBLOCK) {
+				return done ? done : (size_t)-EAGAIN;
+			};
+			wq_sleep(WAIT_PIPE);
+			continue;
+		};
+		const size_t n = (count - done < space) ? count - done : space;
+
+		for (size_t i = 0; i < n; i++) {
+			self->buffer[self->head & PIPE_BUFFER_MASK] = buffer[done + i];
+			self->head++;
+		};
+		done += n;
+		_wakeup();
+	};
+	return done;
+};
+
+int32_t pipe_close(void* internal)
+{
+	pipe_end_t* end = internal;
+	pipe_t* self = end->pipe;
+
+	if (end->writer) {
+		self->writers--;
+	} else {
+		self->readers--;
+	};
+	kfree(end);
+
+	if (!self->readers && !self->writers) {
+		kfree(self->buffer);
+		kfree(self);
+		return 0;
+	};
+	// Readers see EOF, writers see -EPIPE
+	_wakeup();
+	return 0;
+};
+
+int16_t pipe_poll(void* internal, const int16_t events)
+{
+	const pipe_end_t* end = internal;
+	const pipe_t* self = end->pipe;
+	int16_t ready = 0;
+
+	if (end->writer) {
+		if (!self->readers) {
+			ready |= POLLERR;
+		} else if (_used(self) < PIPE_BUFFER_SIZE) {
+			ready |= POLLOUT;
+		};
+	} else {
+		if (_used(self)) {
+			ready |= POLLIN;
+		};
+
+		if (!self->writers) {
+			ready |= POLLHUP;
+		};
+	};
+	return ready;
+};
\ No newline at end of file
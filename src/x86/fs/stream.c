@@ -7,12 +7,14 @@
  */
 
 #include "stream.h"
+#include "bcache.h"
 #include "string.h"
 
 /* PUBLIC API */
 void stream_init(stream_t* self, ata_t* dev);
 void stream_seek(stream_t* self, const size_t pos);
 int32_t stream_read(stream_t* self, uint8_t* buffer, const size_t n_bytes);
+int32_t stream_write(stream_t* self, const uint8_t* buffer, const size_t n_bytes);
 
 void stream_init(stream_t* self, ata_t* dev)
 {
@@ -27,6 +29,12 @@ void stream_seek(stream_t* self, const size_t pos)
 	return;
 };
 
+/**
+ * @brief Reads n_bytes at the stream position through the buffer cache.
+ *
+ * Whole sectors at a sector aligned position are copied with one bcache_read (misses in a row
+ * are one command), only a partial head or tail pins a single cached sector.
+ */
 int32_t stream_read(stream_t* self, uint8_t* buffer, const size_t n_bytes)
 {
 	if (!buffer) {
@@ -34,26 +42,42 @@ int32_t stream_read(stream_t* self, uint8_t* buffer, const size_t n_bytes)
 	};
 	const size_t block_size = self->dev->sector_size;
 	size_t remaining_bytes = n_bytes;
-	size_t read_size = n_bytes > block_size ? block_size : n_bytes;
 
 	while (remaining_bytes) {
 		const size_t lba_block = self->pos / block_size;
 		const size_t offset = self->pos % block_size;
+		size_t read_size = 0;
 
-		if (ata_read(self->dev, lba_block, 1) < 0) {
-			return -EIO;
-		};
-		read_size = remaining_bytes > block_size ? block_size : remaining_bytes;
+		if (!offset && remaining_bytes >= block_size) {
+			const size_t blocks = remaining_bytes / block_size;
+
+			if (bcache_read(self->dev, lba_block, blocks, buffer) < 0) {
+				return -EIO;
+			};
+			read_size = blocks * block_size;
+		} else {
+			bcache_buf_t* buf = bcache_get(self->dev, lba_block);
 
-		for (size_t i = 0; i < read_size; i++) {
-			*buffer++ = self->dev->buffer[offset + i];
+			if (!buf) {
+				return -EIO;
+			};
+			// Never past the end of the sector, the rest comes from the next one
+			read_size = remaining_bytes > block_size - offset ? block_size - offset : remaining_bytes;
+			memcpy(buffer, buf->data + offset, read_size);
+			bcache_put(buf);
 		};
+		buffer += read_size;
 		self->pos += read_size;
 		remaining_bytes -= read_size;
 	};
 	return 0;
 };
 
+/**
+ * @brief Writes n_bytes at the stream position, sector by sector through the buffer cache.
+ *
+ * The cached sector is patched and written through, so a following read is served from memory.
+ */
 int32_t stream_write(stream_t* self, const uint8_t* buffer, const size_t n_bytes)
 {
 	if (!self || !buffer) {
@@ -61,24 +85,33 @@ int32_t stream_write(stream_t* self, const uint8_t* buffer, const size_t n_bytes
 	};
 	const size_t block_size = self->dev->sector_size;
 	size_t remaining_bytes = n_bytes;
-	size_t write_size = n_bytes > block_size ? block_size : n_bytes;
 
 	while (remaining_bytes) {
 		const size_t lba_block = self->pos / block_size;
 		const size_t offset = self->pos % block_size;
+		// Never past the end of the sector, the rest goes to the next one
+		const size_t write_size = remaining_bytes > block_size - offset ? block_size - offset : remaining_bytes;
 
-		if (ata_read(self->dev, lba_block, 1) < 0) {
-			return -EIO;
-		};
-		write_size = remaining_bytes > block_size ? block_size : remaining_bytes;
+		// A whole sector replaces the old one, reading it first would be wasted
+		if (offset == 0 && write_size == block_size) {
+			if (bcache_overwrite(self->dev, lba_block, buffer) < 0) {
+				return -EIO;
+			};
+		} else {
+			bcache_buf_t* buf = bcache_get(self->dev, lba_block);
 
-		for (size_t i = 0; i < write_size; i++) {
-			self->dev->buffer[offset + i] = *buffer++;
-		};
+			if (!buf) {
+				return -EIO;
+			};
+			memcpy(buf->data + offset, buffer, write_size);
+			const int32_t res = bcache_write(buf);
+			bcache_put(buf);
 
-		if (ata_write(self->dev, lba_block, 1, self->dev->buffer) < 0) {
-			return -EIO;
+			if (res < 0) {
+				return -EIO;
+			};
 		};
+		buffer += write_size;
 		self->pos += write_size;
 		remaining_bytes -= write_size;
 	};
@@ -9,8 +9,11 @@
 #include "vfs.h"
 #include "fat16.h"
 #include "pathparser.h"
+#include "pipe.h"
+#include "task.h"
 
 extern fs_t fat16;
+extern fs_t pipe_fs;
 
 static fs_t* filesystems[8] = {};
 static fd_t* fdescriptors[512] = {};
@@ -26,6 +29,18 @@ int32_t vfs_fseek(const int32_t fd, const uint32_t offset, const uint8_t whence)
 int32_t vfs_fstat(const int32_t fd, vstat_t* buffer);
 size_t vfs_fwrite(const void* buffer, size_t n_bytes, size_t n_blocks, const int32_t fd);
 int32_t vfs_readdir(const int32_t fd, vfs_dirent_t* dir);
+size_t vfs_fpread(void* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset, const int32_t fd);
+size_t vfs_fpwrite(const void* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset, const int32_t fd);
+fd_t* vfs_fget(const int32_t fd);
+void vfs_fput(fd_t* file);
+size_t vfs_file_pread(fd_t* file, void* buffer, size_t n_bytes, const uint32_t offset);
+int16_t vfs_poll(const int32_t fd, const int16_t events);
+int32_t vfs_pipe(int32_t fds[2]);
+int32_t vfs_fattach(fs_t* fs, void* internal);
+int32_t vfs_get_flags(const int32_t fd);
+int32_t vfs_set_flags(const int32_t fd, const uint32_t flags);
+int32_t vfs_fsync(const int32_t fd);
+void vfs_close_all(const uint16_t pid);
 
 /* INTERNAL API */
 static fs_t** _find_empty_fs(void);
@@ -75,7 +90,10 @@ static int32_t _create_fd(fd_t** ptr)
 	for (size_t i = 0; i < 512; i++) {
 		if (fdescriptors[i] == 0x0) {
 			fd_t* fdescriptor = kzalloc(sizeof(fd_t));
+			const task_t* task = task_get_curr();
 			fdescriptor->index = i + 1;
+			fdescriptor->refs = 1;
+			fdescriptor->pid = (task && task->parent) ? task->parent->pid : 0;
 			fdescriptors[i] = fdescriptor;
 			*ptr = fdescriptor;
 			res = 0;
@@ -154,6 +172,7 @@ int32_t vfs_fopen(const char* filename, const char* mode)
 		return -ENOMEM;
 	};
 	fdescriptor->dev = dev;
+	fdescriptor->fs = dev->fs;
 	fdescriptor->internal = internal;
 	return fdescriptor->index;
 };
@@ -168,7 +187,11 @@ size_t vfs_fread(void* buffer, size_t n_bytes, size_t n_blocks, const int32_t fd
 	if (!fdescriptor) {
 		return -EINVAL;
 	};
-	const size_t total_read = fdescriptor->dev->fs->read_cb(fdescriptor->dev, fdescriptor->internal, buffer, n_bytes, n_blocks);
+
+	if (!fdescriptor->fs->read_cb) {
+		return -EINVAL;
+	};
+	const size_t total_read = fdescriptor->fs->read_cb(fdescriptor->dev, fdescriptor->internal, buffer, n_bytes, n_blocks);
 	return total_read;
 };
 
@@ -186,11 +209,42 @@ int32_t vfs_fclose(const int32_t fd)
 		res = -EBADF;
 		return res;
 	}
-	fdescriptor->dev->fs->close_cb(fdescriptor->internal);
-	kfree(fdescriptor);
+	// The number is free again right away, mappings may keep the file itself open
+	fdescriptors[fd - 1] = 0x0;
+	vfs_fput(fdescriptor);
 	return res;
 };
 
+/**
+ * @brief Takes a reference on an open file that outlives its descriptor number (mmap).
+ * @return The file or 0x0 for a bad descriptor, release it with vfs_fput
+ */
+fd_t* vfs_fget(const int32_t fd)
+{
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return 0x0;
+	};
+	fdescriptor->refs++;
+	return fdescriptor;
+};
+
+void vfs_fput(fd_t* file)
+{
+	if (!file || --file->refs) {
+		return;
+	};
+
+	// Close barrier, nothing written through this file stays in a volatile cache
+	if (file->fs->sync_cb) {
+		file->fs->sync_cb(file->dev, file->internal);
+	};
+	file->fs->close_cb(file->internal);
+	kfree(file);
+	return;
+};
+
 int32_t vfs_fseek(const int32_t fd, const uint32_t offset, const uint8_t whence)
 {
 	int32_t res = 0;
@@ -205,7 +259,11 @@ int32_t vfs_fseek(const int32_t fd, const uint32_t offset, const uint8_t whence)
 		res = -EBADF;
 		return res;
 	}
-	res = fdescriptor->dev->fs->seek_cb(fdescriptor->internal, offset, whence);
+
+	if (!fdescriptor->fs->seek_cb) {
+		return -ESPIPE;
+	};
+	res = fdescriptor->fs->seek_cb(fdescriptor->internal, offset, whence);
 	return res;
 };
 
@@ -223,7 +281,11 @@ int32_t vfs_fstat(const int32_t fd, vstat_t* buffer)
 		res = -EBADF;
 		return res;
 	}
-	fdescriptor->dev->fs->stat_cb(fdescriptor->dev, fdescriptor->internal, buffer);
+
+	if (!fdescriptor->fs->stat_cb) {
+		return -EIO;
+	};
+	fdescriptor->fs->stat_cb(fdescriptor->dev, fdescriptor->internal, buffer);
 	return res;
 };
 
@@ -238,10 +300,67 @@ size_t vfs_fwrite(const void* buffer, size_t n_bytes, size_t n_blocks, const int
 		return -EBADF;
 	};
 
-	if (!fdescriptor->dev->fs->write_cb) {
+	if (!fdescriptor->fs->write_cb) {
 		return -EIO;
 	};
-	const size_t total_written = fdescriptor->dev->fs->write_cb(fdescriptor->dev, fdescriptor->internal, buffer, n_bytes, n_blocks);
+	const size_t total_written = fdescriptor->fs->write_cb(fdescriptor->dev, fdescriptor->internal, buffer, n_bytes, n_blocks);
+	return total_written;
+};
+
+/**
+ * @brief Reads at offset without moving the file position (pread).
+ */
+size_t vfs_fpread(void* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset, const int32_t fd)
+{
+	if (fd < 1 || !buffer || n_bytes == 0 || n_blocks == 0) {
+		return -EINVAL;
+	};
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return -EBADF;
+	};
+
+	if (!fdescriptor->fs->pread_cb) {
+		return -ESPIPE;
+	};
+	const size_t total_read = fdescriptor->fs->pread_cb(fdescriptor->dev, fdescriptor->internal, buffer, n_bytes, n_blocks, offset);
+	return total_read;
+};
+
+/**
+ * @brief pread on a file held through vfs_fget, the descriptor number may be closed already.
+ */
+size_t vfs_file_pread(fd_t* file, void* buffer, size_t n_bytes, const uint32_t offset)
+{
+	if (!file || !buffer || n_bytes == 0) {
+		return -EINVAL;
+	};
+
+	if (!file->fs->pread_cb) {
+		return -ESPIPE;
+	};
+	return file->fs->pread_cb(file->dev, file->internal, buffer, n_bytes, 1, offset);
+};
+
+/**
+ * @brief Writes at offset without moving the file position or truncating the file (pwrite).
+ */
+size_t vfs_fpwrite(const void* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset, const int32_t fd)
+{
+	if (fd < 1 || !buffer || n_bytes == 0 || n_blocks == 0) {
+		return -EINVAL;
+	};
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return -EBADF;
+	};
+
+	if (!fdescriptor->fs->pwrite_cb) {
+		return -ESPIPE;
+	};
+	const size_t total_written = fdescriptor->fs->pwrite_cb(fdescriptor->dev, fdescriptor->internal, buffer, n_bytes, n_blocks, offset);
 	return total_written;
 };
 
@@ -257,13 +376,153 @@ int32_t vfs_readdir(const int32_t fd, vfs_dirent_t* dir)
 		return -EBADF;
 	};
 
-	if (!fdescriptor->dev->fs->readdir_cb) {
+	if (!fdescriptor->fs->readdir_cb) {
 		return -EIO;
 	};
-	const size_t res = fdescriptor->dev->fs->readdir_cb(fdescriptor->dev, fdescriptor->internal, dir, fdescriptor->dir_offset);
+	const size_t res = fdescriptor->fs->readdir_cb(fdescriptor->dev, fdescriptor->internal, dir, fdescriptor->dir_offset);
 
 	if (res > 0) {
 		fdescriptor->dir_offset++;
 	};
 	return res;
+};
+
+/**
+ * @brief Readiness of a descriptor for poll(), the fs only reports what can change.
+ * @return The ready bits out of events, plus POLLERR / POLLHUP, POLLNVAL for a bad descriptor
+ */
+int16_t vfs_poll(const int32_t fd, const int16_t events)
+{
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return POLLNVAL;
+	};
+
+	if (!fdescriptor->fs->poll_cb) {
+		return events & (POLLIN | POLLOUT);
+	};
+	const int16_t ready = fdescriptor->fs->poll_cb(fdescriptor->internal, events);
+	return ready & (events | POLLERR | POLLHUP);
+};
+
+int32_t vfs_get_flags(const int32_t fd)
+{
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return -EBADF;
+	};
+	return fdescriptor->flags;
+};
+
+/**
+ * @brief F_SETFL, only VFS_NONBLOCK can be changed on an open descriptor.
+ */
+int32_t vfs_set_flags(const int32_t fd, const uint32_t flags)
+{
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return -EBADF;
+	};
+	fdescriptor->flags = (fdescriptor->flags & ~VFS_NONBLOCK) | (flags & VFS_NONBLOCK);
+	return 0;
+};
+
+/**
+ * @brief Returns once everything written to fd is on the medium.
+ * @return 0, -EBADF, -EINVAL for files without a cache (pipes) or -EIO
+ */
+int32_t vfs_fsync(const int32_t fd)
+{
+	fd_t* fdescriptor = _get_fd(fd);
+
+	if (!fdescriptor) {
+		return -EBADF;
+	};
+
+	if (!fdescriptor->fs->sync_cb) {
+		return -EINVAL;
+	};
+	return fdescriptor->fs->sync_cb(fdescriptor->dev, fdescriptor->internal);
+};
+
+/**
+ * @brief Creates a pipe, fds[0] is the read end and fds[1] the write end.
+ * @return 0 or a negative errno, no descriptor is left open on failure
+ */
+int32_t vfs_pipe(int32_t fds[2])
+{
+	pipe_t* pipe = pipe_create();
+
+	if (!pipe) {
+		return -ENOMEM;
+	};
+	fd_t* ends[2] = {};
+
+	for (size_t i = 0; i < 2; i++) {
+		if (_create_fd(&ends[i]) < 0) {
+			break;
+		};
+		ends[i]->fs = &pipe_fs;
+		ends[i]->internal = pipe_open(pipe, ends[i], i == 1);
+
+		if (!ends[i]->internal) {
+			fdescriptors[ends[i]->index - 1] = 0x0;
+			kfree(ends[i]);
+			ends[i] = 0x0;
+			break;
+		};
+	};
+
+	if (!ends[0] || !ends[1]) {
+		// Closing the last end frees the pipe
+		if (ends[0]) {
+			vfs_fclose(ends[0]->index);
+		} else {
+			kfree(pipe->buffer);
+			kfree(pipe);
+		};
+		return -EMFILE;
+	};
+	fds[0] = ends[0]->index;
+	fds[1] = ends[1]->index;
+	return 0;
+};
+
+/**
+ * @brief Creates a descriptor for an object that lives outside any disk (shm), dev stays 0x0.
+ * @return The descriptor, closing it hands internal to fs->close_cb
+ */
+int32_t vfs_fattach(fs_t* fs, void* internal)
+{
+	fd_t* fdescriptor = 0x0;
+
+	if (!fs || _create_fd(&fdescriptor) < 0) {
+		return -EMFILE;
+	};
+	fdescriptor->fs = fs;
+	fdescriptor->internal = internal;
+	return fdescriptor->index;
+};
+
+/**
+ * @brief Closes every descriptor pid opened and left open, called when the process is reaped.
+ *
+ * The table is shared by all processes, without this a pipe end stays open (no EOF for the
+ * reader) and shm objects are never released.
+ */
+void vfs_close_all(const uint16_t pid)
+{
+	if (!pid) {
+		return;
+	};
+
+	for (size_t i = 0; i < 512; i++) {
+		if (fdescriptors[i] && fdescriptors[i]->pid == pid) {
+			vfs_fclose(i + 1);
+		};
+	};
+	return;
 };
\ No newline at end of file
@@ -11,10 +11,18 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "coro.h"
 #include "icarius.h"
 
 typedef struct fs fs_t;
 
+// Physical region descriptor, the bus master walks a table of these (4 byte aligned, no 64 KiB crossing)
+typedef struct ata_prd {
+	uint32_t phys_addr; // Start of the region
+	uint16_t size;	    // Byte count, 0 = 64 KiB
+	uint16_t flags;	    // ATA_PRD_EOT on the last entry
+} __attribute__((packed)) ata_prd_t;
+
 typedef struct ata {
 	char dev[2];		// Type of the ATA device
 	uint16_t sector_size;	// Size of a sector in bytes
@@ -23,12 +31,41 @@ typedef struct ata {
 	uint8_t buffer[512];	// Data buffer for temporary storage
 	fs_t* fs;		// fs_t mapped to the disk
 	uint8_t features;
+	uint8_t multiple; // Sectors per READ/WRITE MULTIPLE block, 0 = one interrupt per sector
+	volatile bool busy;		// A command is in flight, owned by a synchronous caller or a coroutine
+	uint16_t bm_base;		// Bus master I/O base (BAR4), 0x0 = no DMA, PIO only
+	ata_prd_t* prdt;		// PRD table, start of the DMA frame
+	uint8_t* dma_buffer;		// Bounce buffer behind the table, ATA_DMA_BUFFER_SIZE bytes
+	uint32_t dma_phys;		// Physical address of the DMA frame
+	volatile bool irq_pending;	// Set by _arm_irq, cleared by IRQ14 or the timeout
+	volatile bool irq_timeout;	// The armed interrupt did not come within ATA_TIMEOUT_MS
+	volatile uint8_t irq_status;	// ATA status read by the IRQ handler
+	uint64_t irq_deadline;		// Tick at which ata_tick gives up on the armed interrupt
+	uint32_t irq_spins;		// Polls so far when interrupts are off (boot)
+	coro_t* irq_coro;		// Coroutine to wake, 0x0 = a task sleeps on WAIT_ATA
+	bool dirty;			// Writes since the last cache flush, see ata_flush
+	bool word_io;			// PIO reads with one inw per word, benchmark baseline, see ata_set_mode
 } ata_t;
 
+typedef struct ata_request {
+	ata_t* dev;	 // Target device
+	uint64_t lba;	 // First sector
+	uint16_t count;	 // Number of sectors, one command at most (256 on LBA28 drives)
+	uint8_t* buffer; // count * sector_size bytes
+	uint16_t done;	 // Sectors transferred so far
+	int32_t status;	 // Last interrupt status, kept here because coroutine locals do not survive a yield
+} ata_request_t;
+
 void ata_init(ata_t* self);
 void ata_mount_fs(ata_t* self);
 ata_t* ata_get(const char dev[2]);
 int32_t ata_read(ata_t* self, const size_t start_block, const size_t n_blocks);
+int32_t ata_read_into(ata_t* self, const size_t lba, const size_t count, uint8_t* buffer);
 int32_t ata_write(ata_t* self, const size_t start_block, const size_t n_blocks, const uint8_t* buffer);
+int32_t ata_flush(ata_t* self);
+void ata_set_mode(ata_t* self, const uint16_t bm_base, const uint8_t multiple, const bool word_io);
+coro_step_t ata_read_coro(coro_t* self);
+void ata_irq(ata_t* self);
+void ata_tick(ata_t* self, const uint64_t now);
 
 #endif
\ No newline at end of file
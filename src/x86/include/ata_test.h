@@ -10,6 +10,10 @@
 #include "ata.h"
 #include "string.h"
 
+#define ATA_BENCH_SECTORS 512 // 256 KiB per run
+
 void test_ata_write(ata_t* dev);
+void test_ata_coro_read(ata_t* dev);
+void test_ata_throughput(ata_t* dev);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * @file bcache.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ata.h"
+#include "icarius.h"
+
+/**
+ * One cached sector. A buffer is on the LRU list all the time and in a hash bucket while it is
+ * BCACHE_VALID. Pinned buffers (pins > 0) are never evicted, their data stays where it is.
+ */
+typedef struct bcache_buf {
+	ata_t* dev;
+	uint32_t lba;
+	uint16_t flags;			// BCACHE_VALID
+	uint16_t pins;			// bcache_get without bcache_put
+	uint8_t* data;			// BCACHE_BLOCK_SIZE bytes
+	struct bcache_buf* hash_next;	// Next buffer in the same bucket
+	struct bcache_buf* lru_prev;	// Towards the most recently used buffer
+	struct bcache_buf* lru_next;	// Towards the eviction end
+} bcache_buf_t;
+
+typedef struct bcache {
+	bcache_buf_t* bufs;		      // BCACHE_BUFFERS headers
+	uint8_t* data;			      // BCACHE_BUFFERS * BCACHE_BLOCK_SIZE bytes
+	bcache_buf_t* buckets[BCACHE_BUCKETS];
+	bcache_buf_t* lru_head;		      // Most recently used
+	bcache_buf_t* lru_tail;		      // Evicted first
+	uint32_t hits;			      // Blocks served from memory
+	uint32_t misses;		      // Blocks read from the disk into the cache
+	uint32_t evictions;		      // Valid buffers reused for another block
+	uint32_t bypassed;		      // Blocks of long reads that went past the cache
+} bcache_t;
+
+void bcache_init(bcache_t* self);
+bcache_buf_t* bcache_get(ata_t* dev, const uint32_t lba);
+void bcache_put(bcache_buf_t* buf);
+int32_t bcache_write(bcache_buf_t* buf);
+int32_t bcache_overwrite(ata_t* dev, const uint32_t lba, const uint8_t* data);
+int32_t bcache_read(ata_t* dev, const uint32_t lba, const size_t count, uint8_t* buffer);
+void bcache_dump(const bcache_t* self);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+/**
+ * @file clock.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Time page shared read-only with every process (libc clock_gettime reads it without a syscall)
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#include "icarius.h"
+
+/**
+ * Written by the timer interrupt only. seq is odd while an update is in progress,
+ * readers retry until they saw the same even seq before and after.
+ * Time since boot = mono_sec/mono_nsec + ((rdtsc - tsc_tick) * tsc_mult >> tsc_shift) ns,
+ * the TSC part stays below tick_nsec so the next tick never moves the clock backwards.
+ */
+typedef struct clock_page {
+	volatile uint32_t seq;
+	uint32_t hz;	     // Timer frequency
+	uint64_t ticks;	     // Timer ticks since boot
+	uint64_t tsc_tick;   // TSC at the last tick
+	uint32_t tsc_mult;   // 0 until the TSC is calibrated (tick resolution only)
+	uint32_t tsc_shift;  // ns = cycles * tsc_mult >> tsc_shift
+	uint32_t mono_sec;   // Time since boot at the last tick
+	uint32_t mono_nsec;  // 0 .. 999999999
+	uint32_t boot_time;  // Wall clock at boot, seconds since 1970-01-01 (RTC, UTC)
+	uint32_t tick_nsec;  // Length of one tick, upper bound of the TSC offset
+} clock_page_t;
+
+void clock_init(const uint32_t hz);
+void clock_tick(void);
+void clock_map(uint32_t* dir);
+
+#endif
\ No newline at end of file
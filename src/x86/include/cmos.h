@@ -18,6 +18,7 @@ extern cmos_t cmos;
 
 date_t cmos_date(cmos_t* self);
 time_t cmos_time(cmos_t* self);
+int32_t cmos_bcd_to_decimal(const int32_t bcd);
 int rtc_load_utc_offset(void);
 
 #endif
\ No newline at end of file
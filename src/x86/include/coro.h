@@ -0,0 +1,112 @@
+/**
+ * @file coro.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef CORO_H
+#define CORO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+#include "task.h"
+
+/**
+ * Stackless coroutines (Duff's device / protothreads).
+ *
+ * A coroutine is a plain function that is called again and again by the executor.
+ * CORO_BEGIN jumps to the line it left off at, so nothing on the C stack survives
+ * a suspension point: everything that has to outlive a CORO_YIELD / CORO_POLL_UNTIL /
+ * CORO_WAIT_UNTIL lives in self->ctx. In exchange an outstanding operation costs a
+ * coro_t plus its context, no stack and no task.
+ *
+ * Rules: no switch() statements spanning a suspension point, and at most one
+ * suspension point per source line (__LINE__ is the resume label).
+ */
+
+typedef enum coro_step {
+	CORO_STEP_YIELD = 0x0, // Run me again on the next executor pass (polling)
+	CORO_STEP_WAIT = 0x1,  // Park me until somebody calls coro_wake()
+	CORO_STEP_DONE = 0x2,  // Finished, self->result holds the return value
+} coro_step_t;
+
+typedef enum coro_state {
+	CORO_STATE_NEW = 0x0,
+	CORO_STATE_READY = 0x1, // Queued in the executor
+	CORO_STATE_RUN = 0x2,	// Being stepped by the executor
+	CORO_STATE_WAIT = 0x3,	// Parked, not queued
+	CORO_STATE_DONE = 0x4,
+} coro_state_t;
+
+struct coro;
+typedef struct coro coro_t;
+
+typedef coro_step_t (*coro_fn)(coro_t* self);
+typedef void (*coro_done_fn)(coro_t* self);
+
+struct coro {
+	uint32_t line;		     // Resume point, 0 = start
+	coro_fn fn;		     // Body
+	void* ctx;		     // State that has to survive suspension points
+	volatile coro_state_t state; // Executor bookkeeping
+	int32_t result;		     // Set by CORO_EXIT
+	coro_done_fn on_done;	     // Optional continuation, runs in the executor once the coroutine is done
+	volatile bool woken;	     // coro_wake() hit while the coroutine was running
+	struct coro* next;	     // Executor run queue
+};
+
+#define CORO_BEGIN(self)                                                                                                                                       \
+	switch ((self)->line) {                                                                                                                                \
+	case 0:
+
+#define CORO_END(self)                                                                                                                                         \
+	};                                                                                                                                                     \
+	(self)->line = 0;                                                                                                                                      \
+	return CORO_STEP_DONE
+
+// Give the cpu to the other coroutines, continue on the next pass
+#define CORO_YIELD(self)                                                                                                                                       \
+	do {                                                                                                                                                   \
+		(self)->line = __LINE__;                                                                                                                       \
+		return CORO_STEP_YIELD;                                                                                                                        \
+	case __LINE__:;                                                                                                                                        \
+	} while (0)
+
+// Re-evaluate cond on every executor pass (devices without completion interrupt)
+#define CORO_POLL_UNTIL(self, cond)                                                                                                                            \
+	do {                                                                                                                                                   \
+		(self)->line = __LINE__;                                                                                                                       \
+	case __LINE__:                                                                                                                                         \
+		if (!(cond)) {                                                                                                                                 \
+			return CORO_STEP_YIELD;                                                                                                                \
+		};                                                                                                                                             \
+	} while (0)
+
+// Park until coro_wake(self), then re-evaluate cond
+#define CORO_WAIT_UNTIL(self, cond)                                                                                                                            \
+	do {                                                                                                                                                   \
+		(self)->line = __LINE__;                                                                                                                       \
+	case __LINE__:                                                                                                                                         \
+		if (!(cond)) {                                                                                                                                 \
+			return CORO_STEP_WAIT;                                                                                                                 \
+		};                                                                                                                                             \
+	} while (0)
+
+#define CORO_EXIT(self, value)                                                                                                                                 \
+	do {                                                                                                                                                   \
+		(self)->result = (value);                                                                                                                      \
+		(self)->line = 0;                                                                                                                              \
+		return CORO_STEP_DONE;                                                                                                                         \
+	} while (0)
+
+void coro_init(coro_t* self, coro_fn fn, void* ctx);
+int32_t coro_spawn(coro_t* self);
+void coro_wake(coro_t* self);
+int32_t coro_await(coro_t* self);
+uint32_t coro_run(void);
+void coro_set_executor(task_t* executor);
+void kcoro(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+ * @file elf.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+#include "process.h"
+
+typedef struct elf32_ehdr {
+	uint8_t ident[ELF_NIDENT]; // 0x7F 'E' 'L' 'F', class, data, version, ...
+	uint16_t type;		   // ELF_ET_EXEC for everything we run
+	uint16_t machine;	   // ELF_EM_386
+	uint32_t version;
+	uint32_t entry;	    // Virtual address of _start
+	uint32_t phoff;	    // File offset of the program header table
+	uint32_t shoff;	    // File offset of the section header table
+	uint32_t flags;
+	uint16_t ehsize;
+	uint16_t phentsize; // Size of one program header
+	uint16_t phnum;	    // Number of program headers
+	uint16_t shentsize;
+	uint16_t shnum;
+	uint16_t shstrndx;
+} __attribute__((packed)) elf32_ehdr_t;
+
+typedef struct elf32_phdr {
+	uint32_t type;	 // ELF_PT_LOAD is the only one we care about
+	uint32_t offset; // File offset of the segment
+	uint32_t vaddr;	 // Where it goes in the address space
+	uint32_t paddr;
+	uint32_t filesz; // Bytes backed by the file
+	uint32_t memsz;	 // Bytes in memory, memsz - filesz is zero filled (.bss)
+	uint32_t flags;	 // ELF_PF_R | ELF_PF_W | ELF_PF_X
+	uint32_t align;
+} __attribute__((packed)) elf32_phdr_t;
+
+int32_t elf_load(process_t* proc, const char* filepath);
+
+#endif
\ No newline at end of file
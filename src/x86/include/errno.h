@@ -45,5 +45,8 @@ extern int32_t errno;
 #define EPIPE 32   // Broken pipe
 #define EDOM 33	   // Math argument out of domain of func
 #define ERANGE 34  // Math result not representable
+#define ENAMETOOLONG 36 // File name too long
+#define ENOSYS 38	// Function not implemented
+#define ECANCELED 125	// Operation Canceled
 
 #endif
\ No newline at end of file
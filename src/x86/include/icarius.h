@@ -174,8 +174,19 @@
 #define PCI_LATENCY_TIMER_REG_OFFSET 0x0D // PCI latency timer_t in bus clock units
 #define PCI_HEADER_TYPE_REG_OFFSET 0x0E	  // Header type (general, bridge, etc.)
 #define PCI_BIST_REG_OFFSET 0x0F	  // Built-in self-test control and status
+#define PCI_BAR4_REG_OFFSET 0x20	  // Base address register 4 (IDE bus master I/O base)
 #define PCI_DEV_NOT_FOUND 0xFFFF	  // Value indicating device not present
 /*
+====================================
+    PCI Command & Class
+====================================
+*/
+#define PCI_COMMAND_IO (1 << 0)		// Respond to I/O space accesses
+#define PCI_COMMAND_BUS_MASTER (1 << 2) // Allow the device to master the bus (DMA)
+#define PCI_BAR_IO_MASK 0xFFFC		// I/O BARs keep the port in bits 2..15
+#define PCI_CLASS_MASS_STORAGE 0x01
+#define PCI_SUBCLASS_IDE 0x01
+/*
 ====================================
     VGA Textmode (Deprecated)
 ====================================
@@ -317,6 +328,16 @@
 #define ATA_CMD_WRITE_SECTORS 0x30
 #define ATA_CMD_CACHE_FLUSH 0xE7
 #define ATA_CMD_WRITE_SECTORS_EXT 0x34
+#define ATA_CMD_READ_SECTORS_EXT 0x24
+#define ATA_CMD_SET_MULTIPLE 0xC6
+#define ATA_CMD_READ_MULTIPLE 0xC4
+#define ATA_CMD_READ_MULTIPLE_EXT 0x29
+#define ATA_CMD_WRITE_MULTIPLE 0xC5
+#define ATA_CMD_WRITE_MULTIPLE_EXT 0x39
+#define ATA_CMD_READ_DMA 0xC8
+#define ATA_CMD_READ_DMA_EXT 0x25
+#define ATA_CMD_WRITE_DMA 0xCA
+#define ATA_CMD_WRITE_DMA_EXT 0x35
 /*
 ====================================
     ATA Status Flags
@@ -344,6 +365,49 @@
 #define ATA_CONTROL_PORT 0x1F6
 #define ATA_COMMAND_PORT 0x1F7
 #define ATA_STATUS_REGISTER 0x1F7
+#define ATA_ALT_STATUS_PORT 0x3F6	  // Read: status without acknowledging INTRQ
+#define ATA_DEVICE_CONTROL_PORT 0x3F6	  // Write: nIEN / SRST
+#define ATA_SECONDARY_STATUS_REGISTER 0x177
+#define ATA_CONTROL_SRST (1 << 2)	  // Software reset of both drives on the channel
+/*
+====================================
+    ATA Timeouts
+====================================
+*/
+#define ATA_TIMEOUT_MS 5000	 // A block or command that takes longer resets the channel
+#define ATA_POLL_SPINS 0x1000000 // Status reads before the same happens with interrupts off
+/*
+====================================
+    ATA Bus Master DMA
+====================================
+*/
+#define ATA_IRQ_VECTOR 0x2E	      // IRQ14, primary channel
+#define ATA_SECONDARY_IRQ_VECTOR 0x2F // IRQ15, secondary channel
+#define ATA_BM_COMMAND 0x0	      // Offsets from the BAR4 base, primary channel
+#define ATA_BM_STATUS 0x2
+#define ATA_BM_PRDT 0x4
+#define ATA_BM_CMD_START (1 << 0)     // Start/stop the bus master
+#define ATA_BM_CMD_READ (1 << 3)      // Direction: 1 = device to memory
+#define ATA_BM_STATUS_ACTIVE (1 << 0) // Transfer still in progress
+#define ATA_BM_STATUS_ERR (1 << 1)    // PCI error, write 1 to clear
+#define ATA_BM_STATUS_IRQ (1 << 2)    // The drive raised INTRQ, write 1 to clear
+#define ATA_BM_STATUS_DRV0 (1 << 5)   // Master is DMA capable
+#define ATA_PRD_EOT 0x8000	      // Last entry of the PRD table
+#define ATA_DMA_PRD_SIZE 0x10000      // Bytes per PRD entry, 64 KiB must not be crossed
+#define ATA_DMA_PRD_ENTRIES 16	      // 1 MiB bounce buffer
+#define ATA_DMA_BUFFER_SIZE (ATA_DMA_PRD_ENTRIES * ATA_DMA_PRD_SIZE)
+#define ATA_DMA_MAX_SECTORS (ATA_DMA_BUFFER_SIZE / ATA_SECTOR_SIZE)
+/*
+====================================
+    Buffer Cache
+====================================
+*/
+#define BCACHE_BLOCK_SIZE ATA_SECTOR_SIZE // One buffer holds one sector
+#define BCACHE_BUFFERS 1024		  // 512 KiB of cached sectors
+#define BCACHE_BUCKETS 256		  // Must be a power of two, the LBA is masked with BCACHE_BUCKET_MASK
+#define BCACHE_BUCKET_MASK (BCACHE_BUCKETS - 1)
+#define BCACHE_BYPASS_BLOCKS 64 // Longer reads go straight to the disk instead of evicting the metadata
+#define BCACHE_VALID 0x1	// The buffer holds the sector (dev, lba) and is in the hash table
 /*
 ====================================
     CMOS
@@ -368,7 +432,9 @@
 #define VFS_RDWR 0x0002
 #define VFS_CREATE 0x0040
 #define VFS_APPEND 0x0400
+#define VFS_NONBLOCK 0x0800 // O_NONBLOCK: read/write return -EAGAIN instead of sleeping
 #define VFS_TRUNC 0x0200
+#define VFS_EXCL 0x0080 // With VFS_CREATE: fail with -EEXIST if it exists (shm_open)
 /*
 ====================================
     FIFO
@@ -377,6 +443,13 @@
 #define FIFO_BUFFER_SIZE 128
 #define FIFO_BUFFER_MASK (FIFO_BUFFER_SIZE - 1)
 /*
+====================================
+    Pipes
+====================================
+*/
+#define PIPE_BUFFER_SIZE 4096 // Must be a power of two, head/tail are masked with PIPE_BUFFER_MASK
+#define PIPE_BUFFER_MASK (PIPE_BUFFER_SIZE - 1)
+/*
 ====================================
     Userland
 ====================================
@@ -389,7 +462,10 @@
 #define USER_BSS_SIZE (PAGE_SIZE)
 #define USER_BSS_END (USER_BSS_START + USER_BSS_SIZE - 1)
 
-#define USER_HEAP_START (USER_BSS_END + 1)
+#define USER_IMAGE_END (USER_HEAP_START - 1) // ELF segments may go anywhere below the heap
+#define USER_IMAGE_PAGES ((USER_IMAGE_END + 1) / PAGE_SIZE)
+
+#define USER_HEAP_START 0x40000000
 #define USER_HEAP_SIZE (PAGE_SIZE)
 #define USER_HEAP_END (USER_HEAP_START + USER_HEAP_SIZE - 1)
 
@@ -397,32 +473,172 @@
 #define USER_STACK_START (USER_STACK_END - USER_STACK_SIZE + 1) // 0xBFC00000
 #define USER_STACK_END 0xBFFFFFFF
 
+#define USER_RING_START (USER_STACK_START - PAGE_SIZE) // Submission/completion ring (ring_setup), one page below the stacks
+#define USER_CLOCK_START (USER_RING_START - PAGE_SIZE)	// Read-only time page (clock_page_t), mapped into every process
+
+#define USER_MMAP_START (USER_HEAP_END + 1)				  // mmap() region, handed out in whole 4 MiB pages
+#define USER_MMAP_END (USER_CLOCK_START - 1)				  // 0xBF3FFFFF
+#define USER_MMAP_PAGES ((USER_MMAP_END + 1 - USER_MMAP_START) / PAGE_SIZE) // Slots in process_t.mmap
+
 #define FD_STDIN 0  // Standard Input
 #define FD_STDOUT 1 // Standard Output
 #define FD_STDERR 2 // Standard Error
 #define FD_FILE 3
 /*
+====================================
+    ELF
+====================================
+*/
+#define ELF_NIDENT 16
+#define ELF_MAGIC 0x464C457F // "\x7FELF" read as little endian uint32_t
+#define ELF_CLASS_32 1
+#define ELF_DATA_LSB 1
+#define ELF_ET_EXEC 2
+#define ELF_EM_386 3
+#define ELF_PT_LOAD 1
+#define ELF_PF_X 0x1
+#define ELF_PF_W 0x2
+#define ELF_PF_R 0x4
+#define ELF_MAX_PHNUM 32
+#define IMAGE_CACHE_MAX 8 // Executables kept resident, least recently spawned one is evicted first
+/*
 ====================================
     x86 POSIX-Compatible Syscalls
 ====================================
 */
 #define MAX_SYSCALL 256
+#define SYSCALL_CHUNK_SIZE 256 // read/write move data between user memory and the console/VFS in stack chunks of this size
 #define SYS_EXIT 1	 // _exit(int status)
 #define SYS_READ 3	 // ssize_t read(int fd, void *buf, size_t count);
 #define SYS_WRITE 4	 // write(int fd, const void *buf, size_t count)
 #define SYS_OPEN 5	 // int open(const char* path, int flags);
 #define SYS_CLOSE 6	 // int close(int fd);
+#define SYS_WAITPID 7	 // pid_t waitpid(pid_t pid, int* status, int options);
+#define SYS_GETPID 20	 // pid_t getpid(void);
 #define SYS_GETDENTS 141 // int getdents(int fd, struct dirent* buf, unsigned int count);
+#define SYS_READV 145	 // ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
+#define SYS_WRITEV 146	 // ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+#define SYS_PREAD 180	 // ssize_t pread(int fd, void* buf, size_t count, off_t offset); offset in EDI
+#define SYS_PWRITE 181	 // ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset); offset in EDI
+#define IOV_MAX 16	 // Buffers per readv/writev, the iovec array is copied onto the kernel stack
+#define SYS_MMAP 90	 // void* mmap(struct mmap_args* args); old_mmap, the six arguments are passed in memory
+#define SYS_MUNMAP 91	 // int munmap(void* addr, size_t length);
+#define SYS_MPROTECT 125 // int mprotect(void* addr, size_t length, int prot);
+#define SYS_FCNTL 55	 // int fcntl(int fd, int cmd, int arg); F_GETFL / F_SETFL (O_NONBLOCK) only
+#define SYS_POLL 168	 // int poll(struct pollfd* fds, nfds_t nfds, int timeout);
+#define F_GETFL 3
+#define F_SETFL 4
+#define POLLIN 0x001
+#define POLLPRI 0x002
+#define POLLOUT 0x004
+#define POLLERR 0x008
+#define POLLHUP 0x010
+#define POLLNVAL 0x020
+#define POLL_MAX 32 // pollfd entries per call, the array is copied onto the kernel stack
+#define SYS_PIPE 42	 // int pipe(int fds[2]); fds[0] is the read end, fds[1] the write end
+#define SYS_FSYNC 118	 // int fsync(int fd); flushes the drive's write cache, -EINVAL for pipes and the console
+/*
+====================================
+    Memory Mappings (mmap)
+====================================
+*/
+#define PROT_NONE 0x0
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC 0x4 // Same as PROT_READ, there is no NX bit without PAE
+#define MAP_SHARED 0x01
+#define MAP_PRIVATE 0x02
+#define MAP_FIXED 0x10
+#define MAP_ANONYMOUS 0x20
+#define MMAP_PAGE_USED 0x1 // process_t.mmap slot is part of a mapping
+#define MMAP_PAGE_SHARED 0x2 // Frame comes from the file's map_cb instead of a private copy
+/*
+====================================
+    Shared Memory (shm)
+====================================
+*/
+#define SHM_MAX_OBJECTS 16 // Named objects system wide
+#define SHM_NAME_MAX 32	   // Including the leading '/' and the terminator
+#define SHM_MAX_PAGES 4	   // 4 MiB frames per object, allocated on first touch
+/*
+====================================
+    Message Passing (IPC)
+====================================
+*/
+#define IPC_MAX_PORTS 32 // Ports system wide
+#define IPC_MSG_WORDS 2	 // Words per message, they have to fit the registers a syscall returns in
+/*
+====================================
+    Time Page
+====================================
+*/
+#define CLOCK_CALIBRATE_TICKS 16 // Timer ticks the TSC is measured over
+#define CLOCK_TSC_SHIFT 24	 // Fixed point shift of the cycles to ns multiplier
+/*
+====================================
+    SYSENTER / SYSEXIT
+====================================
+*/
+#define MSR_SYSENTER_CS 0x174	     // Ring 0 CS on SYSENTER, SS = CS + 8, SYSEXIT uses CS + 16 / CS + 24 (RPL 3)
+#define MSR_SYSENTER_ESP 0x175	     // Ring 0 ESP on SYSENTER
+#define MSR_SYSENTER_EIP 0x176	     // Ring 0 entry point
+#define CPUID_FEAT_EDX_SEP (1 << 11) // CPUID.01H:EDX SYSENTER/SYSEXIT present
+#define SYSENTER_STACK_SIZE 64	     // Only used until asm_sysenter switches to TSS.esp0
+/*
+====================================
+    icariusOS Syscalls (240 - 255)
+====================================
+*/
+#define SYS_TASKSTAT 240 // int taskstat(int index, struct taskstat* buf);
+#define SYS_SPAWN 241	 // pid_t spawn(const char* path, char* const argv[], char* const envp[]);
+#define SYS_RING_SETUP 242 // int ring_setup(struct ring** ring);
+#define SYS_RING_ENTER 243 // int ring_enter(unsigned int to_submit);
+#define SYS_SYSCALLSTAT 244 // int syscallstat(int id, struct syscallstat* buf);
+#define SYS_STRACE 245	    // int strace(pid_t pid, int flags);
+#define SYS_STRACE_READ 246 // int strace_read(struct strace_record* buf, int max);
+#define SYS_SHM_OPEN 247    // int shm_open(const char* name, int oflag, mode_t mode); mode is ignored
+#define SYS_SHM_UNLINK 248  // int shm_unlink(const char* name);
+#define SYS_PORT_CREATE 249 // int port_create(void);
+#define SYS_PORT_DESTROY 250 // int port_destroy(int port);
+#define SYS_IPC_SEND 251    // int ipc_send(int port, w0, w1); EBX port, ECX/EDX message
+#define SYS_IPC_RECEIVE 252 // int ipc_receive(int port); returns the badge, message in EBX/EDI
+#define SYS_IPC_CALL 253    // int ipc_call(int port, w0, w1); reply in EBX/EDI
+#define SYS_IPC_REPLY 254   // int ipc_reply(int badge, w0, w1, int port); EDI port != 0 receives afterwards
+/*
+====================================
+    Syscall Accounting & Tracing
+====================================
+*/
+#define SYSCALL_STAT_BUCKETS 32 // log2(cycles) buckets, same scale as TASK_STAT_LATENCY_BUCKETS
+#define STRACE_ENTRIES 256	// Trace ring size, must be a power of two
+#define STRACE_TRACE 0x1	// Record this process' syscalls
+#define STRACE_INHERIT 0x2	// Processes it spawns start with STRACE_TRACE
+/*
+====================================
+    Syscall Ring
+====================================
+*/
+#define RING_SQ_ENTRIES 256 // Must be a power of two
+#define RING_CQ_ENTRIES 512 // Must be a power of two
+#define RING_SQE_LINK 0x1   // The next entry only runs if this one succeeded, otherwise it completes with -ECANCELED
 /*
 ====================================
     Processes
 ====================================
 */
+#define PROCESS_MAX 256 // Size of the process table, PIDs are 1 .. PROCESS_MAX - 1. Must be a power of two
+#define PROCESS_PID_MASK (PROCESS_MAX - 1)
+#define PROCESS_WNOHANG 1 // waitpid(): return 0 instead of blocking
 #define PROCESS_MAX_FILENAME 128
+#define PROCESS_MAX_ARGS 32	   // argv and envp entries each
+#define PROCESS_MAX_ARG_BYTES 4096 // All argv and envp strings together, including their terminators
 #define PROCESS_MAX_THREAD 16
 #define PROCESS_MAX_ALLOCATION 16
-#define RR_MAX 8
-#define WAIT_MAX 8
+#define RR_MAX (PROCESS_MAX * PROCESS_MAX_THREAD)   // Every task fits, a full ready queue is a bug
+#define WAIT_MAX (PROCESS_MAX * PROCESS_MAX_THREAD) // Every task fits, a full wait queue is a bug
+#define KWORK_QUEUE_SIZE 256 // Must be a power of two, index math relies on the mask
+#define KWORK_QUEUE_MASK (KWORK_QUEUE_SIZE - 1)
+#define TASK_STAT_LATENCY_BUCKETS 32 // log2(cycles) buckets, 2^31 cycles is already ~1s on any CPU we boot on
 /*
 ====================================
     CPU
@@ -14,6 +14,8 @@
 extern void asm_do_nop(void);
 extern void asm_do_sti(void);
 extern void asm_do_cli(void);
+extern uint32_t asm_irq_save(void);
+extern void asm_irq_restore(const uint32_t eflags);
 
 typedef struct idt_desc {
 	uint16_t isr_low;   // The lower 16 bits of the ISR's address
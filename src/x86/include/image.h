@@ -0,0 +1,45 @@
+/**
+ * @file image.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+
+#include "elf.h"
+#include "icarius.h"
+
+/**
+ * A loaded executable, kept resident between spawns.
+ * Read-only pages live in frames shared by every process running the image (one pfa reference each,
+ * plus one held by the cache). Pages with anything writable on them are private, their file bytes
+ * are kept here so a new process gets them without going to disk.
+ */
+typedef struct image {
+	char path[PROCESS_MAX_FILENAME];
+	uint32_t mtime;			   // st_mtime at load time, a modified file invalidates the entry
+	uint32_t size;			   // st_size at load time
+	elf32_ehdr_t ehdr;		   // Validated ELF header
+	elf32_phdr_t phdrs[ELF_MAX_PHNUM]; // Program headers, only PT_LOAD is used
+	uint8_t* data[ELF_MAX_PHNUM];	   // File bytes of segments on private pages, 0x0 for shared ones
+	uint32_t frames[USER_IMAGE_PAGES]; // Shared frame (physical address) per user page, 0x0 = private page
+	uint32_t last_used;		   // LRU stamp
+} image_t;
+
+typedef struct image_stats {
+	uint32_t hits;	    // Spawns served from the cache
+	uint32_t misses;    // Spawns that had to read the executable
+	uint32_t stale;	    // Entries dropped because the file changed
+	uint32_t evictions; // Entries dropped to make room
+} image_stats_t;
+
+image_t* image_lookup(const char* path, const uint32_t mtime);
+image_t* image_create(const char* path, const uint32_t mtime, const uint32_t size);
+void image_publish(image_t* self);
+void image_discard(image_t* self);
+void image_dump(void);
+
+#endif
\ No newline at end of file
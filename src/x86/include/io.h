@@ -10,9 +10,11 @@
 unsigned char inb(unsigned short port);
 unsigned short inw(unsigned short port);
 unsigned int inl(unsigned short port);
+void insw(unsigned short port, void* buffer, unsigned int count);
 
 void outb(unsigned short port, unsigned char value);
 void outw(unsigned short port, unsigned short value);
 void outl(unsigned short port, unsigned int value);
+void outsw(unsigned short port, const void* buffer, unsigned int count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+/**
+ * @file ipc.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+
+#include "icarius.h"
+
+struct process;
+struct task;
+
+// Small enough to travel in registers: EBX/EDI on the way out (the ones SYSEXIT keeps), ECX/EDX on the way in
+typedef struct ipc_msg {
+	uint32_t w[IPC_MSG_WORDS];
+} ipc_msg_t;
+
+/**
+ * Synchronous rendezvous point. Only tasks of the owner receive on it, anyone may send or call.
+ * A sender finding the receiver blocked hands it the cpu directly, otherwise it queues up.
+ */
+typedef struct ipc_port {
+	struct process* owner;	     // 0x0 = free slot
+	struct task* receiver;	     // Owner task blocked in receive
+	struct task* senders;	     // Blocked senders and callers, FIFO through task_t.ipc_next
+	struct task* senders_tail;
+} ipc_port_t;
+
+int32_t ipc_port_create(struct process* owner);
+int32_t ipc_port_destroy(struct process* caller, const int32_t port);
+int32_t ipc_send(const int32_t port, const ipc_msg_t* msg);
+int32_t ipc_call(const int32_t port, ipc_msg_t* msg);
+int32_t ipc_receive(const int32_t port, ipc_msg_t* msg);
+int32_t ipc_reply(const int32_t badge, ipc_msg_t* msg, const int32_t port);
+void ipc_task_exit(struct task* self);
+void ipc_release(struct process* self);
+
+#endif
\ No newline at end of file
@@ -25,7 +25,10 @@ extern char _kernel_start[], _kernel_end[];
 #include <stddef.h>
 
 #include "ata.h"
+#include "bcache.h"
+#include "clock.h"
 #include "cmos.h"
+#include "coro.h"
 #include "cursor.h"
 #include "errno.h"
 #include "fifo.h"
@@ -36,6 +39,7 @@ extern char _kernel_start[], _kernel_end[];
 #include "io.h"
 #include "kernel.h"
 #include "keyboard.h"
+#include "kwork.h"
 #include "mouse.h"
 #include "multiboot2.h"
 #include "page.h"
@@ -0,0 +1,41 @@
+/**
+ * @file kwork.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef KWORK_H
+#define KWORK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+#include "task.h"
+
+typedef void (*kwork_fn)(uint32_t arg);
+
+typedef struct kwork {
+	kwork_fn fn;  // Bottom half, runs in the kworker thread with interrupts enabled
+	uint32_t arg; // Whatever the top half captured from the device (scancode, status, ...)
+} kwork_t;
+
+/**
+ * Single producer / single consumer ring between IRQ handlers (top halves) and the kworker thread.
+ * IRQ handlers never nest, so all of them together count as one producer.
+ * head and tail are free running, the slot is index & KWORK_QUEUE_MASK.
+ */
+typedef struct kwork_queue {
+	kwork_t items[KWORK_QUEUE_SIZE];
+	volatile uint32_t head; // Written by the producer only
+	volatile uint32_t tail; // Written by the consumer only
+	uint32_t dropped;	// Items lost because the ring was full
+	uint32_t high_water;	// Max. number of pending items ever seen
+} kwork_queue_t;
+
+void kwork_set_worker(task_t* worker);
+bool kwork_queue(kwork_fn fn, const uint32_t arg);
+void kwork_dump(void);
+void kworker(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+/**
+ * @file mmap.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef MMAP_H
+#define MMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+
+struct process;
+struct fd_t;
+
+// Argument block of SYS_MMAP, Linux old_mmap layout (same in libc sys/mman.h)
+struct mmap_args {
+	uint32_t addr;
+	uint32_t len;
+	uint32_t prot;
+	uint32_t flags;
+	int32_t fd;
+	uint32_t offset;
+};
+
+/**
+ * One 4 MiB page of the mmap region (process_t.mmap[(virt - USER_MMAP_START) / PAGE_SIZE]).
+ * The frame is only allocated on the first fault, private file pages are read in at that point
+ * and are a private copy from then on, shared ones (MMAP_PAGE_SHARED) map the file's frame.
+ */
+typedef struct mmap_page {
+	uint8_t flags;	   // MMAP_PAGE_USED, MMAP_PAGE_SHARED
+	uint8_t prot;	   // PROT_READ / PROT_WRITE, PROT_NONE keeps the slot but denies every access
+	uint16_t reserved;
+	struct fd_t* file; // 0x0 for anonymous memory, holds a vfs_fget reference
+	uint32_t offset;   // File offset of the first byte of the page
+} mmap_page_t;
+
+int32_t mmap_map(struct process* self, const struct mmap_args* args);
+int32_t mmap_unmap(struct process* self, const uint32_t addr, const uint32_t len);
+int32_t mmap_protect(struct process* self, const uint32_t addr, const uint32_t len, const uint32_t prot);
+bool mmap_fault(struct process* self, const uint32_t fault_addr, const uint32_t error_code);
+void mmap_release(struct process* self);
+
+#endif
\ No newline at end of file
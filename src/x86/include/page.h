@@ -28,5 +28,8 @@ void page_unmap_dir(uint32_t* dir, const uint32_t virt_addr);
 void page_unmap_between(uint32_t* dir, uint32_t virt_start_addr, const uint32_t virt_end_addr);
 uint32_t page_get_phys_addr(uint32_t* dir, const uint32_t virt_addr);
 void page_restore_kernel_dir(void);
+void page_map_kernel(const uint32_t virt_addr, const uint32_t phys_addr, const uint32_t flags);
+void page_unmap_kernel(const uint32_t virt_addr);
+void page_destroy_dir(uint32_t* dir);
 
 #endif
\ No newline at end of file
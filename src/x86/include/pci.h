@@ -7,6 +7,7 @@
 #ifndef PCI_H
 #define PCI_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "icarius.h"
@@ -31,7 +32,9 @@ typedef struct pci_dev {
 
 
 uint16_t pci_read16(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset);
+uint32_t pci_read32(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset);
 void pci_write16(const uint32_t bus, const uint32_t device, const uint32_t function, const uint8_t offset, const uint16_t data);
 void pci_enumerate_bus(void);
+bool pci_find_class(pci_dev_t* dev, const uint8_t class_code, const uint8_t subclass);
 
 #endif
\ No newline at end of file
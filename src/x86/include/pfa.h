@@ -15,6 +15,7 @@
 
 typedef struct pfa {
 	uint32_t frames_bitmap[BITMAP_SIZE];
+	uint16_t frames_refs[MAX_FRAMES]; // Mappings per frame, frames shared between address spaces have more than one
 } pfa_t;
 
 void pfa_init(pfa_t* self);
@@ -23,5 +24,7 @@ void pfa_set(pfa_t* self, uint64_t frame);
 void pfa_clear(pfa_t* self, uint64_t frame);
 bool pfa_test(const pfa_t* self, const uint64_t frame);
 uint64_t pfa_alloc(void);
+void pfa_ref(pfa_t* self, const uint64_t frame);
+uint16_t pfa_put(pfa_t* self, const uint64_t frame);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+/**
+ * @file pipe.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+
+struct fd_t;
+
+/**
+ * Ring buffer shared by both ends. head and tail run freely and are only masked on access,
+ * so head - tail is the fill level even when the buffer is completely full.
+ */
+typedef struct pipe {
+	uint8_t* buffer;  // PIPE_BUFFER_SIZE bytes
+	uint32_t head;	  // Bytes ever written
+	uint32_t tail;	  // Bytes ever read
+	uint16_t readers; // Open read ends, writes fail with -EPIPE once 0
+	uint16_t writers; // Open write ends, reads return 0 (EOF) once 0 and empty
+} pipe_t;
+
+// fd_t.internal of a pipe descriptor
+typedef struct pipe_end {
+	pipe_t* pipe;
+	const struct fd_t* file; // Owning descriptor, for VFS_NONBLOCK
+	bool writer;
+} pipe_end_t;
+
+pipe_t* pipe_create(void);
+pipe_end_t* pipe_open(pipe_t* self, const struct fd_t* file, const bool writer);
+
+#endif
\ No newline at end of file
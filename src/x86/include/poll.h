@@ -0,0 +1,21 @@
+/**
+ * @file poll.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef POLL_H
+#define POLL_H
+
+#include <stdint.h>
+
+#include "icarius.h"
+
+// One entry of a poll() call (same layout in libc poll.h)
+struct pollfd {
+	int32_t fd;	 // Negative entries are skipped
+	int16_t events;	 // POLLIN / POLLOUT the caller waits for
+	int16_t revents; // Filled in by the kernel, POLLERR / POLLHUP / POLLNVAL are always reported
+};
+
+#endif
\ No newline at end of file
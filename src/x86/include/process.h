@@ -17,9 +17,16 @@ typedef struct task task_t;
 
 typedef enum process_filetype { PROCESS_ELF, PROCESS_BINARY, PROCESS_KERNEL_THREAD } process_filetype_t;
 
+typedef enum process_state {
+	PROCESS_STATE_ALIVE = 0x0,  // at least one task left
+	PROCESS_STATE_ZOMBIE = 0x1, // exited, keeps its PID and exit status until the parent waited for it
+} process_state_t;
+
 typedef struct process_arguments {
 	int argc;
-	char** argv;
+	char** argv; // Kernel copy, argv[argc] == 0x0. One allocation together with envp and all strings
+	int envc;
+	char** envp; // Kernel copy, envp[envc] == 0x0
 } process_arguments_t;
 
 typedef struct elf_file {
@@ -33,7 +40,10 @@ typedef struct elf_file {
 } elf_file_t;
 
 typedef struct process {
-	uint16_t pid;			     // Unique process ID
+	uint16_t pid;			     // Unique process ID, index into the process table
+	uint16_t ppid;			     // Parent process ID, 0 = nobody waits (reaped on exit)
+	process_state_t state;		     // ALIVE or ZOMBIE
+	int32_t exit_status;		     // Valid once ZOMBIE
 	char filename[PROCESS_MAX_FILENAME]; // For debugging & tracking
 	task_t* tasks[PROCESS_MAX_THREAD];   // Thread table (one task = one thread)
 	uint32_t* page_dir;		     // Own page directory (address space)
@@ -48,6 +58,12 @@ typedef struct process {
 	process_arguments_t arguments; // Command-line arguments
 	struct process* prev;	       // Linked list (process chain)
 	struct process* next;	       // Linked list (process chain)
+	struct process* reap_next;     // Reaper list (address space not yet released)
+	struct ring* ring;	       // Syscall ring at USER_RING_START, 0x0 until ring_setup
+	uint8_t strace;		       // STRACE_TRACE / STRACE_INHERIT
+	uint16_t strace_owner;	       // PID whose strace_read gets our records (strace_set caller or creator)
+	struct mmap_page* mmap;	       // USER_MMAP_PAGES slots of the mmap region, 0x0 until the first mmap
+	uint32_t stdin_flags;	       // VFS_NONBLOCK for FD_STDIN (fcntl F_SETFL), FD_STDIN is no VFS descriptor
 } process_t;
 
 /**
@@ -82,7 +98,12 @@ typedef struct process {
 void process_set_curr(process_t* self);
 process_t* process_get_curr(void);
 process_t* process_spawn(const char* filepath);
+process_t* process_spawnv(const char* filepath, char* const argv[], char* const envp[]);
 void process_list_dump(void);
-void process_exit(process_t* self);
+void process_exit(process_t* self, const int32_t status);
+process_t* process_get(const uint16_t pid);
+int32_t process_wait(process_t* self, const int32_t pid, int32_t* status, const uint32_t options);
+void process_reap_task(task_t* task);
+task_t* process_get_task_at(uint32_t index);
 
 #endif
\ No newline at end of file
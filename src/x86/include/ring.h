@@ -0,0 +1,56 @@
+/**
+ * @file ring.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Submission/completion ring shared with user space (same layout in libc ring.h)
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+#include "icarius.h"
+#include "idt.h"
+
+struct process;
+
+/**
+ * One queued syscall: opcode is the syscall number (SYS_READ, SYS_WRITE, ...),
+ * arg[] are EBX/ECX/EDX/EDI as for int 0x80 (EDI only for pread/pwrite).
+ */
+typedef struct ring_sqe {
+	uint8_t opcode;
+	uint8_t flags; // RING_SQE_LINK: the next entry only runs if this one succeeded
+	uint16_t reserved;
+	int32_t arg[4];
+	uint32_t user_data; // Copied to the completion
+} ring_sqe_t;
+
+typedef struct ring_cqe {
+	uint32_t user_data;
+	int32_t res; // Syscall return value
+} ring_cqe_t;
+
+/**
+ * The user owns sq_tail and cq_head, the kernel sq_head and cq_tail.
+ * Indices run freely, the slot is index & mask.
+ */
+typedef struct ring {
+	volatile uint32_t sq_head;
+	volatile uint32_t sq_tail;
+	uint32_t sq_mask;
+	uint32_t sq_entries;
+	volatile uint32_t cq_head;
+	volatile uint32_t cq_tail;
+	uint32_t cq_mask;
+	uint32_t cq_entries;
+	uint32_t cq_overflow; // ring_enter stopped because the completion ring was full
+	ring_sqe_t sqes[RING_SQ_ENTRIES];
+	ring_cqe_t cqes[RING_CQ_ENTRIES];
+} ring_t;
+
+ring_t* ring_setup(struct process* self);
+int32_t ring_enter(struct process* self, const uint32_t to_submit);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+/**
+ * @file shm.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+
+/**
+ * Named shared memory object, mapped with mmap(MAP_SHARED) on a shm_open descriptor.
+ * The frames are allocated on the first fault of any mapper and shared from then on.
+ */
+typedef struct shm_object {
+	char name[SHM_NAME_MAX];
+	uint32_t frames[SHM_MAX_PAGES]; // Physical frames, 0 until first touched, the object holds one reference each
+	uint16_t refs;			// Open descriptors
+	bool unlinked;			// Gone from the namespace, freed with the last descriptor
+} shm_object_t;
+
+int32_t shm_open(const char* name, const uint32_t flags);
+int32_t shm_unlink(const char* name);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+/**
+ * @file strace.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef STRACE_H
+#define STRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "icarius.h"
+#include "idt.h"
+
+/**
+ * Userspace view of one syscall's accounting (SYS_SYSCALLSTAT).
+ * Cycles are raw TSC from entry to return, blocking syscalls include the time asleep.
+ * hist[i] counts calls that took [2^i, 2^(i+1)) cycles.
+ */
+struct syscallstat {
+	uint32_t id;
+	char name[20];
+	uint32_t count;				   // Invocations (ring entries included)
+	uint32_t errors;			   // Returned < 0
+	uint64_t cycles;			   // Sum over all calls
+	uint64_t cycles_max;			   // Slowest call
+	uint32_t hist[SYSCALL_STAT_BUCKETS];	   // log2 histogram of the duration
+};
+
+/**
+ * One traced syscall (SYS_STRACE_READ). seq runs on over every tracer's records, a gap
+ * means another tracer's records or that the ring wrapped before they were drained.
+ */
+struct strace_record {
+	uint32_t seq;
+	uint16_t pid;
+	uint16_t syscall;
+	int32_t args[3]; // EBX, ECX, EDX
+	int32_t res;
+	uint32_t cycles; // Saturated at 0xFFFFFFFF
+	uint64_t tsc;	 // At entry
+};
+
+// Kernel side of a ring slot, a record only goes to the tracer that owns it
+typedef struct strace_slot {
+	struct strace_record rec;
+	uint16_t owner; // process_t.strace_owner of rec.pid
+	bool drained;	// Read already, the head skips it
+} strace_slot_t;
+
+void strace_account(const int32_t syscall_id, const int32_t args[3], const int32_t res, const uint64_t start);
+int32_t strace_get_stat(const int32_t syscall_id, struct syscallstat* stat);
+int32_t strace_set(const int32_t pid, const uint32_t flags);
+int32_t strace_read(struct strace_record* user_buf, const uint32_t max);
+
+#endif
\ No newline at end of file
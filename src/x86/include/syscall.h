@@ -14,5 +14,6 @@
 
 void syscall_init(void);
 void syscall_dispatch(const int32_t syscall_id, interrupt_frame_t* frame);
+int32_t syscall_invoke(const int32_t syscall_id, interrupt_frame_t* frame);
 
 #endif
\ No newline at end of file
@@ -8,6 +8,7 @@
 #define TASK_H
 
 #include "idt.h"
+#include "ipc.h"
 #include "process.h"
 #include <stdint.h>
 
@@ -24,6 +25,13 @@ typedef enum task_state {
 typedef enum wait_reason {
 	WAIT_NONE,
 	WAIT_KEYBOARD,
+	WAIT_KWORK,
+	WAIT_CORO,
+	WAIT_ATA,
+	WAIT_CHILD,
+	WAIT_PIPE, // Pipe became readable/writable or lost its other end
+	WAIT_IPC,  // Blocked in send/call/receive, woken directly by the other side (not in the wait queue)
+	WAIT_POLL, // Any event a poll() may be waiting for (keyboard, pipes), the poller scans again
 	WAIT_NOUSE,
 } wait_reason_t;
 
@@ -42,16 +50,41 @@ typedef struct task_registers {
 	uint32_t ss;	 // Offset +44  | Stack Segment (Usermode SS)
 } __attribute__((packed)) task_registers_t;
 
+typedef struct task_stat {
+	uint64_t run_cycles;				     // TSC cycles spent on the cpu
+	uint64_t wait_cycles;				     // TSC cycles spent in the ready queue
+	uint64_t switched_in;				     // TSC when the task was last put on the cpu (or last accounted)
+	uint64_t ready_since;				     // TSC when the task was last put into the ready queue, 0 if not queued
+	uint64_t woken_at;				     // TSC of the last wakeup, 0 if the task has not been woken since it last ran
+	uint64_t latency_max;				     // Worst wakeup-to-run latency in TSC cycles
+	uint32_t nvcsw;					     // Voluntary context switches (blocked or exited)
+	uint32_t nivcsw;				     // Involuntary context switches (preempted by the timer)
+	uint32_t wakeups;				     // Number of wakeups from the wait queue
+	uint32_t latency_hist[TASK_STAT_LATENCY_BUCKETS]; // Bucket i: wakeup-to-run latency in [2^i, 2^(i+1)) cycles
+} task_stat_t;
+
 typedef struct task {
 	uint32_t stack_top;
 	uint32_t stack_bottom;
+	uint32_t kstack_top;	// Kernel stack (TSS.esp0) for Ring 3 -> Ring 0, kernel threads run on their only stack
+	uint32_t kstack_bottom; // Lowest address of the kernel stack
 	task_registers_t registers;
 	process_t* parent;
 	task_state_t state;
 	wait_reason_t waiting_on;
+	task_stat_t stat;
+	struct task* reap_next; // Reaper list (kernel stack and task_t not yet released)
+	uint64_t wake_tick;	// wq_sleep_until deadline in timer ticks, 0 = none
+	ipc_msg_t ipc_msg;	// Message in flight: outgoing while sending, incoming once woken
+	int32_t ipc_status;	// What IPC woke us with: badge, 0 or -errno
+	bool ipc_call;		// Queued as caller, stays blocked after delivery until the reply
+	struct task* ipc_next;	// Next blocked sender on the same port
+	struct task* ipc_reply; // Caller waiting for our reply
 } task_t;
 
 extern void asm_enter_task(task_registers_t* frame);
+extern void asm_task_yield(void);
+extern void asm_task_yield_to(task_t* next);
 extern void asm_restore_kernel_segment(void);
 extern void asm_restore_user_segment(void);
 
@@ -68,5 +101,8 @@ void task_restore_dir(task_t* self);
 void task_set_block(task_t* self);
 void task_set_unblock(task_t* self);
 void task_switch(task_t* next);
+void task_handoff(interrupt_frame_t* frame, task_t* next);
+void task_stat_tick(task_t* self);
+void task_stat_ready(task_t* self);
 
 #endif
\ No newline at end of file
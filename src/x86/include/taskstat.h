@@ -0,0 +1,37 @@
+/**
+ * @file taskstat.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef TASKSTAT_H
+#define TASKSTAT_H
+
+#include <stdint.h>
+
+#include "icarius.h"
+
+/**
+ * Userspace view of a task's accounting (SYS_TASKSTAT).
+ * All times are raw TSC cycles, `tsc` is the counter value at the time of the
+ * snapshot so the caller can compute deltas between two calls.
+ * latency[i] counts wakeups whose wakeup-to-run latency was in [2^i, 2^(i+1)) cycles.
+ */
+struct taskstat {
+	uint32_t pid;					// Owning process
+	uint32_t tid;					// Slot in the process thread table
+	uint32_t state;					// task_state_t
+	uint32_t kernel;				// 1 for kernel threads
+	char name[32];					// Truncated process filename
+	uint64_t tsc;					// TSC at snapshot time
+	uint64_t run_cycles;				// Time spent on the CPU
+	uint64_t wait_cycles;				// Time spent in the ready queue
+	uint32_t nvcsw;					// Voluntary context switches (blocked/exited)
+	uint32_t nivcsw;				// Involuntary context switches (preempted)
+	uint32_t wakeups;				// Number of wakeups from a wait queue
+	uint32_t reserved;				// Padding, always 0
+	uint64_t latency_max;				// Worst wakeup-to-run latency
+	uint32_t latency[TASK_STAT_LATENCY_BUCKETS];	// log2 histogram of wakeup-to-run latency
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+/**
+ * @file tsc.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef TSC_H
+#define TSC_H
+
+#include <stdint.h>
+
+/**
+ * @brief Reads the Time Stamp Counter.
+ *
+ * Inlined on purpose: it is called on every context switch and timer tick,
+ * a call through a wrapper would show up in the very numbers it measures.
+ */
+static inline uint64_t tsc_read(void)
+{
+	uint32_t lo = 0;
+	uint32_t hi = 0;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+};
+
+#endif
\ No newline at end of file
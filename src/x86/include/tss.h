@@ -42,5 +42,6 @@ typedef struct tss {
 
 void tss_init(tss_t* self, uint32_t esp0, uint16_t ss0);
 void tss_load(uint16_t tss_selector);
+void tss_set_esp0(tss_t* self, uint32_t esp0);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+/**
+ * @file uaccess.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef UACCESS_H
+#define UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "icarius.h"
+#include "idt.h"
+
+int32_t copy_from_user(void* dst, const void* user_src, const size_t n);
+int32_t copy_to_user(void* user_dst, const void* src, const size_t n);
+int32_t strncpy_from_user(char* dst, const char* user_src, const size_t n);
+bool uaccess_fixup(interrupt_frame_t* frame, const uint32_t fault_addr);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+/**
+ * @file uio.h
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#ifndef UIO_H
+#define UIO_H
+
+#include "types.h"
+
+// One buffer of a readv/writev call (same layout in libc sys/uio.h)
+struct iovec {
+	void* iov_base;
+	size_t iov_len;
+};
+
+#endif
\ No newline at end of file
@@ -25,6 +25,11 @@ typedef int32_t (*stat_fn)(ata_t* dev, void* internal, vstat_t* buffer);
 typedef int32_t (*seek_fn)(void* internal, const uint32_t offset, const uint8_t whence);
 typedef size_t (*write_fn)(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks);
 typedef int32_t (*readdir_fn)(ata_t* dev, void* internal, vfs_dirent_t* dir, size_t dir_offset);
+typedef size_t (*pread_fn)(ata_t* dev, void* internal, uint8_t* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset);
+typedef size_t (*pwrite_fn)(ata_t* dev, void* internal, const uint8_t* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset);
+typedef int16_t (*poll_fn)(void* internal, const int16_t events);
+typedef uint32_t (*map_fn)(void* internal, const uint32_t offset, bool* fresh);
+typedef int32_t (*sync_fn)(ata_t* dev, void* internal);
 
 typedef struct fs {
 	resolve_fn resolve_cb;
@@ -35,15 +40,23 @@ typedef struct fs {
 	seek_fn seek_cb;
 	write_fn write_cb;
 	readdir_fn readdir_cb;
+	pread_fn pread_cb;   // Positional read, must not move the descriptor position
+	pwrite_fn pwrite_cb; // Positional write, must not move the descriptor position
+	poll_fn poll_cb;     // Ready POLL* bits, 0x0 = always ready for reading and writing (disk files)
+	map_fn map_cb;	     // Frame for a MAP_SHARED page with a reference taken, 0x0 = no shared mappings
+	sync_fn sync_cb;     // Write barrier for fsync and the last close, 0x0 = nothing is cached (pipes)
 	char name[10];
 } fs_t;
 
 typedef struct fd_t {
 	int32_t index;
-	fs_t* fs;
+	fs_t* fs; // dev->fs for files on a disk, pipe_fs for pipes (dev = 0x0)
 	void* internal;
 	ata_t* dev;
 	uint32_t dir_offset;
+	uint16_t refs;	// The descriptor number plus every vfs_fget (mmap pages), closed when it drops to 0
+	uint32_t flags; // VFS_NONBLOCK
+	uint16_t pid;	// Process that opened the descriptor, its exit closes it (0 = kernel, never closed)
 } fd_t;
 
 typedef struct vfs_dirent {
@@ -63,5 +76,17 @@ int32_t vfs_fstat(const int32_t fd, vstat_t* buffer);
 int32_t vfs_fseek(const int32_t fd, const uint32_t offset, const uint8_t whence);
 size_t vfs_fwrite(const void* buffer, size_t n_bytes, size_t n_blocks, const int32_t fd);
 int32_t vfs_readdir(const int32_t fd, vfs_dirent_t* dir);
+size_t vfs_fpread(void* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset, const int32_t fd);
+size_t vfs_fpwrite(const void* buffer, size_t n_bytes, size_t n_blocks, const uint32_t offset, const int32_t fd);
+fd_t* vfs_fget(const int32_t fd);
+void vfs_fput(fd_t* file);
+size_t vfs_file_pread(fd_t* file, void* buffer, size_t n_bytes, const uint32_t offset);
+int16_t vfs_poll(const int32_t fd, const int16_t events);
+int32_t vfs_pipe(int32_t fds[2]);
+int32_t vfs_fattach(fs_t* fs, void* internal);
+int32_t vfs_get_flags(const int32_t fd);
+int32_t vfs_set_flags(const int32_t fd, const uint32_t flags);
+int32_t vfs_fsync(const int32_t fd);
+void vfs_close_all(const uint16_t pid);
 
 #endif
\ No newline at end of file
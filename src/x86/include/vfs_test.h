@@ -7,6 +7,7 @@
 #ifndef VFS_TEST_H
 #define VFS_TEST_H
 
+#include "bcache.h"
 #include "stdio.h"
 #include "string.h"
 #include <stdint.h>
@@ -14,5 +15,6 @@
 void test_vfs_read(const char* file);
 void test_vfs_write(char* msg, uint32_t bytes);
 void test_readdir(const char* path);
+void test_bcache(const char* file);
 
 #endif
\ No newline at end of file
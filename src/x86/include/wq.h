@@ -15,6 +15,9 @@
 
 void wq_wakeup(const wait_reason_t reason);
 void wq_push(task_t* task);
+void wq_sleep(const wait_reason_t reason);
+void wq_sleep_until(const wait_reason_t reason, const uint64_t deadline);
+void wq_tick(const uint64_t now);
 task_t* wq_pop(void);
 
 #endif
\ No newline at end of file
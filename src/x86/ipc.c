@@ -0,0 +1,340 @@
+/**
+ * @file ipc.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Synchronous message passing over ports (send / receive / call / reply)
+ *
+ * Messages are IPC_MSG_WORDS words and never touch user memory, the syscall layer moves them
+ * in and out of registers. When the other side is already blocked waiting, the cpu is handed
+ * over with asm_task_yield_to (task_handoff) instead of going through the ready queue, so a
+ * call / reply round trip between a client and a waiting server costs two task switches.
+ * Everything runs with interrupts off (syscall context).
+ */
+
+#include "ipc.h"
+#include "errno.h"
+#include "page.h"
+#include "process.h"
+#include "scheduler.h"
+#include "task.h"
+
+/* PUBLIC API */
+int32_t ipc_port_create(process_t* owner);
+int32_t ipc_port_destroy(process_t* caller, const int32_t port);
+int32_t ipc_send(const int32_t port, const ipc_msg_t* msg);
+int32_t ipc_call(const int32_t port, ipc_msg_t* msg);
+int32_t ipc_receive(const int32_t port, ipc_msg_t* msg);
+int32_t ipc_reply(const int32_t badge, ipc_msg_t* msg, const int32_t port);
+void ipc_task_exit(task_t* self);
+void ipc_release(process_t* self);
+
+/* INTERNAL API */
+static ipc_port_t* _get_port(const int32_t port);
+static void _enqueue(ipc_port_t* port, task_t* sender);
+static task_t* _dequeue(ipc_port_t* port);
+static int32_t _accept(task_t* self, task_t* sender, ipc_msg_t* msg);
+static void _wake(task_t* task, const int32_t status);
+static void _switch(task_t* self, task_t* next, const bool block);
+static int32_t _transfer(const int32_t port, ipc_msg_t* msg, const bool call);
+static void _destroy(ipc_port_t* port);
+
+static ipc_port_t _ports[IPC_MAX_PORTS] = {};
+
+// Port ids are slot + 1, 0 is never a port (ipc_reply uses it for "don't receive")
+static ipc_port_t* _get_port(const int32_t port)
+{
+	if (port < 1 || port > IPC_MAX_PORTS || !_ports[port - 1].owner) {
+		return 0x0;
+	};
+	return &_ports[port - 1];
+};
+
+static void _enqueue(ipc_port_t* port, task_t* sender)
+{
+	sender->ipc_next = 0x0;
+
+	if (port->senders_tail) {
+		port->senders_tail->ipc_next = sender;
+	} else {
+		port->senders = sender;
+	};
+	port->senders_tail = sender;
+	return;
+};
+
+static task_t* _dequeue(ipc_port_t* port)
+{
+	task_t* sender = port->senders;
+
+	if (!sender) {
+		return 0x0;
+	};
+	port->senders = sender->ipc_next;
+
+	if (!port->senders) {
+		port->senders_tail = 0x0;
+	};
+	sender->ipc_next = 0x0;
+	return sender;
+};
+
+/**
+ * @brief Takes the message of a queued sender, a plain send is complete now, a caller waits for the reply.
+ * @return The badge (sender's PID)
+ */
+static int32_t _accept(task_t* self, task_t* sender, ipc_msg_t* msg)
+{
+	*msg = sender->ipc_msg;
+
+	if (sender->ipc_call) {
+		self->ipc_reply = sender;
+	} else {
+		_wake(sender, 0);
+		scheduler_get()->add_cb(sender);
+	};
+	return sender->parent->pid;
+};
+
+// Makes a task blocked in IPC runnable, it is not put into any queue
+static void _wake(task_t* task, const int32_t status)
+{
+	task->ipc_status = status;
+	task_set_unblock(task);
+	return;
+};
+
+/**
+ * @brief Gives up the cpu, straight to next if there is one, otherwise through the scheduler.
+ *
+ * With block set the current task sleeps until someone _wakes it, without it is queued as
+ * ready by task_handoff (a send that found its receiver waiting keeps running later on).
+ */
+static void _switch(task_t* self, task_t* next, const bool block)
+{
+	// We come back on whatever directory the last task left behind, the caller expects its own
+	uint32_t* dir = page_get_dir();
+
+	if (block) {
+		task_set_block(self);
+		task_block_on(self, WAIT_IPC);
+	};
+
+	if (next) {
+		asm_task_yield_to(next);
+	} else {
+		asm_task_yield();
+	};
+	page_set_dir(dir);
+	return;
+};
+
+static int32_t _transfer(const int32_t port, ipc_msg_t* msg, const bool call)
+{
+	ipc_port_t* p = _get_port(port);
+	task_t* self = task_get_curr();
+
+	if (!p) {
+		return -EBADF;
+	};
+	self->ipc_msg = *msg;
+	self->ipc_call = call;
+
+	if (!p->receiver) {
+		_enqueue(p, self);
+		_switch(self, 0x0, true);
+	} else {
+		// Fast path: the receiver gets the message and our cpu right away
+		task_t* receiver = p->receiver;
+		p->receiver = 0x0;
+		receiver->ipc_msg = *msg;
+
+		if (call) {
+			receiver->ipc_reply = self;
+		};
+		_wake(receiver, self->parent->pid);
+		self->ipc_status = 0;
+		_switch(self, receiver, call);
+	};
+
+	if (call && self->ipc_status >= 0) {
+		*msg = self->ipc_msg;
+	};
+	return self->ipc_status;
+};
+
+int32_t ipc_port_create(process_t* owner)
+{
+	for (int32_t i = 0; i < IPC_MAX_PORTS; i++) {
+		if (!_ports[i].owner) {
+			_ports[i].owner = owner;
+			return i + 1;
+		};
+	};
+	return -ENOSPC;
+};
+
+// Everybody still waiting on the port gets -EPIPE
+static void _destroy(ipc_port_t* port)
+{
+	task_t* sender = 0x0;
+
+	while ((sender = _dequeue(port))) {
+		_wake(sender, -EPIPE);
+		scheduler_get()->add_cb(sender);
+	};
+
+	if (port->receiver) {
+		_wake(port->receiver, -EPIPE);
+		scheduler_get()->add_cb(port->receiver);
+	};
+	port->owner = 0x0;
+	port->receiver = 0x0;
+	return;
+};
+
+int32_t ipc_port_destroy(process_t* caller, const int32_t port)
+{
+	ipc_port_t* p = _get_port(port);
+
+	if (!p) {
+		return -EBADF;
+	};
+
+	if (p->owner != caller) {
+		return -EPERM;
+	};
+	_destroy(p);
+	return 0;
+};
+
+/**
+ * @brief Delivers msg to the port and returns once the receiver has it.
+ */
+int32_t ipc_send(const int32_t port, const ipc_msg_t* msg)
+{
+	ipc_msg_t copy = *msg;
+	return _transfer(port, &copy, false);
+};
+
+/**
+ * @brief Sends msg and sleeps until the receiver replies, the reply is written back to msg.
+ */
+int32_t ipc_call(const int32_t port, ipc_msg_t* msg)
+{
+	return _transfer(port, msg, true);
+};
+
+/**
+ * @brief Waits for the next message on a port owned by the caller.
+ * @return The sender's badge (PID) or a negative errno, the message is in msg
+ */
+int32_t ipc_receive(const int32_t port, ipc_msg_t* msg)
+{
+	ipc_port_t* p = _get_port(port);
+	task_t* self = task_get_curr();
+
+	if (!p) {
+		return -EBADF;
+	};
+
+	if (p->owner != self->parent) {
+		return -EPERM;
+	};
+
+	// One receiver per port, and a call has to be answered before the next one is taken
+	if (p->receiver || self->ipc_reply) {
+		return -EBUSY;
+	};
+	task_t* sender = _dequeue(p);
+
+	if (sender) {
+		return _accept(self, sender, msg);
+	};
+	p->receiver = self;
+	_switch(self, 0x0, true);
+
+	if (self->ipc_status > 0) {
+		*msg = self->ipc_msg;
+	};
+	return self->ipc_status;
+};
+
+/**
+ * @brief Answers the last call taken (badge is what receive returned) and switches to the caller.
+ *
+ * With a port the caller receives right after replying (reply + receive in one syscall). If a sender
+ * is already queued there the caller goes to the ready queue and we go on with the next message,
+ * otherwise we block on the port and hand the cpu to the caller.
+ * @return 0, or for reply + receive the next badge with its message in msg
+ */
+int32_t ipc_reply(const int32_t badge, ipc_msg_t* msg, const int32_t port)
+{
+	task_t* self = task_get_curr();
+	task_t* caller = self->ipc_reply;
+	ipc_port_t* p = port ? _get_port(port) : 0x0;
+
+	if (!caller || caller->parent->pid != badge) {
+		return -ESRCH;
+	};
+
+	// Checked before the reply goes out, an error must leave the caller waiting
+	if (port && !p) {
+		return -EBADF;
+	};
+
+	if (p && p->owner != self->parent) {
+		return -EPERM;
+	};
+
+	if (p && p->receiver) {
+		return -EBUSY;
+	};
+	self->ipc_reply = 0x0;
+	caller->ipc_msg = *msg;
+	_wake(caller, 0);
+
+	if (!p) {
+		_switch(self, caller, false);
+		return 0;
+	};
+	task_t* sender = _dequeue(p);
+
+	if (sender) {
+		scheduler_get()->add_cb(caller);
+		return _accept(self, sender, msg);
+	};
+	p->receiver = self;
+	_switch(self, caller, true);
+
+	if (self->ipc_status > 0) {
+		*msg = self->ipc_msg;
+	};
+	return self->ipc_status;
+};
+
+/**
+ * @brief A task leaving with an unanswered call, the caller gets -EPIPE.
+ */
+void ipc_task_exit(task_t* self)
+{
+	if (!self->ipc_reply) {
+		return;
+	};
+	_wake(self->ipc_reply, -EPIPE);
+	scheduler_get()->add_cb(self->ipc_reply);
+	self->ipc_reply = 0x0;
+	return;
+};
+
+/**
+ * @brief Destroys every port the exiting process owns.
+ */
+void ipc_release(process_t* self)
+{
+	for (int32_t i = 0; i < IPC_MAX_PORTS; i++) {
+		if (_ports[i].owner == self) {
+			_destroy(&_ports[i]);
+		};
+	};
+	return;
+};
\ No newline at end of file
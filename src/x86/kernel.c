@@ -10,6 +10,7 @@
 extern vbe_t vbe_display;
 extern pfa_t pfa;
 extern heap_t heap;
+extern bcache_t bcache;
 extern kbd_t kbd;
 extern mouse_t mouse;
 extern timer_t timer;
@@ -247,7 +248,23 @@ static void _bootstrap(void)
 	};
 	process_set_curr(idle_proc);
 
-	process_t* icarsh = process_spawn("A:/BIN/ICARSH.BIN");
+	process_t* kworker_proc = process_kspawn(kworker, "KWORKER");
+
+	if (!kworker_proc) {
+		panic("Failed to initialize KWORKER");
+	};
+	kwork_set_worker(kworker_proc->tasks[0]);
+	scheduler->add_cb(kworker_proc->tasks[0]);
+
+	process_t* kcoro_proc = process_kspawn(kcoro, "KCORO");
+
+	if (!kcoro_proc) {
+		panic("Failed to initialize KCORO");
+	};
+	coro_set_executor(kcoro_proc->tasks[0]);
+	scheduler->add_cb(kcoro_proc->tasks[0]);
+
+	process_t* icarsh = process_spawn("A:/BIN/ICARSH.ELF");
 
 	if (!icarsh) {
 		panic("Failed to initialize ICARSH");
@@ -278,6 +295,7 @@ void kmain(const uint32_t magic, const uint32_t addr)
 
 	heap_init(&heap);
 	heap_dump(&heap);
+	bcache_init(&bcache);
 
 	fifo_init(&fifo_kbd);
 	fifo_init(&fifo_mouse);
@@ -285,6 +303,7 @@ void kmain(const uint32_t magic, const uint32_t addr)
 	kbd_init(&kbd);
 	mouse_init(&mouse);
 	timer_init(&timer, 100);
+	clock_init(timer.hz);
 
 	// pci_enumerate_bus();
 
@@ -130,7 +130,7 @@ static void _heap_grow(heap_t* self)
 		panic("[CRITICAL] Out of Physical Memory. Unable to Allocate more Mem.\n");
 		return;
 	};
-	page_map(self->next_addr, phys_addr, PAGE_PS | PAGE_WRITABLE | PAGE_PRESENT);
+	page_map_kernel(self->next_addr, phys_addr, PAGE_PS | PAGE_WRITABLE | PAGE_PRESENT);
 	const uint32_t frame = phys_addr / PAGE_SIZE;
 	kprintf("[DEBUG] Heap is growing eating Frame %d\n", frame);
 	const size_t chunks = PAGE_SIZE / KERNEL_HEAP_CHUNK_SIZE;
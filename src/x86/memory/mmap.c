@@ -0,0 +1,326 @@
+/**
+ * @file mmap.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief mmap/munmap/mprotect on top of 4 MiB pages
+ *
+ * The region USER_MMAP_START..USER_MMAP_END is handed out in whole PSE pages. A mapping only
+ * reserves slots in process_t.mmap, frames are allocated by mmap_fault on first touch. Private
+ * file mappings read their page from the VFS at that point, nothing is ever written back.
+ * Shared file mappings (shm) map the file's own frame, every mapper sees the same memory.
+ */
+
+#include "mmap.h"
+#include "errno.h"
+#include "heap.h"
+#include "page.h"
+#include "pfa.h"
+#include "process.h"
+#include "string.h"
+#include "vfs.h"
+
+/* EXTERNAL API */
+extern pfa_t pfa;
+
+/* PUBLIC API */
+int32_t mmap_map(process_t* self, const struct mmap_args* args);
+int32_t mmap_unmap(process_t* self, const uint32_t addr, const uint32_t len);
+int32_t mmap_protect(process_t* self, const uint32_t addr, const uint32_t len, const uint32_t prot);
+bool mmap_fault(process_t* self, const uint32_t fault_addr, const uint32_t error_code);
+void mmap_release(process_t* self);
+
+/* INTERNAL API */
+static int32_t _range(const uint32_t addr, const uint32_t len, uint32_t* first, uint32_t* pages);
+static int32_t _find_free(const process_t* self, const uint32_t pages);
+static uint32_t _page_flags(const uint8_t prot);
+static void _unmap_slot(process_t* self, const uint32_t slot);
+
+/**
+ * @brief Converts addr/len into mmap slots, addr must be page aligned, len is rounded up.
+ * @return 0 or -EINVAL if the range leaves the mmap region
+ */
+static int32_t _range(const uint32_t addr, const uint32_t len, uint32_t* first, uint32_t* pages)
+{
+	if (!len || (addr & (PAGE_SIZE - 1)) || addr < USER_MMAP_START || addr > USER_MMAP_END) {
+		return -EINVAL;
+	};
+	*first = (addr - USER_MMAP_START) / PAGE_SIZE;
+	*pages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+
+	if (len > USER_MMAP_END - USER_MMAP_START + 1 || *pages > USER_MMAP_PAGES - *first) {
+		return -EINVAL;
+	};
+	return 0;
+};
+
+// First fit, returns the first slot of pages free slots in a row or -ENOMEM
+static int32_t _find_free(const process_t* self, const uint32_t pages)
+{
+	uint32_t run = 0;
+
+	for (uint32_t slot = 0; slot < USER_MMAP_PAGES; slot++) {
+		run = (self->mmap[slot].flags & MMAP_PAGE_USED) ? 0 : run + 1;
+
+		if (run == pages) {
+			return slot + 1 - pages;
+		};
+	};
+	return -ENOMEM;
+};
+
+static uint32_t _page_flags(const uint8_t prot)
+{
+	// PROT_NONE stays present for the frame bookkeeping, ring 3 and the uaccess helpers just can't reach it
+	uint32_t flags = PAGE_PS | PAGE_PRESENT;
+
+	if (prot != PROT_NONE) {
+		flags |= PAGE_USER;
+	};
+
+	if (prot & PROT_WRITE) {
+		flags |= PAGE_WRITABLE;
+	};
+	return flags;
+};
+
+// Drops the frame (if it was ever faulted in) and the file reference of one slot
+static void _unmap_slot(process_t* self, const uint32_t slot)
+{
+	mmap_page_t* page = &self->mmap[slot];
+	const uint32_t virt_addr = USER_MMAP_START + slot * PAGE_SIZE;
+	const uint32_t phys_addr = page_get_phys_addr(self->page_dir, virt_addr);
+
+	if (phys_addr) {
+		page_unmap_dir(self->page_dir, virt_addr);
+		pfa_put(&pfa, phys_addr / PAGE_SIZE);
+	};
+
+	if (page->file) {
+		vfs_fput(page->file);
+	};
+	memset(page, 0, sizeof(mmap_page_t));
+	return;
+};
+
+/**
+ * @brief Reserves a mapping in the caller, must run on the caller's directory (syscall context).
+ *
+ * Anonymous (MAP_ANONYMOUS) or file mappings. MAP_SHARED needs a file with map_cb (shm), for
+ * anonymous memory it is the same as MAP_PRIVATE (there is no fork). The file offset must be page aligned.
+ * @return The address of the mapping or a negative errno
+ */
+int32_t mmap_map(process_t* self, const struct mmap_args* args)
+{
+	const bool anonymous = args->flags & MAP_ANONYMOUS;
+	const uint32_t type = args->flags & (MAP_SHARED | MAP_PRIVATE);
+
+	if (!args->len || (type != MAP_SHARED && type != MAP_PRIVATE) || (args->prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC))) {
+		return -EINVAL;
+	};
+
+	if (!anonymous && (args->offset & (PAGE_SIZE - 1))) {
+		return -EINVAL;
+	};
+
+	if (args->len > USER_MMAP_END - USER_MMAP_START + 1) {
+		return -ENOMEM;
+	};
+
+	if (!self->mmap) {
+		self->mmap = kzalloc(USER_MMAP_PAGES * sizeof(mmap_page_t));
+
+		if (!self->mmap) {
+			return -ENOMEM;
+		};
+	};
+	const uint32_t pages = (args->len + PAGE_SIZE - 1) / PAGE_SIZE;
+	int32_t first = 0;
+
+	if (args->flags & MAP_FIXED) {
+		uint32_t fixed_first = 0, fixed_pages = 0;
+		const int32_t res = _range(args->addr, args->len, &fixed_first, &fixed_pages);
+
+		if (res < 0) {
+			return res;
+		};
+		first = fixed_first;
+	} else {
+		first = _find_free(self, pages);
+
+		if (first < 0) {
+			return first;
+		};
+	};
+	struct fd_t* file = 0x0;
+
+	if (!anonymous) {
+		file = vfs_fget(args->fd);
+
+		if (!file) {
+			return -EBADF;
+		};
+
+		// Shared pages come from the file itself, private ones are read at an offset (no pipes)
+		if ((type == MAP_SHARED && !file->fs->map_cb) || (type == MAP_PRIVATE && !file->fs->pread_cb)) {
+			vfs_fput(file);
+			return -ENODEV;
+		};
+	};
+
+	for (uint32_t i = 0; i < pages; i++) {
+		mmap_page_t* page = &self->mmap[first + i];
+
+		// MAP_FIXED replaces whatever was there
+		if (page->flags & MMAP_PAGE_USED) {
+			_unmap_slot(self, first + i);
+		};
+		page->flags = MMAP_PAGE_USED;
+		page->prot = args->prot & (PROT_READ | PROT_WRITE | PROT_EXEC);
+
+		if (file) {
+			// Every page holds its own reference, munmap may split the mapping
+			page->file = (i == 0) ? file : vfs_fget(args->fd);
+			page->offset = args->offset + i * PAGE_SIZE;
+
+			if (type == MAP_SHARED) {
+				page->flags |= MMAP_PAGE_SHARED;
+			};
+		};
+	};
+	return USER_MMAP_START + first * PAGE_SIZE;
+};
+
+/**
+ * @brief Removes every mapping in addr..addr+len, unmapped parts of the range are skipped.
+ */
+int32_t mmap_unmap(process_t* self, const uint32_t addr, const uint32_t len)
+{
+	uint32_t first = 0, pages = 0;
+	const int32_t res = _range(addr, len, &first, &pages);
+
+	if (res < 0) {
+		return res;
+	};
+
+	if (!self->mmap) {
+		return 0;
+	};
+
+	for (uint32_t slot = first; slot < first + pages; slot++) {
+		if (self->mmap[slot].flags & MMAP_PAGE_USED) {
+			_unmap_slot(self, slot);
+		};
+	};
+	return 0;
+};
+
+/**
+ * @brief Changes the protection of mapped pages, pages already faulted in get new PDE flags.
+ * @return 0, -EINVAL or -ENOMEM if part of the range is not mapped
+ */
+int32_t mmap_protect(process_t* self, const uint32_t addr, const uint32_t len, const uint32_t prot)
+{
+	uint32_t first = 0, pages = 0;
+	const int32_t res = _range(addr, len, &first, &pages);
+
+	if (res < 0) {
+		return res;
+	};
+
+	if (prot & ~(PROT_READ | PROT_WRITE | PROT_EXEC)) {
+		return -EINVAL;
+	};
+
+	for (uint32_t slot = first; slot < first + pages; slot++) {
+		if (!self->mmap || !(self->mmap[slot].flags & MMAP_PAGE_USED)) {
+			return -ENOMEM;
+		};
+	};
+
+	for (uint32_t slot = first; slot < first + pages; slot++) {
+		mmap_page_t* page = &self->mmap[slot];
+		const uint32_t virt_addr = USER_MMAP_START + slot * PAGE_SIZE;
+		const uint32_t phys_addr = page_get_phys_addr(self->page_dir, virt_addr);
+		page->prot = prot;
+
+		if (phys_addr) {
+			page_map_dir(self->page_dir, virt_addr, phys_addr, _page_flags(page->prot));
+		};
+	};
+	return 0;
+};
+
+/**
+ * @brief Called by the #PF handler for a not present page in the mmap region.
+ *
+ * Runs on the faulting process' directory, so the new frame is filled through its user address.
+ * @return true if the page was mapped and the access can be retried
+ */
+bool mmap_fault(process_t* self, const uint32_t fault_addr, const uint32_t error_code)
+{
+	if (!self || !self->mmap || fault_addr < USER_MMAP_START || fault_addr > USER_MMAP_END || (error_code & PAGE_PRESENT)) {
+		return false;
+	};
+	mmap_page_t* page = &self->mmap[(fault_addr - USER_MMAP_START) / PAGE_SIZE];
+
+	if (!(page->flags & MMAP_PAGE_USED) || page->prot == PROT_NONE) {
+		return false;
+	};
+
+	if ((error_code & PAGE_WRITABLE) && !(page->prot & PROT_WRITE)) {
+		return false;
+	};
+	const uint32_t virt_addr = fault_addr & 0xFFC00000;
+
+	if (page->flags & MMAP_PAGE_SHARED) {
+		bool fresh = false;
+		const uint32_t frame = page->file->fs->map_cb(page->file->internal, page->offset, &fresh);
+
+		if (!frame) {
+			return false;
+		};
+
+		// Interrupts are off, no other mapper can see the frame before it is zeroed
+		if (fresh) {
+			page_map_dir(self->page_dir, virt_addr, frame, PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE);
+			memset((void*)virt_addr, 0, PAGE_SIZE);
+		};
+		page_map_dir(self->page_dir, virt_addr, frame, _page_flags(page->prot));
+		return true;
+	};
+	const uint32_t frame = pfa_alloc();
+
+	if (!frame) {
+		return false;
+	};
+	page_map_dir(self->page_dir, virt_addr, frame, PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE);
+	size_t filled = 0;
+
+	if (page->file) {
+		const int32_t n = vfs_file_pread(page->file, (void*)virt_addr, PAGE_SIZE, page->offset);
+		filled = (n > 0) ? n : 0;
+	};
+	// Anonymous memory and the part behind the end of the file read as zero
+	memset((uint8_t*)virt_addr + filled, 0, PAGE_SIZE - filled);
+	page_map_dir(self->page_dir, virt_addr, frame, _page_flags(page->prot));
+	return true;
+};
+
+/**
+ * @brief Drops the file references and the slot table, the frames go with the rest of the user half.
+ */
+void mmap_release(process_t* self)
+{
+	if (!self->mmap) {
+		return;
+	};
+
+	for (uint32_t slot = 0; slot < USER_MMAP_PAGES; slot++) {
+		if (self->mmap[slot].file) {
+			vfs_fput(self->mmap[slot].file);
+		};
+	};
+	kfree(self->mmap);
+	self->mmap = 0x0;
+	return;
+};
\ No newline at end of file
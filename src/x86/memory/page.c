@@ -13,6 +13,9 @@
 extern pfa_t pfa;
 extern uint32_t kernel_directory[1024];
 
+/* INTERNAL API */
+static uint32_t* _dirs[PROCESS_MAX] = {};
+
 /* PUBLIC API */
 void page_dump_dir(const uint32_t* dir);
 uint32_t* page_create_dir(const uint32_t flags);
@@ -25,6 +28,9 @@ void page_unmap_dir(uint32_t* dir, const uint32_t virt_addr);
 void page_unmap_between(uint32_t* dir, uint32_t virt_start_addr, const uint32_t virt_end_addr);
 uint32_t page_get_phys_addr(uint32_t* dir, const uint32_t virt_addr);
 void page_restore_kernel_dir(void);
+void page_map_kernel(const uint32_t virt_addr, const uint32_t phys_addr, const uint32_t flags);
+void page_unmap_kernel(const uint32_t virt_addr);
+void page_destroy_dir(uint32_t* dir);
 
 void page_dump_dir(const uint32_t* dir)
 {
@@ -54,6 +60,16 @@ void page_dump_dir(const uint32_t* dir)
 
 uint32_t* page_create_dir(const uint32_t flags)
 {
+	size_t slot = 0;
+
+	while (slot < PROCESS_MAX && _dirs[slot]) {
+		slot++;
+	};
+
+	if (slot == PROCESS_MAX) {
+		kprintf("[ERROR] No free Page Directory slot!\n");
+		return 0x0;
+	};
 	uint64_t phys_addr = pfa_alloc();
 
 	if (!phys_addr) {
@@ -66,8 +82,8 @@ uint32_t* page_create_dir(const uint32_t flags)
 	};
 	const uint32_t virt_addr = (uint32_t)p2v((uint32_t)phys_addr);
 	uint32_t* dir = (uint32_t*)virt_addr;
-	// Map the newly created page directory into the kernel's page directory so it can be accessed from kernel space
-	page_map_dir(page_get_dir(), virt_addr, phys_addr, flags);
+	// Map the newly created page directory into the kernel half of every directory, kernel-only whatever the user flags are
+	page_map_kernel(virt_addr, phys_addr, flags & ~PAGE_USER);
 	// Init the new page dir with 0x0
 	memset((void*)virt_addr, 0, PAGE_SIZE);
 	// Copy kernel mappings into the new page directory
@@ -78,9 +94,31 @@ uint32_t* page_create_dir(const uint32_t flags)
 			dir[i] = (entry & 0xFFFFF000) | (PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE);
 		};
 	};
+	_dirs[slot] = dir;
 	return dir;
 };
 
+/**
+ * @brief Frees a directory made by page_create_dir, its user half must already be released.
+ */
+void page_destroy_dir(uint32_t* dir)
+{
+	if (!dir || dir == kernel_directory) {
+		return;
+	};
+
+	for (size_t i = 0; i < PROCESS_MAX; i++) {
+		if (_dirs[i] == dir) {
+			_dirs[i] = 0x0;
+			break;
+		};
+	};
+	const uint32_t phys_addr = (uint32_t)v2p((void*)dir);
+	page_unmap_kernel((uint32_t)dir);
+	pfa_clear(&pfa, phys_addr / PAGE_SIZE);
+	return;
+};
+
 void page_set_dir(const uint32_t* self)
 {
 	asm volatile("mov %0, %%cr3" : : "r"(self));
@@ -103,6 +141,33 @@ void page_map(const uint32_t virt_addr, const uint32_t phys_addr, const uint32_t
 	return;
 };
 
+/**
+ * @brief Maps a kernel half page (>= KERNEL_VIRTUAL_START) into the kernel directory and every process directory.
+ *
+ * The kernel half is identical in all directories, so a syscall can stay on the caller's
+ * directory and reach user memory directly instead of switching CR3 back and forth.
+ */
+void page_map_kernel(const uint32_t virt_addr, const uint32_t phys_addr, const uint32_t flags)
+{
+	const uint32_t pd_index = virt_addr >> 22;
+	const uint32_t entry = (phys_addr & 0xFFC00000) | (flags & 0xFFF);
+	kernel_directory[pd_index] = entry;
+
+	for (size_t i = 0; i < PROCESS_MAX; i++) {
+		if (_dirs[i]) {
+			_dirs[i][pd_index] = entry;
+		};
+	};
+	asm volatile("invlpg (%0)" ::"r"(virt_addr) : "memory");
+	return;
+};
+
+void page_unmap_kernel(const uint32_t virt_addr)
+{
+	page_map_kernel(virt_addr, 0x0, 0x0);
+	return;
+};
+
 void page_map_dir(uint32_t* dir, const uint32_t virt_addr, const uint32_t phys_addr, const uint32_t flags)
 {
 	const uint32_t pd_index = virt_addr >> 22;
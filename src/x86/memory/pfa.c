@@ -5,6 +5,7 @@
  */
 
 #include "pfa.h"
+#include "idt.h"
 #include "string.h"
 
 /* PUBLIC API */
@@ -14,6 +15,8 @@ void pfa_clear(pfa_t* self, const uint64_t frame);
 bool pfa_test(const pfa_t* self, const uint64_t frame);
 void pfa_dump(const pfa_t* self, const bool verbose);
 uint64_t pfa_alloc(void);
+void pfa_ref(pfa_t* self, const uint64_t frame);
+uint16_t pfa_put(pfa_t* self, const uint64_t frame);
 
 /* INTERNAL API */
 static inline uint32_t _index_from_bit(const uint64_t frame);
@@ -51,6 +54,7 @@ void pfa_clear(pfa_t* self, const uint64_t frame)
 	const uint64_t index = frame / 32;
 	const uint64_t offset = frame % 32;
 	self->frames_bitmap[index] &= ~(1 << offset);
+	self->frames_refs[frame] = 0;
 	return;
 };
 
@@ -110,12 +114,52 @@ void pfa_dump(const pfa_t* self, const bool verbose)
 
 uint64_t pfa_alloc(void)
 {
+	const uint32_t eflags = asm_irq_save();
+
 	for (uint32_t frame = 0; frame < MAX_FRAMES; frame++) {
 		if (!pfa_test(&pfa, frame)) {
 			pfa_set(&pfa, frame);
+			pfa.frames_refs[frame] = 1;
+			asm_irq_restore(eflags);
 			const uint64_t phys_addr = frame * PAGE_SIZE;
 			return phys_addr;
 		};
 	};
+	asm_irq_restore(eflags);
 	return 0x0;
+};
+
+/**
+ * @brief Takes another reference on an allocated frame, i.e. maps it into one more address space.
+ */
+void pfa_ref(pfa_t* self, const uint64_t frame)
+{
+	const uint32_t eflags = asm_irq_save();
+	self->frames_refs[frame]++;
+	asm_irq_restore(eflags);
+	return;
+};
+
+/**
+ * @brief Drops a reference, the frame goes back to the allocator with the last one.
+ *
+ * Frames that never went through pfa_alloc() (refs == 0) are freed right away, like pfa_clear().
+ * @return References left
+ */
+uint16_t pfa_put(pfa_t* self, const uint64_t frame)
+{
+	const uint32_t eflags = asm_irq_save();
+	uint16_t refs = self->frames_refs[frame];
+
+	if (refs > 0) {
+		refs--;
+	};
+
+	if (refs == 0) {
+		pfa_clear(self, frame);
+	} else {
+		self->frames_refs[frame] = refs;
+	};
+	asm_irq_restore(eflags);
+	return refs;
 };
\ No newline at end of file
@@ -0,0 +1,213 @@
+/**
+ * @file shm.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief POSIX-style shared memory objects (shm_open / shm_unlink)
+ *
+ * An object is a named set of up to SHM_MAX_PAGES frames behind a VFS descriptor. mmap(MAP_SHARED)
+ * on that descriptor maps the very same frames into every caller, each mapping holds its own
+ * pfa reference, so unlinking or closing never pulls a frame out from under a mapper.
+ */
+
+#include "shm.h"
+#include "errno.h"
+#include "heap.h"
+#include "page.h"
+#include "pfa.h"
+#include "string.h"
+#include "vfs.h"
+
+/* EXTERNAL API */
+extern pfa_t pfa;
+
+/* PUBLIC API */
+int32_t shm_open(const char* name, const uint32_t flags);
+int32_t shm_unlink(const char* name);
+int32_t shm_close(void* internal);
+uint32_t shm_map(void* internal, const uint32_t offset, bool* fresh);
+
+/* INTERNAL API */
+static int32_t _check_name(const char* name);
+static shm_object_t** _find(const char* name);
+static void _destroy(shm_object_t* self);
+
+static shm_object_t* _objects[SHM_MAX_OBJECTS] = {};
+
+fs_t shm_fs = {
+    .resolve_cb = 0x0,
+    .open_cb = 0x0,
+    .read_cb = 0x0,
+    .close_cb = shm_close,
+    .stat_cb = 0x0,
+    .seek_cb = 0x0,
+    .write_cb = 0x0,
+    .readdir_cb = 0x0,
+    .pread_cb = 0x0,
+    .pwrite_cb = 0x0,
+    .poll_cb = 0x0,
+    .map_cb = shm_map,
+    .sync_cb = 0x0,
+    .name = "SHM",
+};
+
+// "/name", no further slashes, like the portable POSIX names
+static int32_t _check_name(const char* name)
+{
+	const size_t len = strlen(name);
+
+	if (len < 2 || name[0] != '/') {
+		return -EINVAL;
+	};
+
+	if (len >= SHM_NAME_MAX) {
+		return -ENAMETOOLONG;
+	};
+
+	for (size_t i = 1; i < len; i++) {
+		if (name[i] == '/') {
+			return -EINVAL;
+		};
+	};
+	return 0;
+};
+
+static shm_object_t** _find(const char* name)
+{
+	for (size_t i = 0; i < SHM_MAX_OBJECTS; i++) {
+		if (_objects[i] && strcmp(_objects[i]->name, name) == 0) {
+			return &_objects[i];
+		};
+	};
+	return 0x0;
+};
+
+static void _destroy(shm_object_t* self)
+{
+	for (size_t i = 0; i < SHM_MAX_PAGES; i++) {
+		if (self->frames[i]) {
+			pfa_put(&pfa, self->frames[i] / PAGE_SIZE);
+		};
+	};
+	kfree(self);
+	return;
+};
+
+/**
+ * @brief Opens (VFS_CREATE: creates) the object name.
+ * @return A VFS descriptor, -ENOENT, -EEXIST (VFS_CREATE | VFS_EXCL) or another negative errno
+ */
+int32_t shm_open(const char* name, const uint32_t flags)
+{
+	const int32_t res = _check_name(name);
+
+	if (res < 0) {
+		return res;
+	};
+	shm_object_t** slot = _find(name);
+	shm_object_t* self = slot ? *slot : 0x0;
+	bool created = false;
+
+	if (self && (flags & VFS_CREATE) && (flags & VFS_EXCL)) {
+		return -EEXIST;
+	};
+
+	if (!self) {
+		if (!(flags & VFS_CREATE)) {
+			return -ENOENT;
+		};
+
+		for (size_t i = 0; !slot && i < SHM_MAX_OBJECTS; i++) {
+			if (!_objects[i]) {
+				slot = &_objects[i];
+			};
+		};
+
+		if (!slot) {
+			return -ENOSPC;
+		};
+		self = kzalloc(sizeof(shm_object_t));
+
+		if (!self) {
+			return -ENOMEM;
+		};
+		strncpy(self->name, name, SHM_NAME_MAX - 1);
+		*slot = self;
+		created = true;
+	};
+	const int32_t fd = vfs_fattach(&shm_fs, self);
+
+	if (fd < 0) {
+		// Don't leave an object behind that nobody got to see
+		if (created) {
+			*slot = 0x0;
+			_destroy(self);
+		};
+		return fd;
+	};
+	self->refs++;
+	return fd;
+};
+
+/**
+ * @brief Removes name, descriptors and mappings keep the object until they are gone.
+ */
+int32_t shm_unlink(const char* name)
+{
+	const int32_t res = _check_name(name);
+
+	if (res < 0) {
+		return res;
+	};
+	shm_object_t** slot = _find(name);
+
+	if (!slot) {
+		return -ENOENT;
+	};
+	shm_object_t* self = *slot;
+	*slot = 0x0;
+	self->unlinked = true;
+
+	if (!self->refs) {
+		_destroy(self);
+	};
+	return 0;
+};
+
+int32_t shm_close(void* internal)
+{
+	shm_object_t* self = internal;
+	self->refs--;
+
+	// A linked object keeps its contents without any descriptor, like a file
+	if (!self->refs && self->unlinked) {
+		_destroy(self);
+	};
+	return 0;
+};
+
+/**
+ * @brief fs_t.map_cb, the frame behind offset with a reference for the caller's mapping.
+ * @param fresh Set if the frame was just allocated, the caller zeroes it before anyone can see it
+ * @return The physical frame, 0 if offset is past SHM_MAX_PAGES or out of frames
+ */
+uint32_t shm_map(void* internal, const uint32_t offset, bool* fresh)
+{
+	shm_object_t* self = internal;
+	const uint32_t page = offset / PAGE_SIZE;
+	*fresh = false;
+
+	if (page >= SHM_MAX_PAGES) {
+		return 0;
+	};
+
+	if (!self->frames[page]) {
+		self->frames[page] = pfa_alloc();
+
+		if (!self->frames[page]) {
+			return 0;
+		};
+		*fresh = true;
+	};
+	pfa_ref(&pfa, self->frames[page] / PAGE_SIZE);
+	return self->frames[page];
+};
\ No newline at end of file
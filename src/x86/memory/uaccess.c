@@ -0,0 +1,152 @@
+/**
+ * @file uaccess.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Syscall access to user memory
+ *
+ * Syscalls run on the caller's page directory (the kernel half is shared), so user pointers
+ * are dereferenced in place. A bad pointer below KERNEL_VIRTUAL_START page faults inside the
+ * asm_uaccess_* routines and comes back as -EFAULT instead of a kernel panic.
+ */
+
+#include "uaccess.h"
+#include "errno.h"
+#include "task.h"
+
+/* EXTERNAL API */
+extern int32_t asm_copy_user(void* dst, const void* src, const uint32_t n);
+extern int32_t asm_strncpy_user(char* dst, const char* src, const uint32_t n);
+extern uint8_t asm_uaccess_start[];
+extern uint8_t asm_uaccess_end[];
+extern uint8_t asm_uaccess_fixup[];
+
+/* PUBLIC API */
+int32_t copy_from_user(void* dst, const void* user_src, const size_t n);
+int32_t copy_to_user(void* user_dst, const void* src, const size_t n);
+int32_t strncpy_from_user(char* dst, const char* user_src, const size_t n);
+bool uaccess_fixup(interrupt_frame_t* frame, const uint32_t fault_addr);
+
+/* INTERNAL API */
+static bool _user_range(const void* user_ptr, const size_t n);
+static bool _user_pages(const void* user_ptr, const size_t n, const bool write);
+
+static bool _user_range(const void* user_ptr, const size_t n)
+{
+	const uintptr_t start = (uintptr_t)user_ptr;
+	return start < KERNEL_VIRTUAL_START && n <= KERNEL_VIRTUAL_START - start;
+};
+
+/**
+ * @brief Ring 0 ignores PAGE_USER and, with CR0.WP off, PAGE_WRITABLE too.
+ *
+ * Missing pages are left to the #PF fixup, present ones ring 3 couldn't reach (PROT_NONE) or,
+ * for writes, couldn't write (shared text) are refused here.
+ */
+static bool _user_pages(const void* user_ptr, const size_t n, const bool write)
+{
+	const task_t* task = task_get_curr();
+
+	if (!task || !task->parent || !task->parent->page_dir) {
+		return false;
+	};
+	const uint32_t* dir = task->parent->page_dir;
+	const uint32_t first = (uintptr_t)user_ptr >> 22;
+	const uint32_t last = ((uintptr_t)user_ptr + n - 1) >> 22;
+
+	for (uint32_t i = first; i <= last; i++) {
+		if (!(dir[i] & PAGE_PRESENT)) {
+			continue;
+		};
+
+		if (!(dir[i] & PAGE_USER) || (write && !(dir[i] & PAGE_WRITABLE))) {
+			return false;
+		};
+	};
+	return true;
+};
+
+/**
+ * @return 0 or -EFAULT
+ */
+int32_t copy_from_user(void* dst, const void* user_src, const size_t n)
+{
+	if (!n) {
+		return 0;
+	};
+
+	if (!user_src || !_user_range(user_src, n) || !_user_pages(user_src, n, false)) {
+		return -EFAULT;
+	};
+	return asm_copy_user(dst, user_src, n);
+};
+
+/**
+ * @return 0 or -EFAULT
+ */
+int32_t copy_to_user(void* user_dst, const void* src, const size_t n)
+{
+	if (!n) {
+		return 0;
+	};
+
+	if (!user_dst || !_user_range(user_dst, n) || !_user_pages(user_dst, n, true)) {
+		return -EFAULT;
+	};
+	return asm_copy_user(user_dst, src, n);
+};
+
+/**
+ * @brief Copies a user string into dst (n bytes), dst is always 0 terminated.
+ * @return Length of the string, -ENAMETOOLONG if it does not fit into n bytes, or -EFAULT
+ */
+int32_t strncpy_from_user(char* dst, const char* user_src, const size_t n)
+{
+	if (!n) {
+		return -ENAMETOOLONG;
+	};
+
+	if (!user_src || (uintptr_t)user_src >= KERNEL_VIRTUAL_START) {
+		return -EFAULT;
+	};
+	// Never walk off the user half looking for the terminator
+	size_t max = KERNEL_VIRTUAL_START - (uintptr_t)user_src;
+	max = (n < max) ? n : max;
+
+	const int32_t len = asm_strncpy_user(dst, user_src, max);
+
+	if (len < 0) {
+		dst[0] = '\0';
+		return len;
+	};
+
+	// The length is only known now, so the pages are checked after the fact
+	if (!_user_pages(user_src, ((size_t)len < max) ? (size_t)len + 1 : max, false)) {
+		dst[0] = '\0';
+		return -EFAULT;
+	};
+
+	if ((size_t)len == max) {
+		dst[max - 1] = '\0';
+		return (max == n) ? -ENAMETOOLONG : -EFAULT;
+	};
+	return len;
+};
+
+/**
+ * @brief Called by the #PF handler for ring 0 faults.
+ *
+ * A fault on a user address inside one of the asm_uaccess_* routines resumes at the fixup (-EFAULT).
+ * @return true if the fault was handled
+ */
+bool uaccess_fixup(interrupt_frame_t* frame, const uint32_t fault_addr)
+{
+	if (fault_addr >= KERNEL_VIRTUAL_START) {
+		return false;
+	};
+
+	if (frame->eip < (uintptr_t)asm_uaccess_start || frame->eip >= (uintptr_t)asm_uaccess_end) {
+		return false;
+	};
+	frame->eip = (uintptr_t)asm_uaccess_fixup;
+	return true;
+};
\ No newline at end of file
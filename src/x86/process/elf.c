@@ -0,0 +1,339 @@
+/**
+ * @file elf.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief ELF32 loader, maps the PT_LOAD segments of an executable into a process
+ */
+
+#include "elf.h"
+#include "errno.h"
+#include "heap.h"
+#include "image.h"
+#include "page.h"
+#include "pfa.h"
+#include "string.h"
+#include "vfs.h"
+
+extern pfa_t pfa;
+
+/* PUBLIC API */
+int32_t elf_load(process_t* proc, const char* filepath);
+
+/* INTERNAL API */
+static int32_t _read_at(const int32_t fd, void* buffer, const uint32_t offset, const uint32_t size);
+static int32_t _check_header(const elf32_ehdr_t* ehdr);
+static int32_t _check_segment(const elf32_phdr_t* phdr);
+static bool _is_shared(const image_t* image, const elf32_phdr_t* phdr);
+static int32_t _image_prepare(image_t* image, const int32_t fd);
+static int32_t _map_image(uint32_t* dir, const image_t* image);
+
+static int32_t _read_at(const int32_t fd, void* buffer, const uint32_t offset, const uint32_t size)
+{
+	if (size == 0) {
+		return 0;
+	};
+
+	if (vfs_fseek(fd, offset, SEEK_SET) < 0) {
+		return -EIO;
+	};
+	const size_t bytes_read = vfs_fread(buffer, size, 1, fd);
+	return (bytes_read == size) ? 0 : -EIO;
+};
+
+static int32_t _check_header(const elf32_ehdr_t* ehdr)
+{
+	if (*(const uint32_t*)ehdr->ident != ELF_MAGIC) {
+		return -ENOEXEC;
+	};
+
+	if (ehdr->ident[4] != ELF_CLASS_32 || ehdr->ident[5] != ELF_DATA_LSB) {
+		return -EINVAL;
+	};
+
+	if (ehdr->type != ELF_ET_EXEC || ehdr->machine != ELF_EM_386) {
+		return -EINVAL;
+	};
+
+	if (ehdr->phentsize != sizeof(elf32_phdr_t) || ehdr->phnum == 0 || ehdr->phnum > ELF_MAX_PHNUM) {
+		return -EINVAL;
+	};
+
+	if (ehdr->entry > USER_IMAGE_END) {
+		return -EINVAL;
+	};
+	return 0;
+};
+
+static int32_t _check_segment(const elf32_phdr_t* phdr)
+{
+	if (phdr->filesz > phdr->memsz) {
+		return -EINVAL;
+	};
+	// Written this way round so vaddr + memsz cannot wrap
+	if (phdr->vaddr > USER_IMAGE_END || phdr->memsz > USER_IMAGE_END - phdr->vaddr + 1) {
+		return -EINVAL;
+	};
+	return 0;
+};
+
+/**
+ * @brief True if every page of the segment is a shared read-only frame.
+ */
+static bool _is_shared(const image_t* image, const elf32_phdr_t* phdr)
+{
+	const uint32_t first = phdr->vaddr / PAGE_SIZE;
+	const uint32_t last = (phdr->vaddr + phdr->memsz - 1) / PAGE_SIZE;
+
+	for (uint32_t page = first; page <= last; page++) {
+		if (!image->frames[page]) {
+			return false;
+		};
+	};
+	return true;
+};
+
+/**
+ * @brief First spawn of an executable: reads the program headers and sets up the cache entry.
+ *
+ * Permissions only exist per 4 MiB page, so a page is private (and writable) as soon as one
+ * writable segment touches it. All other pages get a shared frame, owned by the cache.
+ * File bytes of segments on private pages are kept in memory, the shared frames are filled
+ * later through the mapping of the first process.
+ */
+static int32_t _image_prepare(image_t* image, const int32_t fd)
+{
+	int32_t res = _read_at(fd, image->phdrs, image->ehdr.phoff, image->ehdr.phnum * sizeof(elf32_phdr_t));
+
+	if (res < 0) {
+		return res;
+	};
+	uint32_t used[(USER_IMAGE_PAGES + 31) / 32] = {};
+	uint32_t writable[(USER_IMAGE_PAGES + 31) / 32] = {};
+
+	for (uint16_t i = 0; i < image->ehdr.phnum; i++) {
+		const elf32_phdr_t* phdr = &image->phdrs[i];
+
+		if (phdr->type != ELF_PT_LOAD) {
+			continue;
+		};
+		res = _check_segment(phdr);
+
+		if (res < 0) {
+			return res;
+		};
+
+		if (phdr->memsz == 0) {
+			continue;
+		};
+		const uint32_t first = phdr->vaddr / PAGE_SIZE;
+		const uint32_t last = (phdr->vaddr + phdr->memsz - 1) / PAGE_SIZE;
+
+		for (uint32_t page = first; page <= last; page++) {
+			used[page / 32] |= (1 << (page % 32));
+
+			if (phdr->flags & ELF_PF_W) {
+				writable[page / 32] |= (1 << (page % 32));
+			};
+		};
+	};
+
+	for (uint32_t page = 0; page < USER_IMAGE_PAGES; page++) {
+		if (!(used[page / 32] & (1 << (page % 32))) || (writable[page / 32] & (1 << (page % 32)))) {
+			continue;
+		};
+		const uint32_t frame = pfa_alloc();
+
+		if (!frame) {
+			kprintf("[ERROR] Page Frame Allocator exhausted!\n");
+			return -ENOMEM;
+		};
+		image->frames[page] = frame;
+	};
+
+	for (uint16_t i = 0; i < image->ehdr.phnum; i++) {
+		const elf32_phdr_t* phdr = &image->phdrs[i];
+
+		if (phdr->type != ELF_PT_LOAD || phdr->filesz == 0 || _is_shared(image, phdr)) {
+			continue;
+		};
+		image->data[i] = kzalloc(phdr->filesz);
+
+		if (!image->data[i]) {
+			return -ENOMEM;
+		};
+		res = _read_at(fd, image->data[i], phdr->offset, phdr->filesz);
+
+		if (res < 0) {
+			return res;
+		};
+	};
+	return 0;
+};
+
+/**
+ * @brief Maps the shared frames read-only and fresh private frames writable into dir.
+ */
+static int32_t _map_image(uint32_t* dir, const image_t* image)
+{
+	uint32_t used[(USER_IMAGE_PAGES + 31) / 32] = {};
+
+	for (uint16_t i = 0; i < image->ehdr.phnum; i++) {
+		const elf32_phdr_t* phdr = &image->phdrs[i];
+
+		if (phdr->type != ELF_PT_LOAD || phdr->memsz == 0) {
+			continue;
+		};
+		const uint32_t first = phdr->vaddr / PAGE_SIZE;
+		const uint32_t last = (phdr->vaddr + phdr->memsz - 1) / PAGE_SIZE;
+
+		for (uint32_t page = first; page <= last; page++) {
+			used[page / 32] |= (1 << (page % 32));
+		};
+	};
+
+	for (uint32_t page = 0; page < USER_IMAGE_PAGES; page++) {
+		if (!(used[page / 32] & (1 << (page % 32)))) {
+			continue;
+		};
+
+		if (image->frames[page]) {
+			pfa_ref(&pfa, image->frames[page] / PAGE_SIZE);
+			page_map_dir(dir, page * PAGE_SIZE, image->frames[page], (PAGE_PS | PAGE_PRESENT | PAGE_USER));
+			continue;
+		};
+		const uint32_t frame = pfa_alloc();
+
+		if (!frame) {
+			kprintf("[ERROR] Page Frame Allocator exhausted!\n");
+			return -ENOMEM;
+		};
+		page_map_dir(dir, page * PAGE_SIZE, frame, (PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE | PAGE_USER));
+	};
+	return 0;
+};
+
+/**
+ * @brief Loads an ELF32 executable into the (fresh) address space of proc.
+ *
+ * Goes through the image cache: the first spawn reads the file once, every later spawn of the
+ * unmodified file maps the resident read-only frames and copies the private segments from memory.
+ * On error the frames mapped so far stay in proc->page_dir and go with the address space.
+ *
+ * @return 0 on success, -ENOEXEC if the file is not an ELF at all, -EINVAL for unusable ELFs, -EIO, -ENOMEM
+ */
+int32_t elf_load(process_t* proc, const char* filepath)
+{
+	if (!proc || !proc->page_dir) {
+		return -EINVAL;
+	};
+	const int32_t fd = vfs_fopen(filepath, "r");
+
+	if (fd < 0) {
+		return -ENOENT;
+	};
+	vstat_t stat_buf = {};
+
+	if (vfs_fstat(fd, &stat_buf) < 0) {
+		vfs_fclose(fd);
+		return -EIO;
+	};
+	image_t* image = image_lookup(filepath, stat_buf.st_mtime);
+	const bool fresh = !image;
+	int32_t res = 0;
+
+	if (fresh) {
+		// Check the header first, flat binaries must not push real images out of the cache
+		elf32_ehdr_t ehdr = {};
+		res = _read_at(fd, &ehdr, 0, sizeof(elf32_ehdr_t));
+
+		if (res == 0) {
+			res = _check_header(&ehdr);
+		};
+
+		if (res < 0) {
+			vfs_fclose(fd);
+			return res;
+		};
+		image = image_create(filepath, stat_buf.st_mtime, stat_buf.st_size);
+
+		if (!image) {
+			vfs_fclose(fd);
+			return -ENOMEM;
+		};
+		image->ehdr = ehdr;
+		res = _image_prepare(image, fd);
+	};
+
+	if (res == 0) {
+		res = _map_image(proc->page_dir, image);
+	};
+
+	if (res == 0) {
+		// CR0.WP is clear, so ring 0 may fill the read-only pages through the user mapping
+		uint32_t* prev_dir = page_get_dir();
+		page_set_dir((uint32_t*)v2p((void*)proc->page_dir));
+
+		// Fresh frames hold whatever was there before, gaps between segments must read as zero.
+		// Private frames are fresh on every spawn, shared ones only for the process filling them.
+		for (uint32_t page = 0; page < USER_IMAGE_PAGES; page++) {
+			const bool shared = image->frames[page] != 0;
+
+			if ((proc->page_dir[page] & PAGE_PRESENT) && (!shared || fresh)) {
+				memset((void*)(page * PAGE_SIZE), 0, PAGE_SIZE);
+			};
+		};
+
+		for (uint16_t i = 0; res == 0 && i < image->ehdr.phnum; i++) {
+			const elf32_phdr_t* phdr = &image->phdrs[i];
+
+			if (phdr->type != ELF_PT_LOAD || phdr->memsz == 0) {
+				continue;
+			};
+
+			if (_is_shared(image, phdr)) {
+				// Shared frames are only filled once, by the process that brought the image in (before image_publish)
+				if (!fresh) {
+					continue;
+				};
+				res = _read_at(fd, (void*)phdr->vaddr, phdr->offset, phdr->filesz);
+			} else if (phdr->filesz) {
+				memcpy((void*)phdr->vaddr, image->data[i], phdr->filesz);
+			};
+			memset((void*)(phdr->vaddr + phdr->filesz), 0, phdr->memsz - phdr->filesz);
+		};
+		page_set_dir(prev_dir);
+	};
+
+	if (res < 0) {
+		vfs_fclose(fd);
+
+		if (fresh) {
+			image_discard(image);
+		};
+		return res;
+	};
+
+	// Only now other spawns may find the image, its shared frames are complete
+	if (fresh) {
+		image_publish(image);
+	};
+	// Closing may sleep on the disk, by then the entry can already be evicted
+	const elf32_ehdr_t ehdr = image->ehdr;
+	vfs_fclose(fd);
+	elf_file_t* elf_file = kzalloc(sizeof(elf_file_t));
+
+	if (!elf_file) {
+		return -ENOMEM;
+	};
+	elf_file->entry = ehdr.entry;
+	elf_file->ph_offset = ehdr.phoff;
+	elf_file->ph_num = ehdr.phnum;
+	elf_file->ph_size = ehdr.phentsize;
+	elf_file->sh_offset = ehdr.shoff;
+	elf_file->sh_num = ehdr.shnum;
+	elf_file->sh_size = ehdr.shentsize;
+	proc->elf_file = elf_file;
+	proc->filetype = PROCESS_ELF;
+	kprintf("[INFO] Loaded ELF '%s' (Entry: 0x%x, %s)\n", filepath, ehdr.entry, fresh ? "from disk" : "cached");
+	return 0;
+};
\ No newline at end of file
@@ -0,0 +1,171 @@
+/**
+ * @file image.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Cache of loaded executables, keyed by path and modification time
+ */
+
+#include "image.h"
+#include "heap.h"
+#include "pfa.h"
+#include "string.h"
+
+extern pfa_t pfa;
+
+/* PUBLIC API */
+image_t* image_lookup(const char* path, const uint32_t mtime);
+image_t* image_create(const char* path, const uint32_t mtime, const uint32_t size);
+void image_publish(image_t* self);
+void image_discard(image_t* self);
+void image_dump(void);
+
+/* INTERNAL API */
+static image_t* _cache[IMAGE_CACHE_MAX] = {};
+static image_stats_t _stats = {};
+static uint32_t _clock = 0;
+static void _image_free(image_t* self);
+
+static void _image_free(image_t* self)
+{
+	// Processes still running the image keep their own references on the frames
+	for (uint32_t page = 0; page < USER_IMAGE_PAGES; page++) {
+		if (self->frames[page]) {
+			pfa_put(&pfa, self->frames[page] / PAGE_SIZE);
+		};
+	};
+
+	for (size_t i = 0; i < ELF_MAX_PHNUM; i++) {
+		if (self->data[i]) {
+			kfree(self->data[i]);
+		};
+	};
+	kfree(self);
+	return;
+};
+
+/**
+ * @brief Returns the cached image for path, unless the file was modified since it was loaded.
+ */
+image_t* image_lookup(const char* path, const uint32_t mtime)
+{
+	for (size_t i = 0; i < IMAGE_CACHE_MAX; i++) {
+		image_t* image = _cache[i];
+
+		if (!image || strcmp(image->path, path) != 0) {
+			continue;
+		};
+
+		if (image->mtime != mtime) {
+			_cache[i] = 0x0;
+			_image_free(image);
+			_stats.stale++;
+			break;
+		};
+		image->last_used = ++_clock;
+		_stats.hits++;
+		return image;
+	};
+	_stats.misses++;
+	return 0x0;
+};
+
+/**
+ * @brief Allocates an empty entry for path, it is not in the cache yet.
+ *
+ * Filling it in may sleep on the disk, other spawns must not find it before image_publish().
+ * If that fails the caller drops it with image_discard().
+ */
+image_t* image_create(const char* path, const uint32_t mtime, const uint32_t size)
+{
+	image_t* image = kzalloc(sizeof(image_t));
+
+	if (!image) {
+		return 0x0;
+	};
+	strncpy(image->path, path, sizeof(image->path) - 1);
+	image->mtime = mtime;
+	image->size = size;
+	return image;
+};
+
+/**
+ * @brief Puts a completely filled image into the cache.
+ *
+ * An entry for the same path (a concurrent spawn that loaded it as well) is replaced, otherwise
+ * the least recently used image is evicted if the cache is full.
+ */
+void image_publish(image_t* self)
+{
+	size_t slot = IMAGE_CACHE_MAX;
+	self->last_used = ++_clock;
+
+	for (size_t i = 0; i < IMAGE_CACHE_MAX; i++) {
+		if (_cache[i] && strcmp(_cache[i]->path, self->path) == 0) {
+			slot = i;
+			_stats.stale++;
+			break;
+		};
+	};
+
+	if (slot == IMAGE_CACHE_MAX) {
+		slot = 0;
+
+		for (size_t i = 0; i < IMAGE_CACHE_MAX; i++) {
+			if (!_cache[i]) {
+				slot = i;
+				break;
+			};
+
+			if (_cache[i]->last_used < _cache[slot]->last_used) {
+				slot = i;
+			};
+		};
+
+		if (_cache[slot]) {
+			_stats.evictions++;
+		};
+	};
+
+	if (_cache[slot]) {
+		_image_free(_cache[slot]);
+	};
+	_cache[slot] = self;
+	return;
+};
+
+// Drops an image that was never published, nobody else has mapped its frames
+void image_discard(image_t* self)
+{
+	if (!self) {
+		return;
+	};
+	_image_free(self);
+	return;
+};
+
+void image_dump(void)
+{
+	kprintf("\n====================================\n");
+	kprintf("          IMAGE CACHE DUMP          \n");
+	kprintf("====================================\n");
+	kprintf("Hits: %d | Misses: %d | Stale: %d | Evictions: %d\n", _stats.hits, _stats.misses, _stats.stale, _stats.evictions);
+
+	for (size_t i = 0; i < IMAGE_CACHE_MAX; i++) {
+		const image_t* image = _cache[i];
+
+		if (!image) {
+			continue;
+		};
+		uint32_t shared = 0;
+
+		for (uint32_t page = 0; page < USER_IMAGE_PAGES; page++) {
+			if (image->frames[page]) {
+				shared++;
+			};
+		};
+		kprintf("[%d] %s (%d Bytes, mtime 0x%x) | Shared Pages: %d | Last Used: %d\n", i, image->path, image->size, image->mtime,
+			shared, image->last_used);
+	};
+	kprintf("====================================\n");
+	return;
+};
\ No newline at end of file
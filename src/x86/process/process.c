@@ -5,10 +5,18 @@
  */
 
 #include "process.h"
+#include "clock.h"
+#include "elf.h"
 #include "errno.h"
+#include "ipc.h"
+#include "kwork.h"
+#include "mmap.h"
 #include "stdlib.h"
 #include "string.h"
 #include "task.h"
+#include "tty.h"
+#include "vfs.h"
+#include "wq.h"
 
 extern pfa_t pfa;
 extern uint32_t kernel_directory[1024];
@@ -17,17 +25,36 @@ extern uint32_t kernel_directory[1024];
 void process_set_curr(process_t* self);
 process_t* process_get_curr(void);
 process_t* process_spawn(const char* filepath);
+process_t* process_spawnv(const char* filepath, char* const argv[], char* const envp[]);
 process_t* process_kspawn(void (*entry)(), const char* name);
 void process_list_dump(void);
-void process_exit(process_t* self);
+void process_exit(process_t* self, const int32_t status);
+process_t* process_get(const uint16_t pid);
+int32_t process_wait(process_t* self, const int32_t pid, int32_t* status, const uint32_t options);
+void process_reap_task(task_t* task);
+task_t* process_get_task_at(uint32_t index);
 
 /* INTERNAL API */
 process_t* curr_process = 0x0;
 process_t* processes = 0x0;
-static uint16_t next_pid = 1;
+static process_t* _table[PROCESS_MAX] = {};   // Indexed by PID, slot 0 is never handed out
+static uint16_t _free_pids[PROCESS_MAX] = {}; // FIFO of unused PIDs, the longest free PID is reused first
+static uint32_t _free_head = 0;
+static uint32_t _free_tail = 0;
+static bool _free_pids_ready = false;
+static process_t* _reap_procs = 0x0; // Zombies whose address space is still mapped
+static task_t* _reap_tasks = 0x0;    // Exited tasks whose kernel stack is still in use or not yet freed
 static process_t* _process_alloc(const char* filepath, const process_filetype_t filetype);
+static void _process_free(process_t* self);
 static void _process_list_insert(process_t* new_process);
+static void _process_list_remove(process_t* self);
 static uint32_t _process_get_filesize(const char* filename);
+static int32_t _process_copy_arguments(process_t* self, char* const argv[], char* const envp[]);
+static void _process_push_arguments(const process_t* self, task_t* task);
+static uint16_t _pid_alloc(void);
+static void _pid_free(const uint16_t pid);
+static void _release_address_space(process_t* self);
+static void _reap(uint32_t arg);
 
 void process_set_curr(process_t* self)
 {
@@ -62,7 +89,8 @@ void process_list_dump(void)
 	};
 
 	do {
-		kprintf("PID: %d \n", process->pid);
+		kprintf("PID: %d | PPID: %d | State: %s\n", process->pid, process->ppid,
+			process->state == PROCESS_STATE_ZOMBIE ? "ZOMBIE" : "ALIVE");
 		kprintf("  Addr: 0x%x \n", process);
 		kprintf("  Name: %s\n", process->filename);
 		kprintf("  Tasks: %d | File Type: %s\n", process->task_count, process->filetype == PROCESS_ELF ? "ELF" : "BINARY");
@@ -100,6 +128,38 @@ void process_list_dump(void)
 	return;
 };
 
+/**
+ * @brief O(1) lookup of a process by its PID, zombies included.
+ */
+process_t* process_get(const uint16_t pid)
+{
+	if (pid == 0 || pid >= PROCESS_MAX) {
+		return 0x0;
+	};
+	return _table[pid];
+};
+
+static uint16_t _pid_alloc(void)
+{
+	if (!_free_pids_ready) {
+		for (uint16_t pid = 1; pid < PROCESS_MAX; pid++) {
+			_free_pids[_free_tail++ & PROCESS_PID_MASK] = pid;
+		};
+		_free_pids_ready = true;
+	};
+
+	if (_free_head == _free_tail) {
+		return 0;
+	};
+	return _free_pids[_free_head++ & PROCESS_PID_MASK];
+};
+
+static void _pid_free(const uint16_t pid)
+{
+	_free_pids[_free_tail++ & PROCESS_PID_MASK] = pid;
+	return;
+};
+
 static process_t* _process_alloc(const char* filepath, const process_filetype_t filetype)
 {
 	process_t* new_process = kzalloc(sizeof(process_t));
@@ -108,7 +168,24 @@ static process_t* _process_alloc(const char* filepath, const process_filetype_t
 		return 0x0;
 	};
 	memset(new_process, 0, sizeof(process_t));
-	new_process->pid = next_pid++;
+	const uint32_t eflags = asm_irq_save();
+	const uint16_t pid = _pid_alloc();
+
+	if (!pid) {
+		asm_irq_restore(eflags);
+		kfree(new_process);
+		return 0x0;
+	};
+	new_process->pid = pid;
+	_table[pid] = new_process;
+	asm_irq_restore(eflags);
+
+	// Spawned by a user process: it may waitpid() for us. Anything spawned by the kernel has no parent
+	const process_t* creator = curr_process;
+	new_process->ppid = (creator && creator->filetype != PROCESS_KERNEL_THREAD) ? creator->pid : 0;
+	new_process->strace = (creator && (creator->strace & STRACE_INHERIT)) ? STRACE_TRACE : 0;
+	new_process->strace_owner = creator ? creator->pid : 0;
+	new_process->state = PROCESS_STATE_ALIVE;
 	strncpy(new_process->filename, filepath, sizeof(new_process->filename) - 1);
 	new_process->filetype = filetype;
 	new_process->keyboard_buffer = kzalloc(sizeof(fifo_t));
@@ -116,23 +193,51 @@ static process_t* _process_alloc(const char* filepath, const process_filetype_t
 	return new_process;
 };
 
+/**
+ * @brief Gives the PID back and frees the process. Its address space must already be released.
+ */
+static void _process_free(process_t* self)
+{
+	const uint32_t eflags = asm_irq_save();
+	_table[self->pid] = 0x0;
+	_pid_free(self->pid);
+	asm_irq_restore(eflags);
+	kfree(self);
+	return;
+};
+
 static void _process_list_insert(process_t* new_process)
 {
 	if (!process_get_curr()) {
-		new_process->prev = new_process->next = 0x0;
 		process_set_curr(new_process);
-	} else {
-		new_process->next = processes;
-		new_process->prev = 0x0;
+	};
+	new_process->next = processes;
+	new_process->prev = 0x0;
 
-		if (processes) {
-			processes->prev = new_process;
-		};
+	if (processes) {
+		processes->prev = new_process;
 	};
 	processes = new_process;
 	return;
 };
 
+static void _process_list_remove(process_t* self)
+{
+	if (self->prev) {
+		self->prev->next = self->next;
+	};
+
+	if (self->next) {
+		self->next->prev = self->prev;
+	};
+
+	if (processes == self) {
+		processes = self->next;
+	};
+	self->prev = self->next = 0x0;
+	return;
+};
+
 static uint32_t _process_get_filesize(const char* filename)
 {
 	vstat_t stat_buf = {};
@@ -150,7 +255,121 @@ static uint32_t _process_get_filesize(const char* filename)
 	return stat_buf.st_size;
 };
 
-process_t* process_spawn(const char* filepath)
+/**
+ * @brief Copies argv and envp into a single kernel allocation owned by the process.
+ */
+static int32_t _process_copy_arguments(process_t* self, char* const argv[], char* const envp[])
+{
+	char* const default_argv[] = {self->filename, 0x0};
+	char* const empty[] = {0x0};
+	argv = argv ? argv : default_argv;
+	envp = envp ? envp : empty;
+	size_t argc = 0;
+	size_t envc = 0;
+	size_t bytes = 0;
+
+	for (; argv[argc]; argc++) {
+		bytes += strlen(argv[argc]) + 1;
+	};
+
+	for (; envp[envc]; envc++) {
+		bytes += strlen(envp[envc]) + 1;
+	};
+
+	if (argc > PROCESS_MAX_ARGS || envc > PROCESS_MAX_ARGS || bytes > PROCESS_MAX_ARG_BYTES) {
+		return -E2BIG;
+	};
+	char** vector = kzalloc((argc + 1 + envc + 1) * sizeof(char*) + bytes);
+
+	if (!vector) {
+		return -ENOMEM;
+	};
+	char* strings = (char*)(vector + argc + 1 + envc + 1);
+
+	for (size_t i = 0; i < argc; i++) {
+		const size_t len = strlen(argv[i]) + 1;
+		memcpy(strings, argv[i], len);
+		vector[i] = strings;
+		strings += len;
+	};
+	vector[argc] = 0x0;
+
+	for (size_t i = 0; i < envc; i++) {
+		const size_t len = strlen(envp[i]) + 1;
+		memcpy(strings, envp[i], len);
+		vector[argc + 1 + i] = strings;
+		strings += len;
+	};
+	vector[argc + 1 + envc] = 0x0;
+
+	self->arguments.argc = argc;
+	self->arguments.argv = vector;
+	self->arguments.envc = envc;
+	self->arguments.envp = vector + argc + 1;
+	return 0;
+};
+
+/**
+ * @brief Lays out argc, argv, envp and their strings on the user stack of task.
+ *
+ * Strings go to the top, the vectors right below them, esp ends up pointing at argc.
+ */
+static void _process_push_arguments(const process_t* self, task_t* task)
+{
+	const process_arguments_t* args = &self->arguments;
+	size_t bytes = 0;
+
+	for (int i = 0; i < args->argc; i++) {
+		bytes += strlen(args->argv[i]) + 1;
+	};
+
+	for (int i = 0; i < args->envc; i++) {
+		bytes += strlen(args->envp[i]) + 1;
+	};
+	const uint32_t strings = (task->registers.esp - bytes) & ~0xF;
+	const uint32_t words = 1 + args->argc + 1 + args->envc + 1;
+	const uint32_t sp = strings - (words * sizeof(uint32_t));
+
+	uint32_t* prev_dir = page_get_dir();
+	task_restore_dir(task);
+	uint32_t* vector = (uint32_t*)sp;
+	char* dst = (char*)strings;
+	*vector++ = args->argc;
+
+	for (int i = 0; i < args->argc; i++) {
+		const size_t len = strlen(args->argv[i]) + 1;
+		memcpy(dst, args->argv[i], len);
+		*vector++ = (uint32_t)dst;
+		dst += len;
+	};
+	*vector++ = 0x0;
+
+	for (int i = 0; i < args->envc; i++) {
+		const size_t len = strlen(args->envp[i]) + 1;
+		memcpy(dst, args->envp[i], len);
+		*vector++ = (uint32_t)dst;
+		dst += len;
+	};
+	*vector++ = 0x0;
+	page_set_dir(prev_dir);
+
+	task->registers.esp = task->registers.ebp = sp;
+	return;
+};
+
+/**
+ * @brief Spawns the executable at filepath with argv = { filepath } and an empty environment.
+ */
+process_t* process_spawn(const char* filepath) { return process_spawnv(filepath, 0x0, 0x0); };
+
+/**
+ * @brief Builds a new process straight from the executable, there is no address space to copy.
+ *
+ * argv and envp are kernel pointers (0x0 terminated, 0x0 for none), they are copied.
+ * A missing argv defaults to { filepath }. The new task starts with the System V i386
+ * process stack: argc, argv[], 0x0, envp[], 0x0, followed by the strings.
+ */
+process_t* process_spawnv(const char* filepath, char* const argv[], char* const envp[])
 {
 	process_t* proc = _process_alloc(filepath, PROCESS_BINARY);
 
@@ -160,22 +379,52 @@ process_t* process_spawn(const char* filepath)
 	};
 
 	if (proc->task_count >= PROCESS_MAX_THREAD) {
-		kfree(proc);
+		_process_free(proc);
 		errno = -E2BIG;
 		return 0x0;
 	};
 	const uint32_t flags = (PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE | PAGE_USER);
 	proc->page_dir = page_create_dir(flags);
-	page_map_between(proc->page_dir, USER_CODE_START, USER_BSS_END, flags);
+
+	if (!proc->page_dir) {
+		errno = -ENOMEM;
+		_process_free(proc);
+		return 0x0;
+	};
+	clock_map(proc->page_dir);
+
+	const int32_t res = elf_load(proc, proc->filename);
+
+	if (res == -ENOEXEC) {
+		// Flat binary, task_create() copies it to USER_CODE_START
+		page_map_between(proc->page_dir, USER_CODE_START, USER_BSS_END, flags);
+	} else if (res < 0) {
+		kprintf("[ERROR] Failed to load ELF '%s' (%d)\n", proc->filename, res);
+		_release_address_space(proc);
+		_process_free(proc);
+		errno = res;
+		return 0x0;
+	};
 	page_map_between(proc->page_dir, USER_HEAP_START, USER_HEAP_END, flags);
 
+	const int32_t arg_res = _process_copy_arguments(proc, argv, envp);
+
+	if (arg_res < 0) {
+		_release_address_space(proc);
+		_process_free(proc);
+		errno = arg_res;
+		return 0x0;
+	};
 	task_t* task = task_create(proc, (uint8_t*)proc->filename);
 
 	if (!task) {
 		errno = -ENOMEM;
-		kfree(proc);
+		_release_address_space(proc);
+		kfree(proc->arguments.argv);
+		_process_free(proc);
 		return 0x0;
 	};
+	_process_push_arguments(proc, task);
 	proc->size = _process_get_filesize(proc->filename);
 
 	proc->tasks[proc->task_count] = task;
@@ -196,7 +445,7 @@ process_t* process_kspawn(void (*entry)(), const char* name)
 	proc->page_dir = kernel_directory;
 
 	if (proc->task_count >= PROCESS_MAX_THREAD) {
-		kfree(proc);
+		_process_free(proc);
 		errno = -E2BIG;
 		return 0x0;
 	};
@@ -204,7 +453,7 @@ process_t* process_kspawn(void (*entry)(), const char* name)
 
 	if (!task) {
 		errno = -ENOMEM;
-		kfree(proc);
+		_process_free(proc);
 		return 0x0;
 	};
 	proc->tasks[proc->task_count++] = task;
@@ -212,41 +461,236 @@ process_t* process_kspawn(void (*entry)(), const char* name)
 	return proc;
 };
 
-void process_exit(process_t* self)
+/**
+ * @brief Turns the process into a zombie after its last task called exit.
+ *
+ * Runs on the kernel stack of the exiting task, so nothing it still stands on is freed here.
+ * The address space is handed to the reaper on the kworker thread, the tasks
+ * already went there through task_exit(). The process_t itself (PID + exit status) stays until the parent waited for it,
+ * or goes with the reaper right away if nobody will ever wait.
+ */
+void process_exit(process_t* self, const int32_t status)
 {
-	uint32_t* dir = self->page_dir;
+	const uint32_t eflags = asm_irq_save();
+	_process_list_remove(self);
 
-	if (self->prev) {
-		self->prev->next = self->next;
-	}
-	if (self->next) {
-		self->next->prev = self->prev;
-	}
+	if (process_get_curr() == self) {
+		curr_process = 0x0;
+	};
+	self->state = PROCESS_STATE_ZOMBIE;
+	self->exit_status = status;
+	ipc_release(self);
 
-	if (processes == self) {
-		processes = self->next;
+	if (tty_get_foreground() == self) {
+		tty_set_foreground(process_get(self->ppid));
 	};
 
-	if (process_get_curr() == self) {
-		curr_process = 0x0;
+	// Orphans are adopted by the kernel, i.e. nobody waits for them anymore
+	for (uint32_t pid = 1; pid < PROCESS_MAX; pid++) {
+		process_t* child = _table[pid];
+
+		if (!child || child->ppid != self->pid) {
+			continue;
+		};
+		child->ppid = 0;
+
+		// Exited and already reaped, it was only kept around for us
+		if (child->state == PROCESS_STATE_ZOMBIE && !child->page_dir) {
+			_process_free(child);
+		};
+	};
+	const bool idle = !_reap_procs && !_reap_tasks;
+	self->reap_next = _reap_procs;
+	_reap_procs = self;
+
+	// One pending work item drains both lists
+	if (idle) {
+		kwork_queue(_reap, 0);
+	};
+	wq_wakeup(WAIT_CHILD);
+	asm_irq_restore(eflags);
+	return;
+};
+
+/**
+ * @brief Hands a task that left its process to the reaper, its kernel stack may still be in use.
+ */
+void process_reap_task(task_t* task)
+{
+	const uint32_t eflags = asm_irq_save();
+	const bool idle = !_reap_procs && !_reap_tasks;
+	task->state = TASK_STATE_TERMINATE;
+	task->reap_next = _reap_tasks;
+	_reap_tasks = task;
+
+	if (idle) {
+		kwork_queue(_reap, 0);
+	};
+	asm_irq_restore(eflags);
+	return;
+};
+
+static void _release_address_space(process_t* self)
+{
+	uint32_t* dir = self->page_dir;
+
+	if (!dir || self->filetype == PROCESS_KERNEL_THREAD) {
+		return;
 	};
+	// Faulted in mmap frames are present PDEs and released below like every other page
+	mmap_release(self);
 
 	for (uint32_t i = 0; i < 768; i++) {
 		if (dir[i] & PAGE_PRESENT) {
 			const uint32_t virt_addr = i * PAGE_SIZE;
 			const uint32_t phys_addr = page_get_phys_addr(dir, virt_addr);
 			page_unmap_dir(dir, virt_addr);
+			// Shared text frames stay with the image cache and the other processes
 			const uint32_t frame = phys_addr / PAGE_SIZE;
-			pfa_clear(&pfa, frame);
+			pfa_put(&pfa, frame);
 		};
 	};
-	const uint32_t phys_addr = (uint32_t)v2p((void*)self->page_dir);
-	const uint32_t frame = phys_addr / PAGE_SIZE;
-	page_unmap_dir(page_get_dir(), (uint32_t)self->page_dir);
-	pfa_clear(&pfa, frame);
+	page_destroy_dir(dir);
+	return;
+};
 
-	kfree(self->keyboard_buffer);
-	kfree(self);
+/**
+ * @brief Bottom half of exit, runs on the kworker thread.
+ *
+ * By the time kworker runs, every exited task has been switched away from for good,
+ * so their kernel stacks are free to go.
+ */
+static void _reap(uint32_t arg)
+{
+	(void)arg;
+	uint32_t eflags = asm_irq_save();
+	task_t* tasks = _reap_tasks;
+	process_t* procs = _reap_procs;
+	_reap_tasks = 0x0;
+	_reap_procs = 0x0;
+	asm_irq_restore(eflags);
+
+	while (tasks) {
+		task_t* next = tasks->reap_next;
+		kfree((void*)tasks->kstack_bottom);
+		kfree(tasks);
+		tasks = next;
+	};
+
+	while (procs) {
+		process_t* next = procs->reap_next;
+		// Descriptors it never closed, pipe readers see EOF and shm objects lose the reference
+		vfs_close_all(procs->pid);
+		_release_address_space(procs);
+		kfree(procs->keyboard_buffer);
+
+		if (procs->filetype == PROCESS_ELF) {
+			kfree(procs->elf_file);
+			procs->elf_file = 0x0;
+		};
+
+		if (procs->arguments.argv) {
+			kfree(procs->arguments.argv);
+			procs->arguments = (process_arguments_t){};
+		};
+
+		eflags = asm_irq_save();
+		procs->page_dir = 0x0;
+		procs->keyboard_buffer = 0x0;
+		const bool orphan = !procs->ppid;
+		asm_irq_restore(eflags);
+
+		// A waiting parent frees it in process_wait() once the address space is gone
+		if (orphan) {
+			_process_free(procs);
+		};
+		procs = next;
+	};
 	pfa_dump(&pfa, false);
 	return;
+};
+
+/**
+ * @brief Collects an exited child of `self`.
+ *
+ * @param pid    Child PID, or -1 for any child
+ * @param status Receives the exit status of the collected child
+ * @return PID of the collected child, 0 with PROCESS_WNOHANG if no child exited yet,
+ *         -ECHILD if there is no such child, -EAGAIN if the caller has to sleep on WAIT_CHILD and retry
+ */
+int32_t process_wait(process_t* self, const int32_t pid, int32_t* status, const uint32_t options)
+{
+	if (!self) {
+		return -ESRCH;
+	};
+	process_t* found = 0x0;
+	bool has_child = false;
+	const uint32_t eflags = asm_irq_save();
+
+	if (pid > 0 && pid < PROCESS_MAX) {
+		process_t* child = _table[pid];
+
+		if (child && child->ppid == self->pid) {
+			has_child = true;
+			found = (child->state == PROCESS_STATE_ZOMBIE) ? child : 0x0;
+		};
+	} else if (pid == -1) {
+		for (uint32_t i = 1; i < PROCESS_MAX && !found; i++) {
+			process_t* child = _table[i];
+
+			if (child && child->ppid == self->pid) {
+				has_child = true;
+				found = (child->state == PROCESS_STATE_ZOMBIE) ? child : 0x0;
+			};
+		};
+	};
+
+	if (!has_child) {
+		asm_irq_restore(eflags);
+		return -ECHILD;
+	};
+
+	if (!found) {
+		asm_irq_restore(eflags);
+		return (options & PROCESS_WNOHANG) ? 0 : -EAGAIN;
+	};
+	const int32_t child_pid = found->pid;
+
+	if (status) {
+		*status = found->exit_status;
+	};
+	// Detach, from now on the child belongs to the reaper if it is not done with it yet
+	found->ppid = 0;
+	const bool released = !found->page_dir;
+	asm_irq_restore(eflags);
+
+	if (released) {
+		_process_free(found);
+	};
+	return child_pid;
+};
+
+/**
+ * @brief Returns the index-th task over all processes, in process list order.
+ *
+ * Used to enumerate tasks from userspace (SYS_TASKSTAT). The order is only
+ * stable as long as no process is spawned or exits in between.
+ */
+task_t* process_get_task_at(uint32_t index)
+{
+	for (process_t* process = processes; process; process = process->next) {
+		for (size_t i = 0; i < PROCESS_MAX_THREAD; i++) {
+			task_t* task = process->tasks[i];
+
+			if (!task) {
+				continue;
+			};
+
+			if (index == 0) {
+				return task;
+			};
+			index--;
+		};
+	};
+	return 0x0;
 };
\ No newline at end of file
@@ -1,5 +1,10 @@
 BITS 32
+extern scheduler_schedule
+extern task_handoff
+
 global asm_enter_task
+global asm_task_yield
+global asm_task_yield_to
 global asm_restore_kernel_segment
 global asm_restore_user_segment
 
@@ -10,6 +15,9 @@ asm_enter_task:
     mov ebp, esp
     mov ebx, [ebp + 4]    ; Load pointer to frame into EBX (frame = &task->registers)
 
+    test dword [ebx + 32], 0x3
+    jz .enter_kernel      ; Ring 0 target: IRETD pops no SS/ESP, we have to switch stacks ourselves
+
     ; Push stack setup (for IRETD)
     push dword [ebx + 44] ; Push SS (Stack Segment)
     push dword [ebx + 40] ; Push ESP (Stack Pointer)
@@ -35,6 +43,75 @@ asm_enter_task:
 
     iretd                 ; Perform an interrupt return to switch to next task
 
+.enter_kernel:
+    mov esp, [ebx + 40]   ; Continue on the kernel task's own stack (saved ESP)
+
+    push dword [ebx + 36] ; Push EFLAGS unmodified, a task that yielded with IF = 0 (inside a syscall) resumes with IF = 0
+
+    push dword [ebx + 32] ; Push CS (Code Segment)
+    push dword [ebx + 28] ; Push entry point (EIP)
+
+    mov ax, [ebx + 44]    ; Load SS (Kernel Data Segment)
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    push ebx              ; Push pointer to frame onto the new stack
+    call asm_task_restore_register
+    add esp, 4            ; Clean up the stack after function call
+
+    iretd                 ; Same privilege level: pops EIP, CS, EFLAGS only
+
+; ------------------------------------------------
+; void asm_task_yield(void)
+; gives up the cpu from kernel context (e.g. a syscall waiting for input).
+; builds a Ring 0 interrupt frame on the current kernel stack and hands it to
+; the scheduler exactly like IRQ0 would. The task continues at .resume once it
+; gets picked again, asm_enter_task switches back to this stack.
+asm_task_yield:
+    pushfd                ; EFLAGS (keep IF as the caller had it)
+    push dword 0x08       ; CS (GDT_KERNEL_CODE_SEGMENT)
+    push dword .resume    ; EIP
+    pushad
+    push esp              ; interrupt_frame_t* frame
+    call scheduler_schedule
+
+    ; Only reached if there was nothing to switch to
+    add esp, 4
+    popad
+    add esp, 8            ; Drop EIP and CS
+    popfd
+    ret
+
+.resume:
+    ret                   ; ESP points at our caller's return address again
+
+; ------------------------------------------------
+; void asm_task_yield_to(task_t* next)
+; same frame as asm_task_yield, but hands it to task_handoff, which switches
+; straight to next instead of picking from the ready queue (IPC fast path).
+asm_task_yield_to:
+    mov eax, [esp + 4]    ; task_t* next
+    pushfd
+    push dword 0x08
+    push dword .resume
+    pushad
+    mov ecx, esp          ; interrupt_frame_t* frame
+    push eax              ; next
+    push ecx              ; frame
+    call task_handoff
+
+    ; Only reached if there was nothing to switch to
+    add esp, 8
+    popad
+    add esp, 8
+    popfd
+    ret
+
+.resume:
+    ret
+
 ; ------------------------------------------------
 ; void asm_task_restore_register(task_registers_t* frame)
 ; restores all general-purpose registers from a saved task context.
@@ -7,10 +7,15 @@
 #include "task.h"
 #include "errno.h"
 #include "icarius.h"
+#include "ipc.h"
 #include "page.h"
+#include "scheduler.h"
 #include "string.h"
+#include "tsc.h"
+#include "tss.h"
 
 extern pfa_t pfa;
+extern tss_t tss;
 
 /* PUBLIC API */
 void task_block_on(task_t* self, const wait_reason_t reason);
@@ -23,11 +28,16 @@ task_t* task_get_curr(void);
 void task_set_block(task_t* self);
 void task_set_unblock(task_t* self);
 void task_switch(task_t* next);
+void task_handoff(interrupt_frame_t* frame, task_t* next);
+void task_stat_tick(task_t* self);
+void task_stat_ready(task_t* self);
 
 /* INTERNAL API */
 static task_t* _init_task(process_t* parent);
 void task_restore_dir(task_t* self);
 static void _load_binary_into_task(const uint8_t* file);
+static void _stat_switch_out(task_t* prev, const task_t* next, const uint64_t now);
+static void _stat_switch_in(task_t* next, const uint64_t now);
 static task_t* curr_task = 0x0;
 
 void task_block_on(task_t* self, const wait_reason_t reason)
@@ -52,6 +62,8 @@ void task_set_unblock(task_t* self)
 	if (self && self->state == TASK_STATE_BLOCK) {
 		self->waiting_on = WAIT_NONE;
 		self->state = TASK_STATE_READY;
+		self->stat.woken_at = tsc_read();
+		self->stat.wakeups++;
 	};
 	return;
 };
@@ -71,6 +83,9 @@ void task_exit(task_t* self)
 			break;
 		};
 	};
+	ipc_task_exit(self);
+	// We are still running on its kernel stack, the reaper frees it later
+	process_reap_task(self);
 	return;
 };
 
@@ -98,6 +113,9 @@ void task_switch(task_t* next)
 	if (!next) {
 		return;
 	};
+	const uint64_t now = tsc_read();
+	_stat_switch_out(curr_task, next, now);
+	_stat_switch_in(next, now);
 	next->state = TASK_STATE_RUN;
 
 	task_set_curr(next);
@@ -106,6 +124,10 @@ void task_switch(task_t* next)
 	if (next->parent->page_dir) {
 		task_restore_dir(next);
 	};
+	// Every user task enters the kernel on its own stack, a task sleeping inside a syscall keeps its frame
+	if (next->parent->filetype != PROCESS_KERNEL_THREAD) {
+		tss_set_esp0(&tss, next->kstack_top);
+	};
 	/*
 	const char* str = (next->parent->filetype == PROCESS_KERNEL_THREAD) ? "[KTHREAD]" : "[UTHREAD]";
 
@@ -120,6 +142,101 @@ void task_switch(task_t* next)
 	return;
 };
 
+/**
+ * @brief Switches to next without asking the scheduler (IPC), called by asm_task_yield_to.
+ *
+ * next must be ready but in no queue. The current task is saved from the yield frame, if it is
+ * still running it goes into the ready queue like a preempted one, a blocked one waits for its wakeup.
+ */
+void task_handoff(interrupt_frame_t* frame, task_t* next)
+{
+	task_t* curr = task_get_curr();
+
+	if (!curr || !next || next == curr) {
+		return;
+	};
+	task_save(frame);
+
+	if (curr->state == TASK_STATE_RUN) {
+		curr->state = TASK_STATE_READY;
+		scheduler_get()->add_cb(curr);
+	};
+	task_switch(next);
+	return;
+};
+
+void task_stat_tick(task_t* self)
+{
+	if (!self || !self->stat.switched_in) {
+		return;
+	};
+	const uint64_t now = tsc_read();
+	self->stat.run_cycles += now - self->stat.switched_in;
+	self->stat.switched_in = now;
+	return;
+};
+
+void task_stat_ready(task_t* self)
+{
+	if (!self) {
+		return;
+	};
+	self->stat.ready_since = tsc_read();
+	return;
+};
+
+/**
+ * @brief Charges the outgoing task for its time on the cpu.
+ *
+ * The scheduler has already decided the fate of `prev` when we get here:
+ * a task that is READY again was preempted and re-queued, anything else
+ * (BLOCK, TERMINATE) gave up the cpu on its own.
+ */
+static void _stat_switch_out(task_t* prev, const task_t* next, const uint64_t now)
+{
+	if (!prev || !prev->stat.switched_in) {
+		return;
+	};
+	prev->stat.run_cycles += now - prev->stat.switched_in;
+	prev->stat.switched_in = 0;
+
+	if (prev == next) {
+		return;
+	};
+
+	if (prev->state == TASK_STATE_READY) {
+		prev->stat.nivcsw++;
+	} else {
+		prev->stat.nvcsw++;
+	};
+	return;
+};
+
+static void _stat_switch_in(task_t* next, const uint64_t now)
+{
+	if (next->stat.ready_since) {
+		next->stat.wait_cycles += now - next->stat.ready_since;
+		next->stat.ready_since = 0;
+	};
+
+	if (next->stat.woken_at) {
+		uint64_t latency = now - next->stat.woken_at;
+		uint32_t bucket = 0;
+
+		if (latency > next->stat.latency_max) {
+			next->stat.latency_max = latency;
+		};
+
+		while ((latency >>= 1) && bucket < TASK_STAT_LATENCY_BUCKETS - 1) {
+			bucket++;
+		};
+		next->stat.latency_hist[bucket]++;
+		next->stat.woken_at = 0;
+	};
+	next->stat.switched_in = now;
+	return;
+};
+
 static task_t* _init_task(process_t* parent)
 {
 	task_t* task = kzalloc(sizeof(task_t));
@@ -136,30 +253,23 @@ static task_t* _init_task(process_t* parent)
 static void _load_binary_into_task(const uint8_t* file)
 {
 	const int32_t fd = vfs_fopen((char*)file, "r");
-	vstat_t stat_buf = {};
-	vfs_fstat(fd, &stat_buf);
 
-	uint8_t* buf = kzalloc(stat_buf.st_size);
-	const int32_t bytes_read = vfs_fread(buf, stat_buf.st_size, 1, fd);
-	/*
-	kprintf("[DEBUG] Read %d Bytes from %s\n", bytes_read, file);
-
-	for (size_t i = 0; i < stat_buf.st_size; i++) {
-		const uint8_t byte = buf[i];
-		const uint8_t high = (byte >> 4) & 0x0F;
-		const uint8_t low = byte & 0x0F;
-		kprintf("0x%x%x ", high, low);
+	if (fd < 0) {
+		kprintf("[ERROR] Failed to open '%s'\n", file);
+		return;
 	};
-	kprintf("\n");
-	*/
-	memcpy((void*)USER_CODE_START, (void*)buf, bytes_read);
+	vstat_t stat_buf = {};
+	vfs_fstat(fd, &stat_buf);
 
-	if (memcmp((void*)USER_CODE_START, (void*)buf, bytes_read) == 0) {
-		kprintf("[SUCCESS] Usercode copied to Userspace at 0x%x\n", USER_CODE_START);
-	} else {
-		kprintf("[ERROR] Usercode copy failed.\n");
+	if (stat_buf.st_size > USER_CODE_SIZE + USER_BSS_SIZE) {
+		kprintf("[ERROR] Flat binary '%s' does not fit into 0x%x - 0x%x\n", file, USER_CODE_START, USER_BSS_END);
+		vfs_fclose(fd);
+		return;
 	};
-	kfree(buf);
+	// Straight into the (already active) user mapping, no bounce buffer
+	const size_t bytes_read = vfs_fread((void*)USER_CODE_START, stat_buf.st_size, 1, fd);
+	vfs_fclose(fd);
+	kprintf("[INFO] Loaded flat binary '%s' (%d Bytes) at 0x%x\n", file, bytes_read, USER_CODE_START);
 	return;
 };
 
@@ -183,6 +293,8 @@ task_t* task_kcreate(process_t* parent, void (*entry)())
 	};
 	task->stack_top = (uintptr_t)stack + KERNEL_STACK_SIZE;
 	task->stack_bottom = (uintptr_t)stack;
+	task->kstack_top = task->stack_top;
+	task->kstack_bottom = task->stack_bottom;
 
 	task->registers.eip = (uintptr_t)entry;
 	task->registers.eflags = (EFLAGS_IF | EFLAGS_MBS);
@@ -215,14 +327,29 @@ task_t* task_create(process_t* parent, const uint8_t* file)
 	const uint32_t stack_bottom = stack_top - (USER_STACK_SIZE / PROCESS_MAX_THREAD) + 1;
 	task->stack_top = stack_top;
 	task->stack_bottom = stack_bottom;
+
+	void* kstack = kzalloc(KERNEL_STACK_SIZE); // 32 KiB
+
+	if (!kstack) {
+		kfree(task);
+		errno = ENOMEM;
+		return 0x0;
+	};
+	task->kstack_top = (uintptr_t)kstack + KERNEL_STACK_SIZE;
+	task->kstack_bottom = (uintptr_t)kstack;
 	const uint32_t flags = (PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE | PAGE_USER);
 	page_map_between(parent->page_dir, stack_bottom, stack_top, flags);
 
-	task_restore_dir(task);
-	_load_binary_into_task(file);
-	page_restore_kernel_dir();
-
-	task->registers.eip = USER_CODE_START;
+	// ELF images are already mapped by elf_load(), only flat binaries are copied here
+	if (parent->filetype == PROCESS_ELF) {
+		task->registers.eip = parent->elf_file->entry;
+	} else {
+		uint32_t* prev_dir = page_get_dir();
+		task_restore_dir(task);
+		_load_binary_into_task(file);
+		page_set_dir(prev_dir);
+		task->registers.eip = USER_CODE_START;
+	};
 	task->registers.eflags = (EFLAGS_IF | EFLAGS_MBS);
 	task->registers.esp = task->registers.ebp = (task->stack_top & ~STACK_ALIGN_MASK_4);
 
@@ -259,6 +386,13 @@ void task_dump(task_t* self)
 	kprintf("ESI  : 0x%x\n", self->registers.esi);
 	kprintf("EDI  : 0x%x\n", self->registers.edi);
 
+	kprintf("------------------------------------\n");
+	// No 64-bit division and no zero padding in kprintf, kilocycles keep the numbers in 32 bits
+	kprintf("Accounting (TSC kcycles):\n");
+	kprintf("RUN  : %d\n", (uint32_t)(self->stat.run_cycles >> 10));
+	kprintf("WAIT : %d\n", (uint32_t)(self->stat.wait_cycles >> 10));
+	kprintf("CSW  : %d voluntary | %d involuntary | %d wakeups\n", self->stat.nvcsw, self->stat.nivcsw, self->stat.wakeups);
+
 	kprintf("====================================\n");
 	return;
 };
@@ -282,8 +416,15 @@ void task_save(interrupt_frame_t* frame)
 	task->registers.eip = frame->eip;
 	task->registers.cs = frame->cs;
 	task->registers.eflags = frame->eflags;
-	task->registers.esp = frame->esp;
-	task->registers.ss = frame->ss;
+
+	if ((frame->cs & 0x3) == 0) {
+		// Ring 0 → Ring 0: the cpu pushed no ESP/SS, the task's stack continues right above EFLAGS
+		task->registers.esp = (uintptr_t)&frame->esp;
+		task->registers.ss = GDT_KERNEL_DATA_SEGMENT;
+	} else {
+		task->registers.esp = frame->esp;
+		task->registers.ss = frame->ss;
+	};
 	return;
 };
 
@@ -42,6 +42,7 @@ tss_t tss = {
 /* PUBLIC API */
 void tss_init(tss_t* self, uint32_t esp0, uint16_t ss0);
 void tss_load(uint16_t tss_selector);
+void tss_set_esp0(tss_t* self, uint32_t esp0);
 
 void tss_init(tss_t* self, uint32_t esp0, uint16_t ss0)
 {
@@ -59,4 +60,10 @@ void tss_load(uint16_t tss_selector)
 {
 	asm volatile("ltr %%ax" : : "a"(tss_selector));
 	return;
+};
+
+void tss_set_esp0(tss_t* self, uint32_t esp0)
+{
+	self->esp0 = esp0 & ~STACK_ALIGN_MASK_4;
+	return;
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+/**
+ * @file ring.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Batched syscalls through a submission/completion ring
+ *
+ * A process gets one ring, mapped at USER_RING_START. It queues syscalls in the
+ * submission ring and hands them over with a single ring_enter, the results show up
+ * in the completion ring. Entries run in order inside ring_enter on the caller's
+ * directory, so the user pointers in them work exactly like in a direct syscall.
+ */
+
+#include "ring.h"
+#include "errno.h"
+#include "page.h"
+#include "pfa.h"
+#include "process.h"
+#include "syscall.h"
+
+/* PUBLIC API */
+ring_t* ring_setup(struct process* self);
+int32_t ring_enter(struct process* self, const uint32_t to_submit);
+
+/* INTERNAL API */
+static int32_t _ring_execute(const ring_sqe_t* sqe);
+
+static int32_t _ring_execute(const ring_sqe_t* sqe)
+{
+	switch (sqe->opcode) {
+	case SYS_READ:
+	case SYS_WRITE:
+	case SYS_OPEN:
+	case SYS_CLOSE:
+	case SYS_GETDENTS:
+	case SYS_GETPID:
+	case SYS_READV:
+	case SYS_WRITEV:
+	case SYS_PREAD:
+	case SYS_PWRITE:
+		break;
+	default:
+		// Nothing that exits, spawns or waits on other rings
+		return -EINVAL;
+	};
+	interrupt_frame_t frame = {
+	    .eax = sqe->opcode,
+	    .ebx = sqe->arg[0],
+	    .ecx = sqe->arg[1],
+	    .edx = sqe->arg[2],
+	    .edi = sqe->arg[3],
+	};
+	return syscall_invoke(sqe->opcode, &frame);
+};
+
+/**
+ * @brief Maps the ring into the caller, must run on the caller's directory (syscall context).
+ * @return The ring at USER_RING_START (the same one on every call), 0x0 if out of frames
+ */
+ring_t* ring_setup(struct process* self)
+{
+	if (self->ring) {
+		return self->ring;
+	};
+	const uint32_t frame = pfa_alloc();
+
+	if (!frame) {
+		errno = -ENOMEM;
+		return 0x0;
+	};
+	// Released together with the rest of the user half
+	page_map_dir(self->page_dir, USER_RING_START, frame, PAGE_PS | PAGE_PRESENT | PAGE_WRITABLE | PAGE_USER);
+
+	ring_t* ring = (ring_t*)USER_RING_START;
+	memset(ring, 0, sizeof(ring_t));
+	ring->sq_entries = RING_SQ_ENTRIES;
+	ring->sq_mask = RING_SQ_ENTRIES - 1;
+	ring->cq_entries = RING_CQ_ENTRIES;
+	ring->cq_mask = RING_CQ_ENTRIES - 1;
+	self->ring = ring;
+	return ring;
+};
+
+/**
+ * @brief Runs up to to_submit queued entries, stops early if the completion ring is full.
+ *
+ * Every consumed entry has its completion posted when this returns, there is nothing left
+ * in flight to wait for. A failed RING_SQE_LINK entry cancels the rest of its chain (-ECANCELED).
+ * @return Number of consumed entries, or -EINVAL without a ring
+ */
+int32_t ring_enter(struct process* self, const uint32_t to_submit)
+{
+	ring_t* ring = self->ring;
+
+	if (!ring) {
+		return -EINVAL;
+	};
+	// The indices live in user memory, take a snapshot and trust nothing else
+	uint32_t head = ring->sq_head;
+	const uint32_t tail = ring->sq_tail;
+	const uint32_t pending = tail - head;
+	const uint32_t count = (pending < to_submit) ? pending : to_submit;
+	bool cancel = false;
+	uint32_t done = 0;
+
+	if (pending > RING_SQ_ENTRIES) {
+		return -EINVAL;
+	};
+
+	for (; done < count; done++, head++) {
+		if (ring->cq_tail - ring->cq_head >= RING_CQ_ENTRIES) {
+			ring->cq_overflow++;
+			break;
+		};
+		const ring_sqe_t sqe = ring->sqes[head & (RING_SQ_ENTRIES - 1)];
+		const int32_t res = cancel ? -ECANCELED : _ring_execute(&sqe);
+
+		ring_cqe_t* cqe = &ring->cqes[ring->cq_tail & (RING_CQ_ENTRIES - 1)];
+		cqe->user_data = sqe.user_data;
+		cqe->res = res;
+		ring->cq_tail++;
+
+		cancel = (sqe.flags & RING_SQE_LINK) && (cancel || res < 0);
+		ring->sq_head = head + 1;
+	};
+	return done;
+};
\ No newline at end of file
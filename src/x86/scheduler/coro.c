@@ -0,0 +1,221 @@
+/**
+ * @file coro.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#include "coro.h"
+#include "errno.h"
+#include "idt.h"
+#include "kernel.h"
+#include "scheduler.h"
+#include "wq.h"
+
+/* PUBLIC API */
+void coro_init(coro_t* self, coro_fn fn, void* ctx);
+int32_t coro_spawn(coro_t* self);
+void coro_wake(coro_t* self);
+int32_t coro_await(coro_t* self);
+uint32_t coro_run(void);
+void coro_set_executor(task_t* executor);
+void kcoro(void);
+
+/* INTERNAL API */
+static void _coro_enqueue(coro_t* self);
+static void _wake_executor(void);
+static void _on_done(coro_t* self);
+static coro_t* _head = 0x0; // Run queue, next pass starts here
+static coro_t* _tail = 0x0; // Run queue, _coro_enqueue appends here
+static task_t* _executor = 0x0;
+
+void coro_init(coro_t* self, coro_fn fn, void* ctx)
+{
+	if (!self) {
+		errno = EINVAL;
+		return;
+	};
+	self->line = 0;
+	self->fn = fn;
+	self->ctx = ctx;
+	self->state = CORO_STATE_NEW;
+	self->result = 0;
+	self->on_done = 0x0;
+	self->woken = false;
+	self->next = 0x0;
+	return;
+};
+
+void coro_set_executor(task_t* executor)
+{
+	if (!executor) {
+		errno = EINVAL;
+		return;
+	};
+	_executor = executor;
+	return;
+};
+
+int32_t coro_spawn(coro_t* self)
+{
+	if (!self || !self->fn || self->state != CORO_STATE_NEW) {
+		return -EINVAL;
+	};
+	const uint32_t eflags = asm_irq_save();
+	_coro_enqueue(self);
+	_wake_executor();
+	asm_irq_restore(eflags);
+	return 0;
+};
+
+/**
+ * @brief Makes a parked coroutine runnable again.
+ *
+ * Safe from IRQ context, it only links the coroutine into the run queue.
+ * Waking a coroutine that is not parked is a no-op, so spurious wakeups are fine.
+ */
+void coro_wake(coro_t* self)
+{
+	if (!self) {
+		return;
+	};
+	const uint32_t eflags = asm_irq_save();
+
+	if (self->state == CORO_STATE_WAIT) {
+		_coro_enqueue(self);
+		_wake_executor();
+	} else if (self->state == CORO_STATE_RUN) {
+		// Woken while stepping, the executor re-queues it instead of parking it
+		self->woken = true;
+	};
+	asm_irq_restore(eflags);
+	return;
+};
+
+/**
+ * @brief Starts a coroutine and waits for its result.
+ *
+ * From a task (syscall context) the caller sleeps on WAIT_CORO while the executor thread
+ * drives the coroutine, other tasks keep the cpu in the meantime. Without a current task
+ * (boot, tests) the executor runs inline.
+ */
+int32_t coro_await(coro_t* self)
+{
+	const int32_t res = coro_spawn(self);
+
+	if (res < 0) {
+		return res;
+	};
+
+	if (!task_get_curr() || !_executor) {
+		while (self->state != CORO_STATE_DONE) {
+			coro_run();
+		};
+		return self->result;
+	};
+	const uint32_t eflags = asm_irq_save();
+
+	while (self->state != CORO_STATE_DONE) {
+		wq_sleep(WAIT_CORO);
+	};
+	asm_irq_restore(eflags);
+	return self->result;
+};
+
+/**
+ * @brief One executor pass: steps every coroutine that was runnable when the pass started.
+ * @return Number of coroutines that are still runnable (yielded) after the pass.
+ */
+uint32_t coro_run(void)
+{
+	uint32_t yielded = 0;
+
+	uint32_t eflags = asm_irq_save();
+	coro_t* batch = _head;
+	_head = _tail = 0x0;
+
+	for (coro_t* self = batch; self; self = self->next) {
+		self->state = CORO_STATE_RUN;
+	};
+	asm_irq_restore(eflags);
+
+	while (batch) {
+		coro_t* self = batch;
+		batch = batch->next;
+		self->next = 0x0;
+		self->woken = false;
+
+		const coro_step_t step = self->fn(self);
+
+		if (step == CORO_STEP_DONE) {
+			_on_done(self);
+			continue;
+		};
+		eflags = asm_irq_save();
+
+		if (step == CORO_STEP_YIELD || self->woken) {
+			_coro_enqueue(self);
+			yielded++;
+		} else {
+			self->state = CORO_STATE_WAIT;
+		};
+		asm_irq_restore(eflags);
+	};
+	return yielded;
+};
+
+/**
+ * @brief Executor thread.
+ *
+ * Sleeps while there is nothing to run. As long as coroutines only poll (yield)
+ * it gives up the cpu after every pass so polling never starves real tasks.
+ */
+void kcoro(void)
+{
+	for (;;) {
+		coro_run();
+		asm_do_cli();
+
+		if (!_head && _executor) {
+			task_set_block(_executor);
+			task_block_on(_executor, WAIT_CORO);
+		};
+		asm_task_yield();
+		asm_do_sti();
+	};
+	return;
+};
+
+static void _on_done(coro_t* self)
+{
+	if (self->on_done) {
+		self->on_done(self);
+	};
+	const uint32_t eflags = asm_irq_save();
+	self->state = CORO_STATE_DONE;
+	wq_wakeup(WAIT_CORO);
+	asm_irq_restore(eflags);
+	return;
+};
+
+static void _wake_executor(void)
+{
+	if (_executor && _executor->state == TASK_STATE_BLOCK) {
+		task_set_unblock(_executor);
+		scheduler_get()->add_cb(_executor);
+	};
+	return;
+};
+
+static void _coro_enqueue(coro_t* self)
+{
+	self->state = CORO_STATE_READY;
+	self->next = 0x0;
+
+	if (_tail) {
+		_tail->next = self;
+	} else {
+		_head = self;
+	};
+	_tail = self;
+	return;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+/**
+ * @file kwork.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ */
+
+#include "kwork.h"
+#include "errno.h"
+#include "idt.h"
+#include "kernel.h"
+#include "scheduler.h"
+
+/* PUBLIC API */
+void kwork_set_worker(task_t* worker);
+bool kwork_queue(kwork_fn fn, const uint32_t arg);
+void kwork_dump(void);
+void kworker(void);
+
+/* INTERNAL API */
+static bool _kwork_dequeue(kwork_t* work);
+static kwork_queue_t _queue = {};
+static task_t* _worker = 0x0;
+
+void kwork_set_worker(task_t* worker)
+{
+	if (!worker) {
+		errno = EINVAL;
+		return;
+	};
+	_worker = worker;
+	return;
+};
+
+/**
+ * @brief Queues a bottom half. Must be called with interrupts disabled (IRQ context).
+ *
+ * O(1): stores the item and, if the kworker sleeps, puts it straight back
+ * into the ready queue. No wait queue scan happens in interrupt context.
+ */
+bool kwork_queue(kwork_fn fn, const uint32_t arg)
+{
+	const uint32_t pending = _queue.head - _queue.tail;
+
+	if (!fn || pending >= KWORK_QUEUE_SIZE) {
+		_queue.dropped++;
+		return false;
+	};
+	kwork_t* slot = &_queue.items[_queue.head & KWORK_QUEUE_MASK];
+	slot->fn = fn;
+	slot->arg = arg;
+	// The item must be complete before the consumer can see the new head
+	asm volatile("" ::: "memory");
+	_queue.head++;
+
+	if (pending + 1 > _queue.high_water) {
+		_queue.high_water = pending + 1;
+	};
+
+	if (_worker && _worker->state == TASK_STATE_BLOCK) {
+		task_set_unblock(_worker);
+		scheduler_get()->add_cb(_worker);
+	};
+	return true;
+};
+
+void kwork_dump(void)
+{
+	kprintf("KWORK Queue: %d pending | High Water: %d | Dropped: %d\n", _queue.head - _queue.tail, _queue.high_water, _queue.dropped);
+	return;
+};
+
+static bool _kwork_dequeue(kwork_t* work)
+{
+	if (_queue.tail == _queue.head) {
+		return false;
+	};
+	*work = _queue.items[_queue.tail & KWORK_QUEUE_MASK];
+	// Copy the slot out before handing it back to the producer
+	asm volatile("" ::: "memory");
+	_queue.tail++;
+	return true;
+};
+
+/**
+ * @brief Kernel thread draining the work queue.
+ *
+ * Bottom halves run with interrupts enabled and can be preempted like any other task.
+ * When the queue is empty the worker blocks and yields, kwork_queue() brings it back.
+ */
+void kworker(void)
+{
+	kwork_t work = {};
+
+	for (;;) {
+		while (_kwork_dequeue(&work)) {
+			work.fn(work.arg);
+		};
+		asm_do_cli();
+
+		if (_queue.tail == _queue.head && _worker) {
+			task_set_block(_worker);
+			task_block_on(_worker, WAIT_KWORK);
+			asm_task_yield();
+		};
+		asm_do_sti();
+	};
+	return;
+};
\ No newline at end of file
@@ -56,8 +56,10 @@ void rr_yield(interrupt_frame_t* frame)
 	task_t* curr = task_get_curr();
 
 	if (!curr) {
-		task_set_curr(process_get_curr()->tasks[0]);
-	} else if (curr && frame) {
+		// First tick after boot: the interrupted context is kmain's halt loop, nothing worth saving
+		curr = process_get_curr()->tasks[0];
+		task_set_curr(curr);
+	} else if (frame) {
 		task_save(frame);
 	};
 
@@ -96,12 +98,18 @@ task_t* rr_get(void)
 
 static void _rr_enqueue(task_t* task)
 {
-	if (!task || _count >= RR_MAX) {
+	if (!task) {
 		return;
 	};
+
+	if (_count >= RR_MAX) {
+		// A dropped task would never run again
+		panic("[CRITICAL] Ready Queue full, PID %d lost\n", task->parent ? task->parent->pid : 0);
+	};
 	if (task->state != TASK_STATE_READY) {
 		return;
 	};
+	task_stat_ready(task);
 	_ready_queue[_head] = task;
 	_head = (_head + 1) % RR_MAX;
 	_count++;
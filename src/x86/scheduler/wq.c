@@ -14,6 +14,9 @@
 void wq_push(task_t* task);
 task_t* wq_pop(void);
 int32_t wq_size(void);
+void wq_sleep(const wait_reason_t reason);
+void wq_sleep_until(const wait_reason_t reason, const uint64_t deadline);
+void wq_tick(const uint64_t now);
 
 /* INTERNAL API */
 static void _wq_enqueue(task_t* task);
@@ -22,6 +25,7 @@ static task_t* _wait_queue[WAIT_MAX];
 static int32_t _head = 0; // Insert a task from
 static int32_t _tail = 0; // Remove a task from
 static int32_t _count = 0;
+static int32_t _timed = 0; // Sleepers with a deadline, wq_tick has nothing to do while 0
 
 int32_t wq_size(void) { return _count; };
 
@@ -42,6 +46,78 @@ void wq_wakeup(const wait_reason_t reason)
 	return;
 };
 
+/**
+ * @brief Puts the current task to sleep until wq_wakeup(reason).
+ *
+ * Kernel context only, with interrupts disabled (syscalls run behind an interrupt gate).
+ * Returns once the task has been woken up and picked by the scheduler again.
+ */
+void wq_sleep(const wait_reason_t reason)
+{
+	task_t* task = task_get_curr();
+
+	if (!task) {
+		return;
+	};
+	// We come back on whatever directory the scheduler left behind, the caller expects its own
+	uint32_t* dir = page_get_dir();
+	task_set_block(task);
+	task_block_on(task, reason);
+	wq_push(task);
+	asm_task_yield();
+	page_set_dir(dir);
+	return;
+};
+
+/**
+ * @brief wq_sleep with a deadline (absolute timer tick, 0 = none).
+ *
+ * Returns on wq_wakeup(reason) or once wq_tick saw the deadline pass, the caller checks which.
+ */
+void wq_sleep_until(const wait_reason_t reason, const uint64_t deadline)
+{
+	task_t* task = task_get_curr();
+
+	if (!task) {
+		return;
+	};
+
+	if (deadline) {
+		task->wake_tick = deadline;
+		_timed++;
+	};
+	wq_sleep(reason);
+
+	if (deadline) {
+		task->wake_tick = 0;
+		_timed--;
+	};
+	return;
+};
+
+/**
+ * @brief Called from IRQ0, wakes every sleeper whose deadline has passed.
+ */
+void wq_tick(const uint64_t now)
+{
+	if (!_timed) {
+		return;
+	};
+	size_t i = wq_size();
+
+	while (i--) {
+		task_t* task = _wq_dequeue();
+
+		if (task->wake_tick && now >= task->wake_tick) {
+			task_set_unblock(task);
+			scheduler_get()->add_cb(task);
+		} else {
+			_wq_enqueue(task);
+		};
+	};
+	return;
+};
+
 void wq_push(task_t* task)
 {
 	if (!task) {
@@ -60,9 +136,14 @@ task_t* wq_pop(void)
 
 static void _wq_enqueue(task_t* task)
 {
-	if (!task || _count >= WAIT_MAX) {
+	if (!task) {
 		return;
 	};
+
+	if (_count >= WAIT_MAX) {
+		// A dropped sleeper would never be woken up again
+		panic("[CRITICAL] Wait Queue full, PID %d lost\n", task->parent ? task->parent->pid : 0);
+	};
 	if (task->state != TASK_STATE_BLOCK) {
 		return;
 	};
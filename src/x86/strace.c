@@ -0,0 +1,164 @@
+/**
+ * @file strace.c
+ * @author Kevin Oehme
+ * @copyright MIT
+ * @brief Per-syscall counters and latency histograms, plus a trace ring for selected processes
+ *
+ * Every syscall (and every ring entry) passes strace_account on its way out. Processes with
+ * STRACE_TRACE set also leave a strace_record in a system-wide ring. SYS_STRACE_READ only drains
+ * the records of processes the caller traces, the others stay for their own tracer. The ring
+ * overwrites the oldest records when nobody drains them.
+ */
+
+#include "strace.h"
+#include "errno.h"
+#include "process.h"
+#include "task.h"
+#include "tsc.h"
+#include "uaccess.h"
+
+/* PUBLIC API */
+void strace_account(const int32_t syscall_id, const int32_t args[3], const int32_t res, const uint64_t start);
+int32_t strace_get_stat(const int32_t syscall_id, struct syscallstat* stat);
+int32_t strace_set(const int32_t pid, const uint32_t flags);
+int32_t strace_read(struct strace_record* user_buf, const uint32_t max);
+
+/* INTERNAL API */
+static struct syscallstat _stats[MAX_SYSCALL] = {};
+static strace_slot_t _ring[STRACE_ENTRIES] = {};
+static uint32_t _ring_head = 0;
+static uint32_t _ring_tail = 0;
+
+void strace_account(const int32_t syscall_id, const int32_t args[3], const int32_t res, const uint64_t start)
+{
+	const uint64_t cycles = tsc_read() - start;
+	struct syscallstat* stat = &_stats[syscall_id];
+	uint64_t rest = cycles;
+	uint32_t bucket = 0;
+
+	while ((rest >>= 1) && bucket < SYSCALL_STAT_BUCKETS - 1) {
+		bucket++;
+	};
+	const uint32_t eflags = asm_irq_save();
+	stat->count++;
+	stat->errors += (res < 0);
+	stat->cycles += cycles;
+	stat->hist[bucket]++;
+
+	if (cycles > stat->cycles_max) {
+		stat->cycles_max = cycles;
+	};
+	const task_t* task = task_get_curr();
+	const process_t* proc = task ? task->parent : 0x0;
+
+	if (proc && (proc->strace & STRACE_TRACE)) {
+		strace_slot_t* slot = &_ring[_ring_tail & (STRACE_ENTRIES - 1)];
+		struct strace_record* rec = &slot->rec;
+		slot->owner = proc->strace_owner;
+		slot->drained = false;
+		rec->seq = _ring_tail;
+		rec->pid = proc->pid;
+		rec->syscall = syscall_id;
+		rec->args[0] = args[0];
+		rec->args[1] = args[1];
+		rec->args[2] = args[2];
+		rec->res = res;
+		rec->cycles = (cycles >> 32) ? 0xFFFFFFFF : (uint32_t)cycles;
+		rec->tsc = start;
+		_ring_tail++;
+
+		if (_ring_tail - _ring_head > STRACE_ENTRIES) {
+			_ring_head = _ring_tail - STRACE_ENTRIES;
+		};
+	};
+	asm_irq_restore(eflags);
+	return;
+};
+
+/**
+ * @brief Snapshot of one syscall's counters, the caller fills in the name.
+ * @return 1, or 0 once syscall_id runs past MAX_SYSCALL
+ */
+int32_t strace_get_stat(const int32_t syscall_id, struct syscallstat* stat)
+{
+	if (syscall_id < 0 || syscall_id >= MAX_SYSCALL) {
+		return 0;
+	};
+	const uint32_t eflags = asm_irq_save();
+	*stat = _stats[syscall_id];
+	asm_irq_restore(eflags);
+	stat->id = syscall_id;
+	return 1;
+};
+
+/**
+ * @brief Sets the STRACE_* flags of a process (pid 0 = the caller).
+ *
+ * The records carry syscall arguments, so a process may only trace itself and the children
+ * it spawned. Kernel threads may trace anything. The records go to the caller's strace_read.
+ * @return The previous flags, -ESRCH or -EPERM
+ */
+int32_t strace_set(const int32_t pid, const uint32_t flags)
+{
+	const process_t* caller = task_get_curr()->parent;
+	process_t* proc = pid ? process_get(pid) : (process_t*)caller;
+
+	if (!proc || proc->state != PROCESS_STATE_ALIVE) {
+		return -ESRCH;
+	};
+
+	if (caller->filetype != PROCESS_KERNEL_THREAD && proc != caller && proc->ppid != caller->pid) {
+		return -EPERM;
+	};
+	const int32_t prev = proc->strace;
+	proc->strace = flags & (STRACE_TRACE | STRACE_INHERIT);
+	proc->strace_owner = caller->pid;
+	return prev;
+};
+
+/**
+ * @brief Moves up to max of the caller's oldest records to the user buffer.
+ *
+ * Only records of processes traced by the caller (strace_owner) are taken, the head moves
+ * past them once nothing older is left.
+ * @return Number of records, or -EFAULT
+ */
+int32_t strace_read(struct strace_record* user_buf, const uint32_t max)
+{
+	const uint16_t caller = task_get_curr()->parent->pid;
+	uint32_t pos = _ring_head;
+	uint32_t n = 0;
+
+	while (n < max) {
+		const uint32_t eflags = asm_irq_save();
+
+		// Records behind the head were overwritten while copy_to_user ran
+		if ((int32_t)(pos - _ring_head) < 0) {
+			pos = _ring_head;
+		};
+
+		while (pos != _ring_tail && (_ring[pos & (STRACE_ENTRIES - 1)].drained || _ring[pos & (STRACE_ENTRIES - 1)].owner != caller)) {
+			pos++;
+		};
+
+		if (pos == _ring_tail) {
+			asm_irq_restore(eflags);
+			break;
+		};
+		strace_slot_t* slot = &_ring[pos & (STRACE_ENTRIES - 1)];
+		const struct strace_record rec = slot->rec;
+		slot->drained = true;
+		pos++;
+
+		while (_ring_head != _ring_tail && _ring[_ring_head & (STRACE_ENTRIES - 1)].drained) {
+			_ring_head++;
+		};
+		asm_irq_restore(eflags);
+
+		if (copy_to_user(user_buf + n, &rec, sizeof(rec)) < 0) {
+			return n ? (int32_t)n : -EFAULT;
+		};
+		n++;
+	};
+	return n;
+};
\ No newline at end of file
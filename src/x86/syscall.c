@@ -10,22 +10,48 @@
 #include "fifo.h"
 #include "heap.h"
 #include "icarius.h"
+#include "ipc.h"
+#include "mmap.h"
+#include "poll.h"
+#include "ring.h"
+#include "shm.h"
+#include "strace.h"
 #include "task.h"
+#include "taskstat.h"
+#include "timer.h"
+#include "tsc.h"
+#include "uaccess.h"
+#include "uio.h"
 #include "unistd.h"
 #include "wq.h"
 
 extern fifo_t fifo_kbd;
 extern fifo_t fifo_mouse;
+extern timer_t timer;
 
 typedef int32_t (*syscall_handler_t)(interrupt_frame_t*);
 
 static void _run_syscall(const int32_t syscall_id, interrupt_frame_t* frame);
 void syscall_dispatch(const int32_t syscall_id, interrupt_frame_t* frame);
+int32_t syscall_invoke(const int32_t syscall_id, interrupt_frame_t* frame);
 void syscall_init(void);
 
+/* EXTERNAL API */
+extern void asm_sysenter(void);
+
 int32_t _sys_exit(interrupt_frame_t* frame);
 size_t _sys_write(interrupt_frame_t* frame);
+int32_t _sys_read(interrupt_frame_t* frame);
+static int32_t _rw_vector(interrupt_frame_t* frame, const syscall_handler_t handler);
+static int32_t _poll_scan(const process_t* caller, struct pollfd* fds, const uint32_t nfds);
+static uint32_t _ms_to_ticks(const uint32_t ms);
+static void _ipc_return(interrupt_frame_t* frame, const ipc_msg_t* msg);
 static const char* _get_name(const int32_t syscall_id);
+static int32_t _copy_user_vector(char* const* user_vec, char** vec, char** strings, size_t* left);
+static void _sysenter_init(void);
+static inline void _wrmsr(const uint32_t msr, const uint64_t value);
+
+static uint8_t _sysenter_stack[SYSENTER_STACK_SIZE] __attribute__((aligned(16)));
 
 void* syscalls[MAX_SYSCALL] = {};
 
@@ -42,8 +68,64 @@ static const char* _get_name(const int32_t syscall_id)
 		return "SYS_OPEN";
 	case SYS_CLOSE:
 		return "SYS_CLOSE";
+	case SYS_WAITPID:
+		return "SYS_WAITPID";
+	case SYS_GETPID:
+		return "SYS_GETPID";
 	case SYS_GETDENTS:
 		return "SYS_GETDENTS";
+	case SYS_READV:
+		return "SYS_READV";
+	case SYS_WRITEV:
+		return "SYS_WRITEV";
+	case SYS_PREAD:
+		return "SYS_PREAD";
+	case SYS_PWRITE:
+		return "SYS_PWRITE";
+	case SYS_MMAP:
+		return "SYS_MMAP";
+	case SYS_MUNMAP:
+		return "SYS_MUNMAP";
+	case SYS_MPROTECT:
+		return "SYS_MPROTECT";
+	case SYS_FCNTL:
+		return "SYS_FCNTL";
+	case SYS_POLL:
+		return "SYS_POLL";
+	case SYS_PIPE:
+		return "SYS_PIPE";
+	case SYS_FSYNC:
+		return "SYS_FSYNC";
+	case SYS_TASKSTAT:
+		return "SYS_TASKSTAT";
+	case SYS_SPAWN:
+		return "SYS_SPAWN";
+	case SYS_RING_SETUP:
+		return "SYS_RING_SETUP";
+	case SYS_RING_ENTER:
+		return "SYS_RING_ENTER";
+	case SYS_SYSCALLSTAT:
+		return "SYS_SYSCALLSTAT";
+	case SYS_STRACE:
+		return "SYS_STRACE";
+	case SYS_STRACE_READ:
+		return "SYS_STRACE_READ";
+	case SYS_SHM_OPEN:
+		return "SYS_SHM_OPEN";
+	case SYS_SHM_UNLINK:
+		return "SYS_SHM_UNLINK";
+	case SYS_PORT_CREATE:
+		return "SYS_PORT_CREATE";
+	case SYS_PORT_DESTROY:
+		return "SYS_PORT_DESTROY";
+	case SYS_IPC_SEND:
+		return "SYS_IPC_SEND";
+	case SYS_IPC_RECEIVE:
+		return "SYS_IPC_RECEIVE";
+	case SYS_IPC_CALL:
+		return "SYS_IPC_CALL";
+	case SYS_IPC_REPLY:
+		return "SYS_IPC_REPLY";
 	default:
 		return "UNKNOWN Syscall";
 	};
@@ -59,24 +141,11 @@ int32_t _sys_getdents(interrupt_frame_t* frame)
 	if (fd < 1 || !user_buf || count < sizeof(struct dirent)) {
 		return -EINVAL;
 	};
-	if ((uintptr_t)user_buf >= KERNEL_VIRTUAL_START) {
-		return -EFAULT;
-	};
-	void* kernel_buf = kzalloc(count + 1);
-
-	if (!kernel_buf) {
-		return -ENOMEM;
-	};
-	task_restore_dir(task_get_curr());
-	memcpy(kernel_buf, user_buf, count);
-	page_restore_kernel_dir();
-
 	vfs_dirent_t ventry = {};
 
 	int32_t ret = vfs_readdir(fd, &ventry);
 
 	if (ret != 1) {
-		kfree(kernel_buf);
 		return 0;
 	};
 
@@ -87,16 +156,77 @@ int32_t _sys_getdents(interrupt_frame_t* frame)
 	    .d_type = (ventry.type == 1) ? DT_DIR : DT_REG,
 	};
 	strncpy(dentry.d_name, ventry.name, sizeof(dentry.d_name));
-	memcpy(kernel_buf, &dentry, sizeof(struct dirent));
-
-	task_restore_dir(task_get_curr());
-	memcpy(user_buf, kernel_buf, sizeof(struct dirent));
-	page_restore_kernel_dir();
 
-	kfree(kernel_buf);
+	if (copy_to_user(user_buf, &dentry, sizeof(struct dirent)) < 0) {
+		return -EFAULT;
+	};
 	return sizeof(struct dirent);
 };
 
+/**
+ * @brief Handles the `taskstat` syscall.
+ *
+ * Copies the accounting of the index-th task (see process_get_task_at) to the user buffer.
+ * Returns 1 if an entry was written, 0 once the index runs past the last task.
+ */
+int32_t _sys_taskstat(interrupt_frame_t* frame)
+{
+	const uint32_t index = frame->ebx;
+	struct taskstat* user_buf = (struct taskstat*)frame->ecx;
+
+	if (!user_buf) {
+		return -EINVAL;
+	};
+	const task_t* task = process_get_task_at(index);
+
+	if (!task) {
+		return 0;
+	};
+	struct taskstat kstat = {
+	    .pid = task->parent ? task->parent->pid : 0,
+	    .tid = 0,
+	    .state = task->state,
+	    .kernel = task->parent && task->parent->filetype == PROCESS_KERNEL_THREAD,
+	    .tsc = tsc_read(),
+	    .run_cycles = task->stat.run_cycles,
+	    .wait_cycles = task->stat.wait_cycles,
+	    .nvcsw = task->stat.nvcsw,
+	    .nivcsw = task->stat.nivcsw,
+	    .wakeups = task->stat.wakeups,
+	    .latency_max = task->stat.latency_max,
+	};
+	// The running task has not been charged for the current slice yet
+	if (task == task_get_curr() && task->stat.switched_in) {
+		kstat.run_cycles += kstat.tsc - task->stat.switched_in;
+	};
+
+	if (task->parent) {
+		strncpy(kstat.name, task->parent->filename, sizeof(kstat.name) - 1);
+
+		for (size_t i = 0; i < PROCESS_MAX_THREAD; i++) {
+			if (task->parent->tasks[i] == task) {
+				kstat.tid = i;
+				break;
+			};
+		};
+	};
+	memcpy(kstat.latency, task->stat.latency_hist, sizeof(kstat.latency));
+
+	if (copy_to_user(user_buf, &kstat, sizeof(struct taskstat)) < 0) {
+		return -EFAULT;
+	};
+	return 1;
+};
+
+/**
+ * @brief Handles the `getpid` syscall, also the null syscall for entry/exit benchmarks.
+ */
+int32_t _sys_getpid(interrupt_frame_t* frame)
+{
+	(void)frame;
+	return task_get_curr()->parent->pid;
+};
+
 int32_t _sys_close(interrupt_frame_t* frame)
 {
 	const int32_t fd = frame->ebx;
@@ -108,6 +238,204 @@ int32_t _sys_close(interrupt_frame_t* frame)
 	return res;
 };
 
+/**
+ * @brief Handles the `waitpid` syscall.
+ *
+ * Sleeps on WAIT_CHILD until the child (pid > 0) or any child (pid == -1) exited,
+ * then writes its exit status to the user pointer (if any) and frees its PID.
+ */
+int32_t _sys_waitpid(interrupt_frame_t* frame)
+{
+	const int32_t pid = frame->ebx;
+	int32_t* user_status = (int32_t*)frame->ecx;
+	const uint32_t options = frame->edx;
+
+	if ((uintptr_t)user_status >= KERNEL_VIRTUAL_START) {
+		return -EFAULT;
+	};
+	process_t* self = task_get_curr()->parent;
+	int32_t status = 0;
+	int32_t res = process_wait(self, pid, &status, options);
+
+	while (res == -EAGAIN) {
+		wq_sleep(WAIT_CHILD);
+		res = process_wait(self, pid, &status, options);
+	};
+
+	if (res > 0 && user_status && copy_to_user(user_status, &status, sizeof(status)) < 0) {
+		return -EFAULT;
+	};
+	return res;
+};
+
+/**
+ * @brief Copies a 0x0 terminated user string vector.
+ *
+ * The strings are packed into *strings, *left is what is still free in there.
+ * @return Number of entries, -EFAULT or -E2BIG
+ */
+static int32_t _copy_user_vector(char* const* user_vec, char** vec, char** strings, size_t* left)
+{
+	int32_t count = 0;
+
+	for (;; count++) {
+		char* user_str = 0x0;
+
+		if (copy_from_user(&user_str, user_vec + count, sizeof(user_str)) < 0) {
+			return -EFAULT;
+		};
+
+		if (!user_str) {
+			break;
+		};
+
+		if (count >= PROCESS_MAX_ARGS) {
+			return -E2BIG;
+		};
+		const int32_t len = strncpy_from_user(*strings, user_str, *left);
+
+		if (len == -ENAMETOOLONG) {
+			return -E2BIG;
+		};
+
+		if (len < 0) {
+			return len;
+		};
+		vec[count] = *strings;
+		*strings += len + 1;
+		*left -= len + 1;
+	};
+	vec[count] = 0x0;
+	return count;
+};
+
+/**
+ * @brief Handles the `spawn` syscall.
+ *
+ * Starts the executable at path as a child of the caller, with argv (0x0 = { path }) and envp
+ * (0x0 = empty). There is no fork, the child is built from the executable directly.
+ * A foreground caller hands the terminal to the child, it comes back when the child exits.
+ * Returns the PID of the child.
+ */
+int32_t _sys_spawn(interrupt_frame_t* frame)
+{
+	const char* user_path = (const char*)frame->ebx;
+	char* const* user_argv = (char* const*)frame->ecx;
+	char* const* user_envp = (char* const*)frame->edx;
+
+	char path[PROCESS_MAX_FILENAME] = {};
+	char* argv[PROCESS_MAX_ARGS + 1] = {};
+	char* envp[PROCESS_MAX_ARGS + 1] = {};
+	char* block = kzalloc(PROCESS_MAX_ARG_BYTES);
+
+	if (!block) {
+		return -ENOMEM;
+	};
+	char* strings = block;
+	size_t left = PROCESS_MAX_ARG_BYTES;
+	int32_t res = strncpy_from_user(path, user_path, sizeof(path));
+
+	if (res >= 0 && user_argv) {
+		res = _copy_user_vector(user_argv, argv, &strings, &left);
+	};
+
+	if (res >= 0 && user_envp) {
+		res = _copy_user_vector(user_envp, envp, &strings, &left);
+	};
+
+	if (res < 0) {
+		kfree(block);
+		return res;
+	};
+	process_t* self = task_get_curr()->parent;
+	errno = 0;
+	process_t* child = process_spawnv(path, user_argv ? argv : 0x0, envp);
+	kfree(block);
+
+	if (!child) {
+		return errno ? errno : -ENOMEM;
+	};
+
+	if (tty_get_foreground() == self) {
+		tty_set_foreground(child);
+	};
+	scheduler_get()->add_cb(child->tasks[0]);
+	return child->pid;
+};
+
+/**
+ * @brief Handles the `ring_setup` syscall, writes the address of the caller's ring to the user pointer.
+ */
+int32_t _sys_ring_setup(interrupt_frame_t* frame)
+{
+	ring_t** user_ring = (ring_t**)frame->ebx;
+	errno = 0;
+	ring_t* ring = ring_setup(task_get_curr()->parent);
+
+	if (!ring) {
+		return errno ? errno : -ENOMEM;
+	};
+
+	if (copy_to_user(user_ring, &ring, sizeof(ring)) < 0) {
+		return -EFAULT;
+	};
+	return 0;
+};
+
+/**
+ * @brief Handles the `ring_enter` syscall: one kernel entry for up to to_submit queued syscalls.
+ */
+int32_t _sys_ring_enter(interrupt_frame_t* frame)
+{
+	const uint32_t to_submit = frame->ebx;
+	return ring_enter(task_get_curr()->parent, to_submit);
+};
+
+/**
+ * @brief Handles the `syscallstat` syscall: counters and duration histogram of syscall id.
+ * Returns 1 if an entry was written, 0 once id runs past MAX_SYSCALL.
+ */
+int32_t _sys_syscallstat(interrupt_frame_t* frame)
+{
+	const int32_t id = frame->ebx;
+	struct syscallstat* user_buf = (struct syscallstat*)frame->ecx;
+	struct syscallstat kstat = {};
+
+	if (!strace_get_stat(id, &kstat)) {
+		return 0;
+	};
+	strncpy(kstat.name, _get_name(id), sizeof(kstat.name) - 1);
+
+	if (copy_to_user(user_buf, &kstat, sizeof(kstat)) < 0) {
+		return -EFAULT;
+	};
+	return 1;
+};
+
+/**
+ * @brief Handles the `strace` syscall, sets the STRACE_* flags of pid (0 = caller, otherwise one of its children).
+ */
+int32_t _sys_strace(interrupt_frame_t* frame)
+{
+	const int32_t pid = frame->ebx;
+	const uint32_t flags = frame->ecx;
+	return strace_set(pid, flags);
+};
+
+/**
+ * @brief Handles the `strace_read` syscall, drains up to max records of processes the caller traces.
+ */
+int32_t _sys_strace_read(interrupt_frame_t* frame)
+{
+	struct strace_record* user_buf = (struct strace_record*)frame->ebx;
+	const int32_t max = frame->ecx;
+
+	if (max < 0) {
+		return -EINVAL;
+	};
+	return strace_read(user_buf, max);
+};
+
 int32_t _sys_exit(interrupt_frame_t* frame)
 {
 	const int32_t status = frame->ebx;
@@ -117,16 +445,16 @@ int32_t _sys_exit(interrupt_frame_t* frame)
 
 	char buf[128];
 	strncpy(buf, parent->filename, sizeof(parent->filename));
+	const uint16_t ppid = parent->ppid;
 
 	task_exit(task);
 
 	if (parent->task_count == 0) {
-		process_exit(parent);
+		process_exit(parent, status);
 	};
-	task->state = TASK_STATE_TERMINATE;
-	// Respawn SHELL :)
-	if (strcmp(buf, "A:/BIN/ICARSH.BIN") == 0) {
-		process_t* icarsh = process_spawn("A:/BIN/ICARSH.BIN");
+	// Respawn SHELL :) (only the login shell, a nested one just returns to its parent)
+	if (ppid == 0 && strcmp(buf, "A:/BIN/ICARSH.ELF") == 0) {
+		process_t* icarsh = process_spawn("A:/BIN/ICARSH.ELF");
 
 		if (!icarsh) {
 			panic("Failed to restart ICARSH");
@@ -141,26 +469,14 @@ int32_t _sys_exit(interrupt_frame_t* frame)
 
 int32_t _sys_open(interrupt_frame_t* frame)
 {
-	task_restore_dir(task_get_curr());
 	const char* user_buf = (const char*)frame->ebx;
-	const size_t count = strlen(user_buf);
+	const int flag = frame->ecx & ~VFS_NONBLOCK;
+	char path[PROCESS_MAX_FILENAME] = {};
+	const int32_t len = strncpy_from_user(path, user_buf, sizeof(path));
 
-	if ((uintptr_t)user_buf >= KERNEL_VIRTUAL_START) {
-		return -EFAULT;
-	};
-	page_restore_kernel_dir();
-	int flag = frame->ecx;
-	void* kernel_buf = kzalloc(count + 1);
-
-	if (!kernel_buf) {
-		return -ENOMEM;
+	if (len < 0) {
+		return len;
 	};
-	task_restore_dir(task_get_curr());
-	strncpy(kernel_buf, user_buf, count);
-
-	((uint8_t*)kernel_buf)[count] = '\0';
-	page_restore_kernel_dir();
-
 	char* mode;
 
 	switch (flag) {
@@ -173,58 +489,69 @@ int32_t _sys_open(interrupt_frame_t* frame)
 		break;
 	};
 	default: {
-		kfree(kernel_buf);
 		return -EINVAL;
 	};
 	};
-	const int32_t fd = vfs_fopen(kernel_buf, mode);
-	kfree(kernel_buf);
+	const int32_t fd = vfs_fopen(path, mode);
 
 	if (fd < 1) {
 		return -ENOENT;
 	};
+	vfs_set_flags(fd, frame->ecx);
 	return fd;
 };
 
+/**
+ * @brief Handles the `write` syscall.
+ *
+ * The user buffer is copied in SYSCALL_CHUNK_SIZE pieces on the stack (plus a 0 for kprintf),
+ * no heap allocation per call. Returns the bytes written, or -EFAULT if nothing could be copied.
+ */
 size_t _sys_write(interrupt_frame_t* frame)
 {
-	const int32_t syscall_id = frame->eax;
 	const int32_t fd = frame->ebx;
+	const uint8_t* user_buf = (const uint8_t*)frame->ecx;
 	const size_t count = frame->edx;
-	void* kernel_buf = kzalloc(count);
+	char chunk[SYSCALL_CHUNK_SIZE + 1];
+	size_t done = 0;
 
-	if (!kernel_buf) {
-		return -ENOMEM;
-	};
-	task_restore_dir(task_get_curr());
-	void* user_buf = (void*)frame->ecx;
+	while (done < count) {
+		const size_t n = (count - done < SYSCALL_CHUNK_SIZE) ? count - done : SYSCALL_CHUNK_SIZE;
 
-	memcpy(kernel_buf, user_buf, count);
-	((uint8_t*)kernel_buf)[count] = '\0';
+		if (copy_from_user(chunk, user_buf + done, n) < 0) {
+			return done ? done : (size_t)-EFAULT;
+		};
 
-	page_restore_kernel_dir();
+		if (fd == FD_STDOUT || fd == FD_STDERR) {
+			chunk[n] = '\0';
+			kprintf("%s", chunk);
+			done += n;
+			continue;
+		};
+		const int32_t written = vfs_fwrite(chunk, n, 1, fd);
 
-	if (fd == FD_STDOUT || fd == FD_STDERR) {
-		kprintf("%s", (uint8_t*)kernel_buf);
-		kfree(kernel_buf);
-		return count;
-	};
-	const size_t written = vfs_fwrite(kernel_buf, count, 1, fd);
+		if (written < 0) {
+			// A full non-blocking pipe or one without a reader is no error worth a message
+			if (written != -EAGAIN && written != -EPIPE) {
+				kprintf("[ERROR] Failed to write to file FD: %d\n", fd);
+			};
+			return done ? done : (size_t)written;
+		};
+		done += written;
 
-	if (written < 0) {
-		kprintf("[ERROR] Failed to write to file FD: %d\n", fd);
+		if ((size_t)written < n) {
+			break;
+		};
 	};
-	kfree(kernel_buf);
-	return count;
+	return done;
 };
 
 /**
  * @brief Handles the `read` syscall (int 0x80) for user processes.
  *
- * Blocks the task if reading from FD_STDIN and the keyboard buffer is empty.
- * Ensures kernel/user memory isolation by copying data through an internal kernel buffer.
- * Prevents invalid memory access by validating user buffer and allocation results.
- * Resumes the kernel's page directory after user-specific VFS operations.
+ * Puts the task to sleep on WAIT_KEYBOARD if reading from FD_STDIN and the keyboard buffer is empty,
+ * returns as soon as at least one byte is available (the caller gets what is there, up to count).
+ * Data reaches the user buffer through copy_to_user in SYSCALL_CHUNK_SIZE stack chunks, only the n_read bytes are copied.
  * Only FD_STDIN and valid file descriptors are supported; STDOUT/STDERR are rejected.
  */
 int32_t _sys_read(interrupt_frame_t* frame)
@@ -232,66 +559,512 @@ int32_t _sys_read(interrupt_frame_t* frame)
 	const int32_t fd = frame->ebx;
 	const size_t count = frame->edx;
 	int32_t n_read = 0;
-	void* user_buf = (void*)frame->ecx;
+	uint8_t* user_buf = (uint8_t*)frame->ecx;
+	uint8_t chunk[SYSCALL_CHUNK_SIZE];
 
 	if (!user_buf || !count) {
 		return -1;
 	};
-	void* kernel_buf = kzalloc(count);
-
-	if (!kernel_buf) {
-		return -1;
-	};
-	((char*)kernel_buf)[count] = '\0';
-
 	process_t* caller = task_get_curr()->parent;
 
 	if (!caller) {
-		kfree(kernel_buf);
 		return -1;
 	};
 
 	switch (fd) {
 	case FD_STDIN: {
-		for (size_t i = 0; i < count; i++) {
-			if (fifo_is_empty(caller->keyboard_buffer)) {
-				task_t* task = caller->tasks[0];
-				task_set_block(task);
-				task_block_on(task, WAIT_KEYBOARD);
-				wq_push(task);
-				break;
+		while (fifo_is_empty(caller->keyboard_buffer)) {
+			if (caller->stdin_flags & VFS_NONBLOCK) {
+				return -EAGAIN;
 			};
+			wq_sleep(WAIT_KEYBOARD);
+		};
+		size_t n = 0;
+
+		while (n_read + n < count && n < SYSCALL_CHUNK_SIZE && fifo_dequeue(caller->keyboard_buffer, chunk + n)) {
+			n++;
 
-			if (!fifo_dequeue(caller->keyboard_buffer, (uint8_t*)kernel_buf + i)) {
-				kfree(kernel_buf);
-				return i;
+			if (n == SYSCALL_CHUNK_SIZE || n_read + n == count || fifo_is_empty(caller->keyboard_buffer)) {
+				if (copy_to_user(user_buf + n_read, chunk, n) < 0) {
+					return n_read ? n_read : -EFAULT;
+				};
+				n_read += n;
+				n = 0;
 			};
 		};
 		break;
 	};
 	case FD_STDOUT:
 	case FD_STDERR: {
-		kfree(kernel_buf);
 		return -1;
 	};
 	default: {
-		n_read = vfs_fread(kernel_buf, count, 1, fd);
+		while (n_read < count) {
+			// Only the first chunk may sleep (pipes), afterwards take what is ready
+			if (n_read && !(vfs_poll(fd, POLLIN) & POLLIN)) {
+				break;
+			};
+			const size_t want = (count - n_read < SYSCALL_CHUNK_SIZE) ? count - n_read : SYSCALL_CHUNK_SIZE;
+			const int32_t n = vfs_fread(chunk, want, 1, fd);
 
-		if (n_read < 0) {
-			n_read = -1;
+			if (n <= 0) {
+				return n_read ? n_read : (n == -EAGAIN ? -EAGAIN : (n < 0 ? -1 : 0));
+			};
+
+			if (copy_to_user(user_buf + n_read, chunk, n) < 0) {
+				return n_read ? n_read : -EFAULT;
+			};
+			n_read += n;
+
+			if ((size_t)n < want) {
+				break;
+			};
 		};
 		break;
 	};
 	};
-	task_restore_dir(task_get_curr());
-	memcpy(user_buf, kernel_buf, count);
+	return n_read;
+};
+
+/**
+ * @brief Runs read or write once per iovec entry.
+ *
+ * The iovec array (at most IOV_MAX entries) is copied in once, every buffer then goes through the
+ * regular handler. Stops at the first short transfer, just like a single read/write would.
+ */
+static int32_t _rw_vector(interrupt_frame_t* frame, const syscall_handler_t handler)
+{
+	const struct iovec* user_iov = (const struct iovec*)frame->ecx;
+	const int32_t iovcnt = frame->edx;
+	struct iovec iov[IOV_MAX];
+	size_t total = 0;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX) {
+		return -EINVAL;
+	};
+
+	if (copy_from_user(iov, user_iov, iovcnt * sizeof(struct iovec)) < 0) {
+		return -EFAULT;
+	};
+
+	for (int32_t i = 0; i < iovcnt; i++) {
+		// The sum must still fit the int32_t return value
+		if (iov[i].iov_len > (size_t)INT32_MAX - total) {
+			return -EINVAL;
+		};
+		total += iov[i].iov_len;
+	};
+	int32_t done = 0;
 
-	page_restore_kernel_dir();
+	for (int32_t i = 0; i < iovcnt; i++) {
+		if (!iov[i].iov_len) {
+			continue;
+		};
+		interrupt_frame_t single = *frame;
+		single.ecx = (uint32_t)iov[i].iov_base;
+		single.edx = iov[i].iov_len;
+		const int32_t n = handler(&single);
+
+		if (n < 0) {
+			return done ? done : n;
+		};
+		done += n;
+
+		if ((size_t)n < iov[i].iov_len) {
+			break;
+		};
+	};
+	return done;
+};
+
+/**
+ * @brief Handles the `readv` syscall, scatter read into up to IOV_MAX buffers.
+ */
+int32_t _sys_readv(interrupt_frame_t* frame)
+{
+	return _rw_vector(frame, (syscall_handler_t)_sys_read);
+};
+
+/**
+ * @brief Handles the `writev` syscall, gather write from up to IOV_MAX buffers.
+ */
+int32_t _sys_writev(interrupt_frame_t* frame)
+{
+	return _rw_vector(frame, (syscall_handler_t)_sys_write);
+};
+
+/**
+ * @brief Handles the `pread` syscall.
+ *
+ * Reads at the offset in EDI (the 4th argument) through vfs_fpread, the file position stays where it is.
+ * The console has no position, FD_STDIN/STDOUT/STDERR give -ESPIPE.
+ */
+int32_t _sys_pread(interrupt_frame_t* frame)
+{
+	const int32_t fd = frame->ebx;
+	uint8_t* user_buf = (uint8_t*)frame->ecx;
+	const size_t count = frame->edx;
+	const uint32_t offset = frame->edi;
+	uint8_t chunk[SYSCALL_CHUNK_SIZE];
+	int32_t n_read = 0;
 
-	kfree(kernel_buf);
+	if (fd == FD_STDIN || fd == FD_STDOUT || fd == FD_STDERR) {
+		return -ESPIPE;
+	};
+
+	if (!user_buf) {
+		return -EFAULT;
+	};
+
+	while ((size_t)n_read < count) {
+		const size_t want = (count - n_read < SYSCALL_CHUNK_SIZE) ? count - n_read : SYSCALL_CHUNK_SIZE;
+		const int32_t n = vfs_fpread(chunk, want, 1, offset + n_read, fd);
+
+		if (n <= 0) {
+			return n_read ? n_read : n;
+		};
+
+		if (copy_to_user(user_buf + n_read, chunk, n) < 0) {
+			return n_read ? n_read : -EFAULT;
+		};
+		n_read += n;
+
+		if ((size_t)n < want) {
+			break;
+		};
+	};
 	return n_read;
 };
 
+/**
+ * @brief Handles the `pwrite` syscall.
+ *
+ * Writes at the offset in EDI through vfs_fpwrite: no truncation, no change of the file position.
+ */
+int32_t _sys_pwrite(interrupt_frame_t* frame)
+{
+	const int32_t fd = frame->ebx;
+	const uint8_t* user_buf = (const uint8_t*)frame->ecx;
+	const size_t count = frame->edx;
+	const uint32_t offset = frame->edi;
+	uint8_t chunk[SYSCALL_CHUNK_SIZE];
+	int32_t done = 0;
+
+	if (fd == FD_STDIN || fd == FD_STDOUT || fd == FD_STDERR) {
+		return -ESPIPE;
+	};
+
+	while ((size_t)done < count) {
+		const size_t n = (count - done < SYSCALL_CHUNK_SIZE) ? count - done : SYSCALL_CHUNK_SIZE;
+
+		if (copy_from_user(chunk, user_buf + done, n) < 0) {
+			return done ? done : -EFAULT;
+		};
+		const int32_t written = vfs_fpwrite(chunk, n, 1, offset + done, fd);
+
+		if (written < 0) {
+			return done ? done : written;
+		};
+		done += written;
+
+		if ((size_t)written < n) {
+			break;
+		};
+	};
+	return done;
+};
+
+/**
+ * @brief Handles the `fsync` syscall.
+ *
+ * Disk writes stay in the drive's write cache, this is the barrier that puts them on the medium.
+ */
+int32_t _sys_fsync(interrupt_frame_t* frame)
+{
+	const int32_t fd = frame->ebx;
+
+	if (fd == FD_STDIN || fd == FD_STDOUT || fd == FD_STDERR) {
+		return -EINVAL;
+	};
+	return vfs_fsync(fd);
+};
+
+/**
+ * @brief Handles the `mmap` syscall (old_mmap: EBX points to a struct mmap_args).
+ *
+ * Returns the address of the mapping, or a negative errno (libc turns -4095..-1 into MAP_FAILED).
+ */
+int32_t _sys_mmap(interrupt_frame_t* frame)
+{
+	struct mmap_args args = {};
+
+	if (copy_from_user(&args, (const void*)frame->ebx, sizeof(struct mmap_args)) < 0) {
+		return -EFAULT;
+	};
+	return mmap_map(task_get_curr()->parent, &args);
+};
+
+/**
+ * @brief Handles the `munmap` syscall.
+ */
+int32_t _sys_munmap(interrupt_frame_t* frame)
+{
+	return mmap_unmap(task_get_curr()->parent, frame->ebx, frame->ecx);
+};
+
+/**
+ * @brief Handles the `mprotect` syscall, only for pages from mmap.
+ */
+int32_t _sys_mprotect(interrupt_frame_t* frame)
+{
+	return mmap_protect(task_get_curr()->parent, frame->ebx, frame->ecx, frame->edx);
+};
+
+/**
+ * @brief Handles the `fcntl` syscall, F_GETFL and F_SETFL (O_NONBLOCK) only.
+ */
+int32_t _sys_fcntl(interrupt_frame_t* frame)
+{
+	const int32_t fd = frame->ebx;
+	const int32_t cmd = frame->ecx;
+	const uint32_t arg = frame->edx;
+	process_t* caller = task_get_curr()->parent;
+
+	if (cmd != F_GETFL && cmd != F_SETFL) {
+		return -EINVAL;
+	};
+
+	switch (fd) {
+	case FD_STDIN: {
+		if (cmd == F_SETFL) {
+			caller->stdin_flags = (caller->stdin_flags & ~VFS_NONBLOCK) | (arg & VFS_NONBLOCK);
+			return 0;
+		};
+		return caller->stdin_flags;
+	};
+	case FD_STDOUT:
+	case FD_STDERR: {
+		// Console output never blocks
+		return (cmd == F_GETFL) ? VFS_WRONLY : 0;
+	};
+	default: {
+		return (cmd == F_GETFL) ? vfs_get_flags(fd) : vfs_set_flags(fd, arg);
+	};
+	};
+	return -EINVAL;
+};
+
+// Rounded up, so a short timeout still sleeps at least one tick
+static uint32_t _ms_to_ticks(const uint32_t ms)
+{
+	return (ms / 1000) * timer.hz + ((ms % 1000) * timer.hz + 999) / 1000;
+};
+
+// Fills in revents of every entry, returns the number of entries with any revents set
+static int32_t _poll_scan(const process_t* caller, struct pollfd* fds, const uint32_t nfds)
+{
+	int32_t ready = 0;
+
+	for (uint32_t i = 0; i < nfds; i++) {
+		struct pollfd* pfd = &fds[i];
+		pfd->revents = 0;
+
+		if (pfd->fd < 0) {
+			continue;
+		};
+
+		switch (pfd->fd) {
+		case FD_STDIN: {
+			pfd->revents = fifo_is_empty(caller->keyboard_buffer) ? 0 : (pfd->events & POLLIN);
+			break;
+		};
+		case FD_STDOUT:
+		case FD_STDERR: {
+			pfd->revents = pfd->events & POLLOUT;
+			break;
+		};
+		default: {
+			pfd->revents = vfs_poll(pfd->fd, pfd->events);
+			break;
+		};
+		};
+
+		if (pfd->revents) {
+			ready++;
+		};
+	};
+	return ready;
+};
+
+/**
+ * @brief Handles the `poll` syscall.
+ *
+ * Scans all entries, if none is ready the task sleeps on WAIT_POLL until an event source
+ * (keyboard, pipes) wakes it or the timeout (ms, -1 = none, 0 = don't sleep) runs out, then scans again.
+ * Syscalls run with interrupts off, so no wakeup gets lost between the scan and the sleep.
+ * @return Number of ready entries, 0 on timeout
+ */
+int32_t _sys_poll(interrupt_frame_t* frame)
+{
+	struct pollfd* user_fds = (struct pollfd*)frame->ebx;
+	const uint32_t nfds = frame->ecx;
+	const int32_t timeout = frame->edx;
+	struct pollfd fds[POLL_MAX];
+	process_t* caller = task_get_curr()->parent;
+
+	if (nfds > POLL_MAX) {
+		return -EINVAL;
+	};
+
+	if (copy_from_user(fds, user_fds, nfds * sizeof(struct pollfd)) < 0) {
+		return -EFAULT;
+	};
+	const uint64_t deadline = (timeout > 0) ? timer.ticks + _ms_to_ticks(timeout) : 0;
+	int32_t ready = 0;
+
+	while (true) {
+		ready = _poll_scan(caller, fds, nfds);
+
+		if (ready || timeout == 0 || (timeout > 0 && timer.ticks >= deadline)) {
+			break;
+		};
+		wq_sleep_until(WAIT_POLL, deadline);
+	};
+
+	if (copy_to_user(user_fds, fds, nfds * sizeof(struct pollfd)) < 0) {
+		return -EFAULT;
+	};
+	return ready;
+};
+
+/**
+ * @brief Handles the `pipe` syscall, writes the read and the write end to the user array.
+ */
+int32_t _sys_pipe(interrupt_frame_t* frame)
+{
+	int32_t* user_fds = (int32_t*)frame->ebx;
+	int32_t fds[2] = {};
+	const int32_t res = vfs_pipe(fds);
+
+	if (res < 0) {
+		return res;
+	};
+
+	if (copy_to_user(user_fds, fds, sizeof(fds)) < 0) {
+		vfs_fclose(fds[0]);
+		vfs_fclose(fds[1]);
+		return -EFAULT;
+	};
+	return 0;
+};
+
+/**
+ * @brief Handles the `shm_open` syscall, O_CREAT / O_EXCL are honoured, the mode is ignored.
+ */
+int32_t _sys_shm_open(interrupt_frame_t* frame)
+{
+	const char* user_name = (const char*)frame->ebx;
+	const uint32_t flags = frame->ecx;
+	char name[SHM_NAME_MAX] = {};
+	const int32_t res = strncpy_from_user(name, user_name, sizeof(name));
+
+	if (res < 0) {
+		return res;
+	};
+	return shm_open(name, flags);
+};
+
+/**
+ * @brief Handles the `shm_unlink` syscall.
+ */
+int32_t _sys_shm_unlink(interrupt_frame_t* frame)
+{
+	const char* user_name = (const char*)frame->ebx;
+	char name[SHM_NAME_MAX] = {};
+	const int32_t res = strncpy_from_user(name, user_name, sizeof(name));
+
+	if (res < 0) {
+		return res;
+	};
+	return shm_unlink(name);
+};
+
+int32_t _sys_port_create(interrupt_frame_t* frame)
+{
+	(void)frame;
+	return ipc_port_create(task_get_curr()->parent);
+};
+
+int32_t _sys_port_destroy(interrupt_frame_t* frame)
+{
+	const int32_t port = frame->ebx;
+	return ipc_port_destroy(task_get_curr()->parent, port);
+};
+
+// A message comes back in EBX/EDI: popad restores both on the int 0x80 and the SYSEXIT path
+static void _ipc_return(interrupt_frame_t* frame, const ipc_msg_t* msg)
+{
+	frame->ebx = msg->w[0];
+	frame->edi = msg->w[1];
+	return;
+};
+
+/**
+ * @brief Handles the `ipc_send` syscall, returns once the receiver took the message.
+ */
+int32_t _sys_ipc_send(interrupt_frame_t* frame)
+{
+	const int32_t port = frame->ebx;
+	const ipc_msg_t msg = {.w = {frame->ecx, frame->edx}};
+	return ipc_send(port, &msg);
+};
+
+/**
+ * @brief Handles the `ipc_receive` syscall, the badge (sender PID) is the return value.
+ */
+int32_t _sys_ipc_receive(interrupt_frame_t* frame)
+{
+	const int32_t port = frame->ebx;
+	ipc_msg_t msg = {};
+	const int32_t badge = ipc_receive(port, &msg);
+
+	if (badge > 0) {
+		_ipc_return(frame, &msg);
+	};
+	return badge;
+};
+
+/**
+ * @brief Handles the `ipc_call` syscall, send plus waiting for the reply.
+ */
+int32_t _sys_ipc_call(interrupt_frame_t* frame)
+{
+	const int32_t port = frame->ebx;
+	ipc_msg_t msg = {.w = {frame->ecx, frame->edx}};
+	const int32_t res = ipc_call(port, &msg);
+
+	if (res == 0) {
+		_ipc_return(frame, &msg);
+	};
+	return res;
+};
+
+/**
+ * @brief Handles the `ipc_reply` syscall, with a port in EDI it also receives the next message.
+ */
+int32_t _sys_ipc_reply(interrupt_frame_t* frame)
+{
+	const int32_t badge = frame->ebx;
+	const int32_t port = frame->edi;
+	ipc_msg_t msg = {.w = {frame->ecx, frame->edx}};
+	const int32_t res = ipc_reply(badge, &msg, port);
+
+	if (port && res > 0) {
+		_ipc_return(frame, &msg);
+	};
+	return res;
+};
+
 static void _run_syscall(const int32_t syscall_id, interrupt_frame_t* frame)
 {
 	if (syscall_id < 0 || syscall_id >= MAX_SYSCALL) {
@@ -301,13 +1074,31 @@ static void _run_syscall(const int32_t syscall_id, interrupt_frame_t* frame)
 	if (!syscalls[syscall_id]) {
 		panic("Syscall [%s] (%d) not registered!\n", _get_name(syscall_id), (int)syscall_id);
 	};
-	const syscall_handler_t handler = (syscall_handler_t)syscalls[syscall_id];
-	frame->eax = handler(frame);
+	frame->eax = syscall_invoke(syscall_id, frame);
 	// kprintf("\n[DEBUG] Syscall [%d]\n", syscall_id);
 	// kernel_shell();
 	return;
 };
 
+/**
+ * @brief Runs a syscall handler and accounts it (strace), -ENOSYS if there is none.
+ *
+ * Used by the int 0x80 / SYSENTER path and for ring entries, so a ring_enter shows up
+ * itself and once more per entry it ran.
+ */
+int32_t syscall_invoke(const int32_t syscall_id, interrupt_frame_t* frame)
+{
+	if (syscall_id < 0 || syscall_id >= MAX_SYSCALL || !syscalls[syscall_id]) {
+		return -ENOSYS;
+	};
+	const syscall_handler_t handler = (syscall_handler_t)syscalls[syscall_id];
+	const int32_t args[3] = {frame->ebx, frame->ecx, frame->edx};
+	const uint64_t start = tsc_read();
+	const int32_t res = handler(frame);
+	strace_account(syscall_id, args, res, start);
+	return res;
+};
+
 void syscall_dispatch(const int32_t syscall_id, interrupt_frame_t* frame)
 {
 	// kprintf("=====================================\n");
@@ -315,18 +1106,54 @@ void syscall_dispatch(const int32_t syscall_id, interrupt_frame_t* frame)
 	// kprintf("=====================================\n");
 
 	// idt_dump_interrupt_frame(frame);
-	page_restore_kernel_dir();
+	// The kernel half is shared (page_map_kernel), the syscall runs on the caller's directory
 	asm_restore_kernel_segment();
 
 	task_save(frame);
 
 	_run_syscall(syscall_id, frame);
 
-	task_restore_dir(task_get_curr());
+	// Only reload CR3 (and flush the TLB) if the syscall switched to another task
+	task_t* task = task_get_curr();
+
+	if (page_get_dir() != (uint32_t*)v2p((void*)task->parent->page_dir)) {
+		task_restore_dir(task);
+	};
 	asm_restore_user_segment();
 	return;
 };
 
+static inline void _wrmsr(const uint32_t msr, const uint64_t value)
+{
+	asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+	return;
+};
+
+/**
+ * @brief Points the SYSENTER MSRs at asm_sysenter, if the CPU has SEP.
+ *
+ * int 0x80 stays available, libc picks SYSENTER itself after checking CPUID.
+ */
+static void _sysenter_init(void)
+{
+	uint32_t eax = 1, ebx, ecx, edx;
+	asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+	const uint32_t family = (eax >> 8) & 0xF;
+	const uint32_t model = (eax >> 4) & 0xF;
+	const uint32_t stepping = eax & 0xF;
+
+	// Early Pentium Pro report SEP without implementing it
+	if (!(edx & CPUID_FEAT_EDX_SEP) || (family == 6 && model < 3 && stepping < 3)) {
+		kprintf("[INFO] SYSENTER not supported, Syscalls via int 0x80 only\n");
+		return;
+	};
+	_wrmsr(MSR_SYSENTER_CS, GDT_KERNEL_CODE_SEGMENT);
+	_wrmsr(MSR_SYSENTER_ESP, (uintptr_t)(_sysenter_stack + SYSENTER_STACK_SIZE));
+	_wrmsr(MSR_SYSENTER_EIP, (uintptr_t)asm_sysenter);
+	kprintf("[INFO] SYSENTER enabled\n");
+	return;
+};
+
 void syscall_init(void)
 {
 	for (int32_t id = 0; id < MAX_SYSCALL; id++) {
@@ -337,6 +1164,35 @@ void syscall_init(void)
 	syscalls[SYS_READ] = (void*)_sys_read;
 	syscalls[SYS_OPEN] = (void*)_sys_open;
 	syscalls[SYS_CLOSE] = (void*)_sys_close;
+	syscalls[SYS_WAITPID] = (void*)_sys_waitpid;
 	syscalls[SYS_GETDENTS] = (void*)_sys_getdents;
+	syscalls[SYS_TASKSTAT] = (void*)_sys_taskstat;
+	syscalls[SYS_SPAWN] = (void*)_sys_spawn;
+	syscalls[SYS_GETPID] = (void*)_sys_getpid;
+	syscalls[SYS_RING_SETUP] = (void*)_sys_ring_setup;
+	syscalls[SYS_RING_ENTER] = (void*)_sys_ring_enter;
+	syscalls[SYS_SYSCALLSTAT] = (void*)_sys_syscallstat;
+	syscalls[SYS_STRACE] = (void*)_sys_strace;
+	syscalls[SYS_STRACE_READ] = (void*)_sys_strace_read;
+	syscalls[SYS_READV] = (void*)_sys_readv;
+	syscalls[SYS_WRITEV] = (void*)_sys_writev;
+	syscalls[SYS_PREAD] = (void*)_sys_pread;
+	syscalls[SYS_PWRITE] = (void*)_sys_pwrite;
+	syscalls[SYS_MMAP] = (void*)_sys_mmap;
+	syscalls[SYS_MUNMAP] = (void*)_sys_munmap;
+	syscalls[SYS_MPROTECT] = (void*)_sys_mprotect;
+	syscalls[SYS_FCNTL] = (void*)_sys_fcntl;
+	syscalls[SYS_POLL] = (void*)_sys_poll;
+	syscalls[SYS_PIPE] = (void*)_sys_pipe;
+	syscalls[SYS_FSYNC] = (void*)_sys_fsync;
+	syscalls[SYS_SHM_OPEN] = (void*)_sys_shm_open;
+	syscalls[SYS_SHM_UNLINK] = (void*)_sys_shm_unlink;
+	syscalls[SYS_PORT_CREATE] = (void*)_sys_port_create;
+	syscalls[SYS_PORT_DESTROY] = (void*)_sys_port_destroy;
+	syscalls[SYS_IPC_SEND] = (void*)_sys_ipc_send;
+	syscalls[SYS_IPC_RECEIVE] = (void*)_sys_ipc_receive;
+	syscalls[SYS_IPC_CALL] = (void*)_sys_ipc_call;
+	syscalls[SYS_IPC_REPLY] = (void*)_sys_ipc_reply;
+	_sysenter_init();
 	return;
 };
\ No newline at end of file
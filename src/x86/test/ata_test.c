@@ -5,6 +5,9 @@
  */
 
 #include "ata_test.h"
+#include "tsc.h"
+
+static void _bench_mode(ata_t* dev, const char* name, uint8_t* buffer, const bool per_sector);
 
 void test_ata_write(ata_t* dev)
 {
@@ -59,4 +62,119 @@ void test_ata_write(ata_t* dev)
 	};
 	busy_wait(500000);
 	return;
+};
+
+void test_ata_coro_read(ata_t* dev)
+{
+	if (!dev) {
+		return;
+	};
+	const uint32_t test_sector = 4096;
+	const uint16_t sectors = 4;
+
+	uint8_t* async_buffer = kzalloc(sectors * ATA_SECTOR_SIZE);
+
+	if (!async_buffer) {
+		return;
+	};
+	ata_request_t req = {
+	    .dev = dev,
+	    .lba = test_sector,
+	    .count = sectors,
+	    .buffer = async_buffer,
+	};
+	coro_t coro = {};
+	coro_init(&coro, ata_read_coro, &req);
+	const int32_t res = coro_await(&coro);
+	kprintf("[KERNEL] ata_read_coro() returned %d\n", res);
+
+	if (res != sectors) {
+		kprintf("[KERNEL] ERROR: ata_read_coro()!\n");
+		kfree(async_buffer);
+		return;
+	};
+	bool match = true;
+
+	for (uint16_t i = 0; i < sectors; i++) {
+		ata_read(dev, test_sector + i, 1);
+
+		if (memcmp(async_buffer + i * ATA_SECTOR_SIZE, dev->buffer, ATA_SECTOR_SIZE) != 0) {
+			kprintf("[KERNEL] Mismatch in Sector %d\n", test_sector + i);
+			match = false;
+		};
+	};
+
+	if (match) {
+		kprintf("[KERNEL] SUCCESS: ata_read_coro()!\n");
+	} else {
+		kprintf("[KERNEL] ERROR: ata_read_coro()!\n");
+	};
+	kfree(async_buffer);
+	return;
+};
+
+// Times ATA_BENCH_SECTORS sectors in one mode, per_sector = one ata_read command per sector (the old stream_read pattern)
+static void _bench_mode(ata_t* dev, const char* name, uint8_t* buffer, const bool per_sector)
+{
+	const uint32_t test_sector = 4096;
+	int32_t res = 0;
+	const uint64_t start = tsc_read();
+
+	if (per_sector) {
+		for (uint32_t i = 0; i < ATA_BENCH_SECTORS && res >= 0; i++) {
+			res = ata_read(dev, test_sector + i, 1);
+		};
+	} else {
+		res = ata_read_into(dev, test_sector, ATA_BENCH_SECTORS, buffer);
+	};
+	const uint64_t cycles = tsc_read() - start;
+
+	if (res < 0) {
+		kprintf("[KERNEL] ERROR: %s failed with %d\n", name, res);
+		return;
+	};
+	// No 64-bit division, kilocycles keep the numbers in 32 bits
+	kprintf("[KERNEL] %s: %d KiB in %d kcycles\n", name, ATA_BENCH_SECTORS * ATA_SECTOR_SIZE / 1024, (uint32_t)(cycles >> 10));
+	return;
+};
+
+/**
+ * Read throughput of every transfer mode on the same range: sector by sector (one command
+ * and one interrupt per sector), PIO with one inw per word as the baseline for rep insw,
+ * PIO with one interrupt per sector, PIO with READ MULTIPLE blocks and bus master DMA.
+ * Modes the drive or controller lack are skipped. Modes are switched with ata_set_mode.
+ */
+void test_ata_throughput(ata_t* dev)
+{
+	if (!dev) {
+		return;
+	};
+	uint8_t* buffer = kzalloc(ATA_BENCH_SECTORS * ATA_SECTOR_SIZE);
+
+	if (!buffer) {
+		return;
+	};
+	const uint16_t bm_base = dev->bm_base;
+	const uint8_t multiple = dev->multiple;
+
+	// PIO only for the first four runs
+	ata_set_mode(dev, 0x0, 0x0, false);
+	_bench_mode(dev, "PIO sector by sector", buffer, true);
+	ata_set_mode(dev, 0x0, 0x0, true);
+	_bench_mode(dev, "PIO inw per word", buffer, false);
+	ata_set_mode(dev, 0x0, 0x0, false);
+	_bench_mode(dev, "PIO one command", buffer, false);
+
+	if (multiple) {
+		ata_set_mode(dev, 0x0, multiple, false);
+		_bench_mode(dev, "PIO READ MULTIPLE", buffer, false);
+	};
+
+	if (bm_base) {
+		ata_set_mode(dev, bm_base, multiple, false);
+		_bench_mode(dev, "DMA", buffer, false);
+	};
+	ata_set_mode(dev, bm_base, multiple, false);
+	kfree(buffer);
+	return;
 };
\ No newline at end of file
@@ -6,6 +6,9 @@
 
 #include "vfs_test.h"
 
+/* EXTERNAL API */
+extern bcache_t bcache;
+
 void test_read(const char file[])
 {
 	kprintf("\n");
@@ -96,3 +99,27 @@ void test_write(char msg[], const uint32_t bytes)
 	kprintf("[FAT16] LOG.TXT was successfully written.\n");
 	return;
 };
+
+// Opens and reads file twice, the second pass (directory lookups included) should only hit the buffer cache
+void test_bcache(const char* file)
+{
+	for (size_t pass = 1; pass <= 2; pass++) {
+		const uint32_t hits = bcache.hits;
+		const uint32_t misses = bcache.misses;
+		const int32_t fd = vfs_fopen(file, "r");
+
+		if (fd < 0) {
+			kprintf("[ERROR] Failed to Open File %s\n", file);
+			return;
+		};
+		char buffer[512] = {};
+
+		while ((int32_t)vfs_fread(buffer, sizeof(buffer), 1, fd) > 0) {
+			;
+		};
+		vfs_fclose(fd);
+		kprintf("[BCACHE] Pass %d: %d Hits, %d Misses\n", pass, bcache.hits - hits, bcache.misses - misses);
+	};
+	bcache_dump(&bcache);
+	return;
+};
\ No newline at end of file
@@ -4,9 +4,13 @@
 #include "history.h"
 #include "stdio.h"
 #include "stdlib.h"
+#include "strace.h"
 #include "string.h"
 #include "syscall.h"
+#include "taskstat.h"
+#include "time.h"
 #include "unistd.h"
+#include <sys/wait.h>
 
 typedef void (*builtin_handler_t)(const char* args);
 
@@ -19,6 +23,12 @@ static void _cat_builtin(const char* path);
 static void _heapstat_builtin(const char* args);
 static void _unknown_builtin(const char* args);
 static void _pf_builtin(const char* args);
+static void _top_builtin(const char* args);
+static void _sysbench_builtin(const char* args);
+static void _uptime_builtin(const char* args);
+static void _sysstat_builtin(const char* args);
+static void _strace_builtin(const char* args);
+static void _run_program(const char* cmd, char* args);
 
 void execute_builtin(const char* input);
 
@@ -29,11 +39,17 @@ typedef struct builtin {
 
 const static builtin_t builtins[] = {
     {"exit", _exit_builtin}, {"help", _help_builtin},	      {"echo", _echo_builtin}, {"ls", _ls_builtin}, {"history", _history_builtin},
-    {"cat", _cat_builtin},   {"heapstat", _heapstat_builtin}, {"pf", _pf_builtin},     {0x0, 0x0},
+    {"cat", _cat_builtin},   {"heapstat", _heapstat_builtin}, {"pf", _pf_builtin},     {"top", _top_builtin},    {"sysbench", _sysbench_builtin}, {"uptime", _uptime_builtin},
+    {"sysstat", _sysstat_builtin}, {"strace", _strace_builtin},
+    {0x0, 0x0},
 };
 
 #define BUILTIN_COUNT (sizeof(builtins) / sizeof(builtin_t))
 #define ICARSH_INPUT_LIMIT 4096
+#define ICARSH_MAX_ARGS 16
+#define ICARSH_BIN_DIR "A:/BIN/"
+#define ICARSH_BIN_EXT ".ELF"
+#define SYSBENCH_SHIFT 12
 
 static void _heapstat_builtin(const char* args)
 {
@@ -41,6 +57,209 @@ static void _heapstat_builtin(const char* args)
 	return;
 };
 
+static const char* _task_state_name(const uint32_t state)
+{
+	switch (state) {
+	case TASKSTAT_READY:
+		return "R";
+	case TASKSTAT_RUN:
+		return "X";
+	case TASKSTAT_BLOCK:
+		return "B";
+	case TASKSTAT_TERMINATE:
+		return "T";
+	default:
+		return "?";
+	};
+	return "?";
+};
+
+// Returns the log2 bucket below which `percent` of all wakeups completed
+static int _latency_percentile(const struct taskstat* st, const uint32_t percent)
+{
+	uint32_t total = 0;
+
+	for (int i = 0; i < TASKSTAT_LATENCY_BUCKETS; i++) {
+		total += st->latency[i];
+	};
+	if (total == 0) {
+		return -1;
+	};
+	uint32_t seen = 0;
+
+	for (int i = 0; i < TASKSTAT_LATENCY_BUCKETS; i++) {
+		seen += st->latency[i];
+
+		if (seen * 100 >= total * percent) {
+			return i + 1;
+		};
+	};
+	return TASKSTAT_LATENCY_BUCKETS;
+};
+
+// Same as _latency_percentile, for a syscall duration histogram
+static int _syscall_percentile(const struct syscallstat* st, const uint32_t percent)
+{
+	uint32_t seen = 0;
+
+	for (int i = 0; i < SYSCALL_STAT_BUCKETS; i++) {
+		seen += st->hist[i];
+
+		if (seen * 100 >= st->count * percent) {
+			return i + 1;
+		};
+	};
+	return SYSCALL_STAT_BUCKETS;
+};
+
+static void _sysstat_builtin(const char* args)
+{
+	struct syscallstat st = {};
+
+	printf("ID   NAME                  CALLS  ERRS AVG(Kc) MAX(Kc)  P50  P99\n");
+
+	for (int id = 0; syscallstat(id, &st) == 1; id++) {
+		if (st.count == 0) {
+			continue;
+		};
+		// Kilocycles via shifts, no 64-bit division without libgcc
+		const uint32_t total_kc = (uint32_t)(st.cycles >> 10);
+		printf("%-4d %-20s %6d %5d %7d %7d 2^%-2d 2^%-2d\n", (int)st.id, st.name, (int)st.count, (int)st.errors, (int)(total_kc / st.count),
+		       (int)(st.cycles_max >> 10), _syscall_percentile(&st, 50), _syscall_percentile(&st, 99));
+	};
+	return;
+};
+
+// Runs a program with STRACE_INHERIT set, then prints what it did
+static void _strace_builtin(const char* args)
+{
+	const size_t len = strlen(args);
+	char* line = malloc(len + 1);
+
+	if (!line) {
+		printf("%s\n", strerror(ENOMEM));
+		return;
+	};
+	strncpy(line, args, len);
+	line[len] = '\0';
+
+	char* cmd = strtok(line, " ");
+	char* rest = strtok(NULL, "");
+
+	if (!cmd) {
+		printf("USAGE: strace NAME [ARGS]\n");
+		free(line);
+		return;
+	};
+	// Drop whatever an earlier run left behind
+	struct strace_record recs[16];
+
+	while (strace_read(recs, 16) > 0) {
+	};
+	strace(0, STRACE_INHERIT);
+	_run_program(cmd, rest ? rest : "");
+	strace(0, 0);
+
+	struct syscallstat st = {};
+	int n = 0;
+
+	while ((n = strace_read(recs, 16)) > 0) {
+		for (int i = 0; i < n; i++) {
+			const struct strace_record* rec = &recs[i];
+			const char* name = (syscallstat(rec->syscall, &st) == 1) ? st.name : "?";
+			printf("[%d] %s(0x%x, 0x%x, 0x%x) = %d  <%d cycles>\n", (int)rec->pid, name, (int)rec->args[0], (int)rec->args[1],
+			       (int)rec->args[2], (int)rec->res, (int)rec->cycles);
+		};
+	};
+	free(line);
+	return;
+};
+
+static void _top_builtin(const char* args)
+{
+	struct taskstat st = {};
+	uint32_t total = 0;
+
+	// Cycles are scaled down by 2^16 so the percentage math stays in 32 bits (no libgcc)
+	for (int i = 0; taskstat(i, &st) == 1; i++) {
+		total += (uint32_t)(st.run_cycles >> 16);
+	};
+	const uint32_t one_percent = (total / 100) ? (total / 100) : 1;
+
+	printf("PID  TID S NAME                 CPU%%  RUN(Mc) WAIT(Mc)  VCSW IVCSW  WAKE  P50  P99\n");
+
+	for (int i = 0; taskstat(i, &st) == 1; i++) {
+		const char* name = st.name;
+
+		for (const char* c = st.name; *c; c++) {
+			if (*c == '/') {
+				name = c + 1;
+			};
+		};
+		const int p50 = _latency_percentile(&st, 50);
+		const int p99 = _latency_percentile(&st, 99);
+
+		printf("%-4d %-3d %s %-20s %4d %8d %8d %5d %5d %5d ", (int)st.pid, (int)st.tid, _task_state_name(st.state), name,
+		       (int)((uint32_t)(st.run_cycles >> 16) / one_percent), (int)(st.run_cycles >> 20), (int)(st.wait_cycles >> 20), (int)st.nvcsw,
+		       (int)st.nivcsw, (int)st.wakeups);
+
+		if (p50 < 0) {
+			printf("   -    -\n");
+		} else {
+			printf("2^%-2d 2^%-2d\n", p50, p99);
+		};
+	};
+	return;
+};
+
+static inline uint64_t _rdtsc(void)
+{
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+};
+
+// Average cycles of a null syscall (getpid), 2^SYSBENCH_SHIFT rounds keep the division a shift (no libgcc)
+static uint32_t _sysbench_round(void)
+{
+	getpid();
+	const uint64_t start = _rdtsc();
+
+	for (int i = 0; i < (1 << SYSBENCH_SHIFT); i++) {
+		getpid();
+	};
+	return (uint32_t)((_rdtsc() - start) >> SYSBENCH_SHIFT);
+};
+
+static void _sysbench_builtin(const char* args)
+{
+	syscall_use_sysenter(0);
+	const uint32_t int80 = _sysbench_round();
+	printf("int 0x80  : %d cycles/syscall\n", (int)int80);
+
+	if (!syscall_sysenter_supported()) {
+		printf("SYSENTER  : not supported by this CPU\n");
+		syscall_use_sysenter(1);
+		return;
+	};
+	syscall_use_sysenter(1);
+	const uint32_t sysenter = _sysbench_round();
+	printf("SYSENTER  : %d cycles/syscall\n", (int)sysenter);
+	return;
+};
+
+static void _uptime_builtin(const char* args)
+{
+	struct timespec ts = {};
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+		printf("%s\n", strerror(errno));
+		return;
+	};
+	printf("up %d.%03d s\n", (int)ts.tv_sec, (int)(ts.tv_nsec / 1000000));
+	return;
+};
+
 static void _exit_builtin(const char* args)
 {
 	int status = 0;
@@ -111,6 +330,12 @@ static void _help_builtin(const char* args)
 	printf("  `help`          – SHOWS THIS LIST AGAIN\n");
 	printf("  `history`       – DUMP YOUR LAST COMMANDS\n");
 	printf("  `heapstat`      – DUMP DYNAMIC MEMORY USAGE\n");
+	printf("  `top`           – CPU TIME, CONTEXT SWITCHES AND WAKEUP LATENCY (CYCLES) PER TASK\n");
+	printf("  `sysbench`      – NULL SYSCALL LATENCY, INT 0x80 VS SYSENTER\n");
+	printf("  `uptime`        – TIME SINCE BOOT (CLOCK_MONOTONIC, NO SYSCALL)\n");
+	printf("  `sysstat`       – CALLS, ERRORS AND CYCLES PER SYSCALL\n");
+	printf("  `strace NAME`   – RUNS A PROGRAM AND PRINTS EVERY SYSCALL IT MADE\n");
+	printf("  `NAME [ARGS]`   – ANYTHING ELSE RUNS A:/BIN/NAME.ELF (OR A FULL PATH) AND WAITS FOR IT\n");
 	return;
 };
 
@@ -193,7 +418,65 @@ static builtin_handler_t _find_builtin(const char* cmd)
 		if (strcmp(cmd, builtins[i].name) == 0)
 			return builtins[i].handler;
 	};
-	return _unknown_builtin;
+	return 0x0;
+};
+
+static void _run_program(const char* cmd, char* args)
+{
+	char path[128];
+	const size_t len = strlen(cmd);
+
+	if (strchr(cmd, ':')) {
+		if (len >= sizeof(path)) {
+			printf("%s\n", strerror(ENAMETOOLONG));
+			return;
+		};
+		strncpy(path, cmd, len);
+		path[len] = '\0';
+	} else {
+		// Bare names live in A:/BIN, FAT16 only knows upper case
+		const size_t dir_len = strlen(ICARSH_BIN_DIR);
+		const size_t ext_len = strlen(ICARSH_BIN_EXT);
+
+		if (dir_len + len + ext_len >= sizeof(path)) {
+			printf("%s\n", strerror(ENAMETOOLONG));
+			return;
+		};
+		strncpy(path, ICARSH_BIN_DIR, dir_len);
+
+		for (size_t i = 0; i < len; i++) {
+			const char c = cmd[i];
+			path[dir_len + i] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+		};
+		strncpy(path + dir_len + len, ICARSH_BIN_EXT, ext_len);
+		path[dir_len + len + ext_len] = '\0';
+	};
+	char* argv[ICARSH_MAX_ARGS + 1];
+	int argc = 0;
+	argv[argc++] = (char*)cmd;
+
+	for (char* arg = *args ? strtok(args, " ") : 0x0; arg && argc < ICARSH_MAX_ARGS; arg = strtok(NULL, " ")) {
+		argv[argc++] = arg;
+	};
+	argv[argc] = 0x0;
+
+	const int pid = spawn(path, argv, 0x0);
+
+	if (pid == -ENOENT) {
+		_unknown_builtin(cmd);
+		return;
+	};
+
+	if (pid < 0) {
+		printf("%s\n", strerror(-pid));
+		return;
+	};
+	int status = 0;
+
+	if (waitpid(pid, &status, 0) == pid && WEXITSTATUS(status) != 0) {
+		printf("[!] %s EXITED WITH %d\n", cmd, WEXITSTATUS(status));
+	};
+	return;
 };
 
 void execute_builtin(const char* input)
@@ -214,7 +497,7 @@ void execute_builtin(const char* input)
 	buf[len] = '\0';
 
 	const char* cmd = strtok(buf, " ");
-	const char* args = strtok(NULL, "");
+	char* args = strtok(NULL, "");
 
 	if (!args) {
 		args = "";
@@ -225,7 +508,12 @@ void execute_builtin(const char* input)
 		return;
 	};
 	const builtin_handler_t builtin = _find_builtin(cmd);
-	builtin(args);
+
+	if (builtin) {
+		builtin(args);
+	} else {
+		_run_program(cmd, args);
+	};
 	free(buf);
 	return;
 };
\ No newline at end of file
@@ -2,13 +2,18 @@ global _icarsh
 extern main       
 
 section .text
+; The kernel starts us with esp -> argc, argv[0..argc-1], 0, envp[..], 0
 _icarsh:
     xor ebp, ebp
-    xor eax, eax
-    xor ebx, ebx
+    mov eax, [esp]
+    lea ebx, [esp + 4]
+    lea ecx, [ebx + eax * 4 + 4]
+    push ecx
+    push ebx
+    push eax
     call main
 
+    mov ebx, eax
     mov eax, 0x1    
-    xor ebx, ebx
     int 0x80
     hlt
\ No newline at end of file
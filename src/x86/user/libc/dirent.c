@@ -1,11 +1,41 @@
 #include "dirent.h"
 #include "errno.h"
+#include "ring.h"
 #include "stdlib.h"
 #include "string.h"
 #include "syscall.h"
 
 extern int getdents(int fd, struct dirent* buf, unsigned int count);
 
+static int _readdir_batch(DIR* dirp);
+
+// Queues DIR_BATCH getdents on the ring and submits them at once, returns the number of entries read.
+// Only used while nobody else has entries in flight on the ring, -1 means fall back to getdents.
+static int _readdir_batch(DIR* dirp)
+{
+	struct ring* ring = ring_get();
+
+	if (!ring || ring_pending(ring)) {
+		return -1;
+	};
+
+	for (int i = 0; i < DIR_BATCH; i++) {
+		struct ring_sqe* sqe = ring_get_sqe(ring);
+		ring_prep(sqe, RING_OP_GETDENTS, dirp->fd, (int)&dirp->batch[i], sizeof(struct dirent), i);
+	};
+	ring_submit(ring);
+	int count = 0;
+	struct ring_cqe* cqe = 0x0;
+
+	while ((cqe = ring_peek_cqe(ring)) != 0x0) {
+		if (cqe->res > 0 && (int)cqe->user_data == count) {
+			count++;
+		};
+		ring_cqe_seen(ring);
+	};
+	return count;
+};
+
 DIR* opendir(const char* path)
 {
 	const int fd = open(path, 0);
@@ -23,6 +53,9 @@ DIR* opendir(const char* path)
 	};
 	dirp->fd = fd;
 	dirp->has_entry = 0;
+	dirp->batch = malloc(sizeof(struct dirent) * DIR_BATCH);
+	dirp->batch_len = 0;
+	dirp->batch_pos = 0;
 	return dirp;
 };
 
@@ -32,6 +65,20 @@ struct dirent* readdir(DIR* dirp)
 		errno = EBADF;
 		return 0x0;
 	};
+
+	if (dirp->batch && dirp->batch_pos == dirp->batch_len) {
+		const int count = _readdir_batch(dirp);
+
+		if (count >= 0) {
+			dirp->batch_len = count;
+			dirp->batch_pos = 0;
+		};
+	};
+
+	if (dirp->batch && dirp->batch_pos < dirp->batch_len) {
+		dirp->has_entry = 1;
+		return &dirp->batch[dirp->batch_pos++];
+	};
 	const int ret = getdents(dirp->fd, &dirp->current, sizeof(struct dirent));
 
 	if (ret <= 0) {
@@ -60,6 +107,9 @@ int closedir(DIR* dirp)
 	};
 	dirp->fd = -1;
 	dirp->has_entry = 0;
+	if (dirp->batch) {
+		free(dirp->batch);
+	};
 	free(dirp);
 	return 0;
 };
\ No newline at end of file
@@ -7,6 +7,8 @@
 #define DT_REG 1
 #define DT_DIR 2
 
+#define DIR_BATCH 16 // Entries fetched per kernel entry through the syscall ring
+
 struct dirent {
 	long d_ino;
 	off_t d_off;
@@ -19,6 +21,9 @@ typedef struct {
 	int fd;
 	struct dirent current;
 	int has_entry;
+	struct dirent* batch; // DIR_BATCH entries read ahead, 0x0 = one getdents per readdir
+	int batch_len;
+	int batch_pos;
 } DIR;
 
 DIR* opendir(const char* path);
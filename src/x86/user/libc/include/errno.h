@@ -15,5 +15,17 @@ extern int errno;
 #define ENOTDIR 20 // Not a directory
 #define EISDIR 21  // Is a directory
 #define EAGAIN 11  // Try again (resource temporarily unavailable)
+#define E2BIG 7	   // Argument list too long
+#define ENOEXEC 8  // Exec format error
+#define ECHILD 10  // No child processes
+#define EFAULT 14  // Bad address
+#define EBUSY 16   // Device or resource busy
+#define EEXIST 17  // File exists
+#define ENOSPC 28  // No space left on device
+#define ESPIPE 29  // Illegal seek
+#define EPIPE 32   // Broken pipe
+#define ENAMETOOLONG 36 // File name too long
+#define ENOSYS 38	// Function not implemented
+#define ECANCELED 125	// Operation Canceled
 
 #endif
\ No newline at end of file
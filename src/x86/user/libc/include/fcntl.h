@@ -1,11 +1,18 @@
 #ifndef _FCNTL_H
 #define _FCNTL_H
 
-#define O_RDONLY 0x0   // Open for reading only
-#define O_WRONLY 0x1   // Open for writing only
-#define O_RDWR 0x2     // Open for reading and writing
-#define O_CREAT 0x40   // Create file if it does not exist
-#define O_TRUNC 0x200  // Truncate size to 0
-#define O_APPEND 0x400 // Writes append to end of file
+#define O_RDONLY 0x0     // Open for reading only
+#define O_WRONLY 0x1     // Open for writing only
+#define O_RDWR 0x2       // Open for reading and writing
+#define O_CREAT 0x40     // Create file if it does not exist
+#define O_EXCL 0x80      // With O_CREAT: fail if it exists (shm_open)
+#define O_TRUNC 0x200    // Truncate size to 0
+#define O_APPEND 0x400   // Writes append to end of file
+#define O_NONBLOCK 0x800 // Reads that would block fail with EAGAIN
+
+#define F_GETFL 3 // Get the file status flags
+#define F_SETFL 4 // Set the file status flags, only O_NONBLOCK can change
+
+int fcntl(int fd, int cmd, int arg);
 
 #endif
\ No newline at end of file
@@ -11,7 +11,7 @@
 #define USER_BSS_SIZE (PAGE_SIZE)
 #define USER_BSS_END (USER_BSS_START + USER_BSS_SIZE - 1)
 
-#define USER_HEAP_START (USER_BSS_END + 1)
+#define USER_HEAP_START 0x40000000
 #define USER_HEAP_SIZE (PAGE_SIZE)
 #define USER_HEAP_END (USER_HEAP_START + USER_HEAP_SIZE - 1)
 
@@ -19,4 +19,10 @@
 #define USER_STACK_START (USER_STACK_END - USER_STACK_SIZE + 1) // 0xBFC00000
 #define USER_STACK_END 0xBFFFFFFF
 
+#define USER_RING_START (USER_STACK_START - PAGE_SIZE)
+#define USER_CLOCK_START (USER_RING_START - PAGE_SIZE) // Read-only time page, see time.c
+
+#define USER_MMAP_START (USER_HEAP_END + 1) // mmap() hands out whole pages between the heap and the time page
+#define USER_MMAP_END (USER_CLOCK_START - 1)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef IPC_H
+#define IPC_H
+
+#define IPC_MSG_WORDS 2 // A message travels in registers, both ways
+
+struct ipc_msg {
+	unsigned int w[IPC_MSG_WORDS];
+};
+
+int port_create(void);
+int port_destroy(int port);
+int ipc_send(int port, const struct ipc_msg* msg);
+int ipc_receive(int port, struct ipc_msg* msg);
+int ipc_call(int port, struct ipc_msg* msg);
+int ipc_reply(int badge, const struct ipc_msg* msg);
+int ipc_reply_receive(int badge, struct ipc_msg* msg, int port);
+
+#endif
\ No newline at end of file
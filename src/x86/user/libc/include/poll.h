@@ -0,0 +1,23 @@
+#ifndef _POLL_H
+#define _POLL_H
+
+#define POLLIN 0x001   // Data to read
+#define POLLPRI 0x002  // Urgent data to read
+#define POLLOUT 0x004  // Writing will not block
+#define POLLERR 0x008  // Error condition (revents only)
+#define POLLHUP 0x010  // Hung up (revents only)
+#define POLLNVAL 0x020 // Invalid fd (revents only)
+
+#define POLL_MAX 32 // The kernel takes at most this many entries per call
+
+typedef unsigned int nfds_t;
+
+struct pollfd {
+	int fd;
+	short events;
+	short revents;
+};
+
+int poll(struct pollfd* fds, nfds_t nfds, int timeout);
+
+#endif
\ No newline at end of file
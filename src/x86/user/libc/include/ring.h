@@ -0,0 +1,59 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+// Layout shared with the kernel (src/x86/include/ring.h)
+#define RING_SQ_ENTRIES 256
+#define RING_CQ_ENTRIES 512
+#define RING_SQE_LINK 0x1 // The next entry only runs if this one succeeded, otherwise it completes with -ECANCELED
+
+// opcode is the syscall number, arg[] are its arguments (arg[3] only for pread/pwrite)
+struct ring_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t reserved;
+	int32_t arg[4];
+	uint32_t user_data;
+};
+
+struct ring_cqe {
+	uint32_t user_data;
+	int32_t res;
+};
+
+struct ring {
+	volatile uint32_t sq_head;
+	volatile uint32_t sq_tail;
+	uint32_t sq_mask;
+	uint32_t sq_entries;
+	volatile uint32_t cq_head;
+	volatile uint32_t cq_tail;
+	uint32_t cq_mask;
+	uint32_t cq_entries;
+	uint32_t cq_overflow;
+	struct ring_sqe sqes[RING_SQ_ENTRIES];
+	struct ring_cqe cqes[RING_CQ_ENTRIES];
+};
+
+#define RING_OP_READ 3
+#define RING_OP_WRITE 4
+#define RING_OP_OPEN 5
+#define RING_OP_CLOSE 6
+#define RING_OP_GETPID 20
+#define RING_OP_GETDENTS 141
+#define RING_OP_READV 145
+#define RING_OP_WRITEV 146
+#define RING_OP_PREAD 180
+#define RING_OP_PWRITE 181
+
+struct ring* ring_get(void);
+struct ring_sqe* ring_get_sqe(struct ring* ring);
+void ring_prep(struct ring_sqe* sqe, int opcode, int arg1, int arg2, int arg3, uint32_t user_data);
+void ring_prep_at(struct ring_sqe* sqe, int opcode, int fd, void* buf, int count, int offset, uint32_t user_data);
+int ring_pending(const struct ring* ring);
+int ring_submit(struct ring* ring);
+struct ring_cqe* ring_peek_cqe(struct ring* ring);
+void ring_cqe_seen(struct ring* ring);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef STRACE_H
+#define STRACE_H
+
+#include <stdint.h>
+
+#define SYSCALL_STAT_BUCKETS 32
+#define STRACE_TRACE 0x1   // Record this process' syscalls
+#define STRACE_INHERIT 0x2 // Processes it spawns start with STRACE_TRACE
+
+// hist[i] counts calls that took [2^i, 2^(i+1)) TSC cycles
+struct syscallstat {
+	uint32_t id;
+	char name[20];
+	uint32_t count;
+	uint32_t errors;
+	uint64_t cycles;
+	uint64_t cycles_max;
+	uint32_t hist[SYSCALL_STAT_BUCKETS];
+};
+
+struct strace_record {
+	uint32_t seq;
+	uint16_t pid;
+	uint16_t syscall;
+	int32_t args[3];
+	int32_t res;
+	uint32_t cycles;
+	uint64_t tsc;
+};
+
+int syscallstat(int id, struct syscallstat* buf);
+int strace(int pid, int flags);
+int strace_read(struct strace_record* buf, int max);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef SYS_MMAN_H
+#define SYS_MMAN_H
+
+#include <sys/types.h>
+
+// Mappings are made of whole 4 MiB pages (PAGE_SIZE in icarius.h)
+#define PROT_NONE 0x0
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC 0x4
+
+#define MAP_SHARED 0x01	   // Anonymous memory or shm_open objects
+#define MAP_PRIVATE 0x02   // File pages are private copies, nothing is written back
+#define MAP_FIXED 0x10	   // addr must be page aligned, replaces existing mappings
+#define MAP_ANONYMOUS 0x20 // Zero-filled, fd and offset are ignored
+#define MAP_ANON MAP_ANONYMOUS
+
+#define MAP_FAILED ((void*)-1)
+
+// Argument block of SYS_MMAP (old_mmap)
+struct mmap_args {
+	unsigned int addr;
+	unsigned int len;
+	unsigned int prot;
+	unsigned int flags;
+	int fd;
+	unsigned int offset;
+};
+
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
+int munmap(void* addr, size_t length);
+int mprotect(void* addr, size_t length, int prot);
+
+// Names are "/name" (at most 30 characters), objects hold up to 16 MiB and read as zero until written
+int shm_open(const char* name, int oflag, int mode);
+int shm_unlink(const char* name);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef SYS_SELECT_H
+#define SYS_SELECT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define FD_SETSIZE 64 // select is built on poll, at most POLL_MAX of them may be set
+
+typedef struct {
+	uint32_t bits[FD_SETSIZE / 32];
+} fd_set;
+
+#define FD_ZERO(set) memset((set), 0, sizeof(fd_set))
+#define FD_SET(fd, set) ((set)->bits[(fd) / 32] |= (1u << ((fd) % 32)))
+#define FD_CLR(fd, set) ((set)->bits[(fd) / 32] &= ~(1u << ((fd) % 32)))
+#define FD_ISSET(fd, set) (((set)->bits[(fd) / 32] >> ((fd) % 32)) & 1u)
+
+struct timeval {
+	long tv_sec;
+	long tv_usec;
+};
+
+int select(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout);
+
+#endif
\ No newline at end of file
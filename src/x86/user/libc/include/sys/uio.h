@@ -0,0 +1,16 @@
+#ifndef SYS_UIO_H
+#define SYS_UIO_H
+
+#include <sys/types.h>
+
+#define IOV_MAX 16 // The kernel takes at most this many buffers per call
+
+struct iovec {
+	void* iov_base;
+	size_t iov_len;
+};
+
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+
+#endif
\ No newline at end of file
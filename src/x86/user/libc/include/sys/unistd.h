@@ -14,5 +14,10 @@ void exit(int status);
 int open(const char* path, int flags);
 int close(int fd);
 int getdents(int fd, struct dirent* buf, unsigned int count);
+pid_t spawn(const char* path, char* const argv[], char* const envp[]);
+pid_t getpid(void);
+ssize_t pread(int fd, void* buf, int count, off_t offset);
+ssize_t pwrite(int fd, const void* buf, int count, off_t offset);
+int pipe(int fds[2]);
 
 #endif
\ No newline at end of file
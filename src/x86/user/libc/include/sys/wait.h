@@ -0,0 +1,14 @@
+#ifndef SYS_WAIT_H
+#define SYS_WAIT_H
+
+#include <sys/types.h>
+
+#define WNOHANG 1 // Return 0 instead of blocking if no child exited yet
+
+// icariusOS hands back the plain exit(status) value
+#define WEXITSTATUS(status) (status)
+#define WIFEXITED(status) (1)
+
+pid_t waitpid(pid_t pid, int* status, int options);
+
+#endif
\ No newline at end of file
@@ -2,12 +2,31 @@
 #define SYSCALL_H
 
 #include "dirent.h"
+#include "strace.h"
+#include "taskstat.h"
+
+struct ring;
+struct iovec;
 
 int write(int fd, const void* buf, int count);
 int read(int fd, void* buf, int count);
 void exit(int status);
 int open(const char* path, int flags);
 int close(int fd);
+int waitpid(int pid, int* status, int options);
 int getdents(int fd, struct dirent* buf, unsigned int count);
+int taskstat(int index, struct taskstat* buf);
+int spawn(const char* path, char* const argv[], char* const envp[]);
+int getpid(void);
+int syscall_sysenter_supported(void);
+void syscall_use_sysenter(int enable);
+int ring_setup(struct ring** ring);
+int ring_enter(unsigned int to_submit);
+int readv(int fd, const struct iovec* iov, int iovcnt);
+int writev(int fd, const struct iovec* iov, int iovcnt);
+int pread(int fd, void* buf, int count, int offset);
+int pwrite(int fd, const void* buf, int count, int offset);
+int pipe(int fds[2]);
+int fsync(int fd);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef TASKSTAT_H
+#define TASKSTAT_H
+
+#include <stdint.h>
+
+#define TASKSTAT_LATENCY_BUCKETS 32
+
+#define TASKSTAT_READY 0
+#define TASKSTAT_RUN 1
+#define TASKSTAT_BLOCK 2
+#define TASKSTAT_TERMINATE 3
+
+struct taskstat {
+	uint32_t pid;
+	uint32_t tid;
+	uint32_t state;
+	uint32_t kernel;
+	char name[32];
+	uint64_t tsc;
+	uint64_t run_cycles;
+	uint64_t wait_cycles;
+	uint32_t nvcsw;
+	uint32_t nivcsw;
+	uint32_t wakeups;
+	uint32_t reserved;
+	uint64_t latency_max;
+	uint32_t latency[TASKSTAT_LATENCY_BUCKETS];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef TIME_H
+#define TIME_H
+
+#include <sys/types.h>
+
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+typedef int clockid_t;
+typedef long time_t;
+
+struct timespec {
+	time_t tv_sec;
+	long tv_nsec;
+};
+
+int clock_gettime(clockid_t clock_id, struct timespec* tp);
+
+#endif
\ No newline at end of file
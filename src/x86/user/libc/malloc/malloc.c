@@ -6,6 +6,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/mman.h>
 
 // Example: x = 14
 // Step 1: 14 + 7 = 21       → binary:  0001 0101 (0x15)
@@ -15,6 +16,9 @@
 #define ALIGN8(x) (((x) + 7) & ~7)
 #define IS_ALIGNED8(ptr) (((uintptr_t)(ptr) & 0x7) == 0)
 #define MIN_BLOCK_SIZE 32
+#define MMAP_THRESHOLD (1024 * 1024) // Blocks from this size on get their own mapping instead of heap space
+#define BLOCK_MAPPED 2		     // heap_block_t.free of a block from mmap, it is on neither list
+#define ARENA_MAX 32		     // Heap pages mapped once the brk heap is used up, small blocks are carved from them
 
 typedef struct heap_block {
 	size_t size;
@@ -32,6 +36,49 @@ static heap_block_t* free_list = NULL;
 static uint8_t* _heap_curr = (uint8_t*)USER_HEAP_START;
 static uint8_t* _heap_end = (uint8_t*)USER_HEAP_END;
 
+static uint8_t* _arenas[ARENA_MAX];
+static size_t _arena_count = 0;
+
+// The brk heap or one of the arenas, blocks from _map_block are in neither
+static bool _in_heap(const void* ptr)
+{
+	const uintptr_t addr = (uintptr_t)ptr;
+
+	if (addr >= USER_HEAP_START && addr <= USER_HEAP_END) {
+		return true;
+	};
+
+	for (size_t i = 0; i < _arena_count; i++) {
+		if (addr >= (uintptr_t)_arenas[i] && addr - (uintptr_t)_arenas[i] < PAGE_SIZE) {
+			return true;
+		};
+	};
+	return false;
+};
+
+// The heap list runs across arenas, only blocks that really touch may be merged
+static bool _adjacent(const heap_block_t* block, const heap_block_t* next)
+{
+	return (const uint8_t*)(block + 1) + block->size == (const uint8_t*)next;
+};
+
+// Moves _heap_curr/_heap_end to a fresh arena, the rest of the old one stays unused
+static bool _new_arena(void)
+{
+	if (_arena_count == ARENA_MAX) {
+		return false;
+	};
+	uint8_t* arena = mmap(NULL, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (arena == MAP_FAILED) {
+		return false;
+	};
+	_arenas[_arena_count++] = arena;
+	_heap_curr = arena;
+	_heap_end = arena + PAGE_SIZE - 1;
+	return true;
+};
+
 void heap_dump(void)
 {
 	heap_block_t* block = heap_head;
@@ -59,11 +106,13 @@ void heap_dump(void)
 		j++;
 	};
 	printf("\n+--[ HEAP SUMMARY ]--------------------------------------------\n");
-	const size_t heap_used = (size_t)(_heap_curr - (uint8_t*)USER_HEAP_START);
-	const size_t heap_total = (size_t)(_heap_end - (uint8_t*)USER_HEAP_START);
+	const uint8_t* heap_start = _arena_count ? _arenas[_arena_count - 1] : (uint8_t*)USER_HEAP_START;
+	const size_t heap_used = (size_t)(_heap_curr - heap_start);
+	const size_t heap_total = (size_t)(_heap_end - heap_start);
 	const float percent = ((float)heap_used / heap_total) * 100.0f;
 	printf(" Total Blocks       : %d\n", i);
 	printf(" Total Bytes        : %d\n", total_bytes);
+	printf(" Arenas             : %d / %d\n", _arena_count, ARENA_MAX);
 	printf(" Heap Capacity Used : %d / %d Bytes (%f %%)\n", heap_used, heap_total, percent);
 	printf("+--------------------------------------------------------------\n");
 	return;
@@ -111,7 +160,7 @@ static heap_block_t* _find_best_fit_free_block(const size_t aligned_size)
 	heap_block_t* best_fit_block = 0x0;
 
 	while (iter_block) {
-		if ((uintptr_t)iter_block < USER_HEAP_START || (uintptr_t)iter_block >= (uintptr_t)_heap_end) {
+		if (!_in_heap(iter_block)) {
 			break;
 		};
 		// Searching for a best fit suitable free block
@@ -134,7 +183,7 @@ static void _split_block(heap_block_t* block, const size_t aligned_size)
 	// block?
 	heap_block_t* new_block = (heap_block_t*)((uint8_t*)(block + 1) + aligned_size);
 
-	if ((uint8_t*)new_block + sizeof(heap_block_t) > _heap_end) {
+	if ((uint8_t*)new_block + sizeof(heap_block_t) > (uint8_t*)(block + 1) + block->size) {
 		return;
 	};
 	// Init new splitted block
@@ -190,14 +239,36 @@ static void _remove_from_free_list(heap_block_t* block)
 	return;
 };
 
+static void* _map_block(const size_t aligned_size)
+{
+	const size_t length = aligned_size + sizeof(heap_block_t);
+
+	if (length < aligned_size) {
+		errno = ENOMEM;
+		return NULL;
+	};
+	heap_block_t* block = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (block == MAP_FAILED) {
+		errno = ENOMEM;
+		return NULL;
+	};
+	// The rest of the last page is usable too, realloc can grow into it
+	block->size = ((length + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1)) - sizeof(heap_block_t);
+	block->free = BLOCK_MAPPED;
+	block->next = block->prev = NULL;
+	block->next_free = block->prev_free = NULL;
+	return (void*)(block + 1);
+};
+
 void* _make_new_block(const size_t aligned_size)
 {
 	const size_t new_block_size = aligned_size + sizeof(heap_block_t);
 
-	if (_heap_curr + new_block_size >= _heap_end) {
+	if (_heap_curr + new_block_size >= _heap_end && !_new_arena()) {
+		// The heap page is used up and no arena is left
 		errno = ENOMEM;
-		// TODO: Implement syscall to request more memory
-		return 0x0;
+		return NULL;
 	};
 	heap_block_t* new_block = (heap_block_t*)_heap_curr;
 	new_block->free = 0;
@@ -227,6 +298,10 @@ void* malloc(size_t size)
 		return NULL;
 	};
 	const size_t aligned_size = ALIGN8(size);
+
+	if (aligned_size >= MMAP_THRESHOLD) {
+		return _map_block(aligned_size);
+	};
 	heap_block_t* best_fit_block = _find_best_fit_free_block(aligned_size);
 
 	if (best_fit_block) {
@@ -269,7 +344,14 @@ void free(void* ptr)
 	};
 	heap_block_t* block = ((heap_block_t*)ptr) - 1;
 
-	if (block->size == 0 || (uintptr_t)block < USER_HEAP_START || (uintptr_t)block >= (uintptr_t)_heap_end) {
+	if (!_in_heap(block)) {
+		if ((uintptr_t)block >= USER_MMAP_START && (uintptr_t)block <= USER_MMAP_END && block->free == BLOCK_MAPPED) {
+			munmap(block, block->size + sizeof(heap_block_t));
+		};
+		return;
+	};
+
+	if (block->size == 0) {
 		return;
 	};
 	if (block->free) {
@@ -279,7 +361,7 @@ void free(void* ptr)
 	// ===== Right merge =====
 	heap_block_t* next_block = block->next;
 
-	if (next_block && next_block->free) {
+	if (next_block && next_block->free && _adjacent(block, next_block)) {
 		// Unlink next_block from free_list
 		if (next_block->prev_free) {
 			// Bridge over next_block (backward link)
@@ -299,12 +381,14 @@ void free(void* ptr)
 
 		if (next_block->next) {
 			next_block->next->prev = block;
+		} else {
+			heap_tail = block;
 		};
 	};
 	// ===== Left merge =====
 	heap_block_t* prev_block = block->prev;
 
-	if (prev_block && prev_block->free) {
+	if (prev_block && prev_block->free && _adjacent(prev_block, block)) {
 		// Unlink prev_block from the free list
 		if (prev_block->prev_free) {
 			// Bridge over prev_block (backward link)
@@ -324,6 +408,8 @@ void free(void* ptr)
 
 		if (block->next) {
 			block->next->prev = prev_block;
+		} else {
+			heap_tail = prev_block;
 		};
 		block = prev_block; // New final merged block, which will be inserted
 	};
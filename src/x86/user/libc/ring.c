@@ -0,0 +1,77 @@
+#include "ring.h"
+#include "errno.h"
+#include "syscall.h"
+
+static struct ring* _ring = 0x0;
+
+// The process has one ring, mapped by the kernel on first use
+struct ring* ring_get(void)
+{
+	if (_ring) {
+		return _ring;
+	};
+	struct ring* ring = 0x0;
+	const int ret = ring_setup(&ring);
+
+	if (ret < 0) {
+		errno = -ret;
+		return 0x0;
+	};
+	_ring = ring;
+	return _ring;
+};
+
+// Next free submission slot, 0x0 if the submission ring is full
+struct ring_sqe* ring_get_sqe(struct ring* ring)
+{
+	if (ring->sq_tail - ring->sq_head >= ring->sq_entries) {
+		return 0x0;
+	};
+	struct ring_sqe* sqe = &ring->sqes[ring->sq_tail & ring->sq_mask];
+	ring->sq_tail++;
+	return sqe;
+};
+
+void ring_prep(struct ring_sqe* sqe, int opcode, int arg1, int arg2, int arg3, uint32_t user_data)
+{
+	sqe->opcode = opcode;
+	sqe->flags = 0;
+	sqe->reserved = 0;
+	sqe->arg[0] = arg1;
+	sqe->arg[1] = arg2;
+	sqe->arg[2] = arg3;
+	sqe->arg[3] = 0;
+	sqe->user_data = user_data;
+};
+
+// Positional entry (RING_OP_PREAD / RING_OP_PWRITE), the file position is not touched
+void ring_prep_at(struct ring_sqe* sqe, int opcode, int fd, void* buf, int count, int offset, uint32_t user_data)
+{
+	ring_prep(sqe, opcode, fd, (int)buf, count, user_data);
+	sqe->arg[3] = offset;
+};
+
+int ring_pending(const struct ring* ring)
+{
+	return (ring->sq_tail - ring->sq_head) + (ring->cq_tail - ring->cq_head);
+};
+
+// Hands every queued entry to the kernel in one ring_enter, returns how many were consumed
+int ring_submit(struct ring* ring)
+{
+	asm volatile("" ::: "memory");
+	return ring_enter(ring->sq_tail - ring->sq_head);
+};
+
+struct ring_cqe* ring_peek_cqe(struct ring* ring)
+{
+	if (ring->cq_head == ring->cq_tail) {
+		return 0x0;
+	};
+	return &ring->cqes[ring->cq_head & ring->cq_mask];
+};
+
+void ring_cqe_seen(struct ring* ring)
+{
+	ring->cq_head++;
+};
\ No newline at end of file
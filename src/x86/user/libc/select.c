@@ -0,0 +1,93 @@
+#include <sys/select.h>
+#include "errno.h"
+#include <poll.h>
+
+// select on top of poll, every fd set in any of the sets becomes one pollfd
+int select(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout)
+{
+	struct pollfd fds[POLL_MAX];
+	nfds_t count = 0;
+
+	if (nfds < 0 || nfds > FD_SETSIZE) {
+		errno = EINVAL;
+		return -1;
+	};
+
+	for (int fd = 0; fd < nfds; fd++) {
+		short events = 0;
+
+		if (readfds && FD_ISSET(fd, readfds)) {
+			events |= POLLIN;
+		};
+
+		if (writefds && FD_ISSET(fd, writefds)) {
+			events |= POLLOUT;
+		};
+
+		if (exceptfds && FD_ISSET(fd, exceptfds)) {
+			events |= POLLPRI;
+		};
+
+		if (!events) {
+			continue;
+		};
+
+		if (count == POLL_MAX) {
+			errno = EINVAL;
+			return -1;
+		};
+		fds[count].fd = fd;
+		fds[count].events = events;
+		fds[count].revents = 0;
+		count++;
+	};
+	// Round up, a timeout below one millisecond must not turn into a busy poll
+	const int timeout_ms = timeout ? timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000 : -1;
+	const int ret = poll(fds, count, timeout_ms);
+
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	};
+
+	if (readfds) {
+		FD_ZERO(readfds);
+	};
+
+	if (writefds) {
+		FD_ZERO(writefds);
+	};
+
+	if (exceptfds) {
+		FD_ZERO(exceptfds);
+	};
+	int ready = 0;
+
+	for (nfds_t i = 0; i < count; i++) {
+		const short revents = fds[i].revents;
+		// The sets are cleared by now, events still says which ones the caller asked for
+		const short events = fds[i].events;
+
+		// POLLNVAL means select was handed a closed descriptor
+		if (revents & POLLNVAL) {
+			errno = EBADF;
+			return -1;
+		};
+
+		if ((events & POLLIN) && (revents & (POLLIN | POLLHUP | POLLERR))) {
+			FD_SET(fds[i].fd, readfds);
+			ready++;
+		};
+
+		if ((events & POLLOUT) && (revents & (POLLOUT | POLLERR))) {
+			FD_SET(fds[i].fd, writefds);
+			ready++;
+		};
+
+		if ((events & POLLPRI) && (revents & POLLPRI)) {
+			FD_SET(fds[i].fd, exceptfds);
+			ready++;
+		};
+	};
+	return ready;
+};
\ No newline at end of file
@@ -27,6 +27,30 @@ const char* strerror(int errnum)
 		return "Is a directory";
 	case EAGAIN:
 		return "Resource temporarily unavailable";
+	case E2BIG:
+		return "Argument list too long";
+	case ENOEXEC:
+		return "Exec format error";
+	case ECHILD:
+		return "No child processes";
+	case EFAULT:
+		return "Bad address";
+	case EBUSY:
+		return "Device or resource busy";
+	case EEXIST:
+		return "File exists";
+	case ENOSPC:
+		return "No space left on device";
+	case ESPIPE:
+		return "Illegal seek";
+	case EPIPE:
+		return "Broken pipe";
+	case ENAMETOOLONG:
+		return "File name too long";
+	case ENOSYS:
+		return "Function not implemented";
+	case ECANCELED:
+		return "Operation canceled";
 	default:
 		return "Unknown error";
 	};
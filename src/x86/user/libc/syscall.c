@@ -1,19 +1,146 @@
 #include "syscall.h"
+#include "errno.h"
+#include <fcntl.h>
+#include <ipc.h>
+#include <poll.h>
+#include <sys/mman.h>
 
 #define SYS_EXIT 1
 #define SYS_READ 3
 #define SYS_WRITE 4
 #define SYS_OPEN 5
 #define SYS_CLOSE 6
+#define SYS_WAITPID 7
+#define SYS_GETPID 20
+#define SYS_PIPE 42
+#define SYS_FCNTL 55
 #define SYS_GETDENTS 141
+#define SYS_READV 145
+#define SYS_WRITEV 146
+#define SYS_PREAD 180
+#define SYS_PWRITE 181
+#define SYS_POLL 168
+#define SYS_MMAP 90
+#define SYS_MUNMAP 91
+#define SYS_MPROTECT 125
+#define SYS_FSYNC 118
+#define SYS_TASKSTAT 240
+#define SYS_SPAWN 241
+#define SYS_RING_SETUP 242
+#define SYS_RING_ENTER 243
+#define SYS_SYSCALLSTAT 244
+#define SYS_STRACE 245
+#define SYS_STRACE_READ 246
+#define SYS_SHM_OPEN 247
+#define SYS_SHM_UNLINK 248
+#define SYS_PORT_CREATE 249
+#define SYS_PORT_DESTROY 250
+#define SYS_IPC_SEND 251
+#define SYS_IPC_RECEIVE 252
+#define SYS_IPC_CALL 253
+#define SYS_IPC_REPLY 254
 
-static inline int syscall(int num, int arg1, int arg2, int arg3)
+#define CPUID_FEAT_EDX_SEP (1 << 11)
+
+static int _sysenter = -1; // -1 = CPU not probed yet
+
+static int _sysenter_probe(void)
+{
+	unsigned int eax = 1, ebx, ecx, edx;
+	asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+	const unsigned int family = (eax >> 8) & 0xF;
+	const unsigned int model = (eax >> 4) & 0xF;
+	const unsigned int stepping = eax & 0xF;
+
+	// Early Pentium Pro report SEP without implementing it (the kernel does the same check)
+	if (family == 6 && model < 3 && stepping < 3) {
+		return 0;
+	};
+	return (edx & CPUID_FEAT_EDX_SEP) != 0;
+};
+
+// The 4th argument goes in EDI, ESI is taken by the SYSENTER return address
+static inline int _syscall_int80(int num, int arg1, int arg2, int arg3, int arg4)
+{
+	int ret;
+	asm volatile("int $0x80" : "=a"(ret) : "a"(num), "b"(arg1), "c"(arg2), "d"(arg3), "D"(arg4) : "memory");
+	return ret;
+};
+
+// The kernel returns with SYSEXIT to ESI (EIP) and EBP (ESP), ECX and EDX come back clobbered
+static inline int _syscall_sysenter(int num, int arg1, int arg2, int arg3, int arg4)
+{
+	int ret;
+	asm volatile("push %%ebp\n\t"
+		     "mov %%esp, %%ebp\n\t"
+		     "mov $1f, %%esi\n\t"
+		     "sysenter\n"
+		     "1:\n\t"
+		     "pop %%ebp"
+		     : "=a"(ret), "+c"(arg2), "+d"(arg3)
+		     : "a"(num), "b"(arg1), "D"(arg4)
+		     : "esi", "memory");
+	return ret;
+};
+
+// IPC messages come back in EBX/EDI, the only argument registers SYSEXIT leaves alone
+static inline int _syscall_ipc(int num, int arg1, int arg2, int arg3, int arg4, struct ipc_msg* out)
 {
 	int ret;
-	asm volatile("int $0x80" : "=a"(ret) : "a"(num), "b"(arg1), "c"(arg2), "d"(arg3));
+
+	if (_sysenter < 0) {
+		_sysenter = _sysenter_probe();
+	};
+
+	if (_sysenter) {
+		asm volatile("push %%ebp\n\t"
+			     "mov %%esp, %%ebp\n\t"
+			     "mov $1f, %%esi\n\t"
+			     "sysenter\n"
+			     "1:\n\t"
+			     "pop %%ebp"
+			     : "=a"(ret), "+b"(arg1), "+c"(arg2), "+d"(arg3), "+D"(arg4)
+			     : "a"(num)
+			     : "esi", "memory");
+	} else {
+		asm volatile("int $0x80" : "=a"(ret), "+b"(arg1), "+D"(arg4) : "a"(num), "c"(arg2), "d"(arg3) : "memory");
+	};
+
+	if (out) {
+		out->w[0] = arg1;
+		out->w[1] = arg4;
+	};
 	return ret;
 };
 
+static inline int syscall4(int num, int arg1, int arg2, int arg3, int arg4)
+{
+	if (_sysenter < 0) {
+		_sysenter = _sysenter_probe();
+	};
+
+	if (_sysenter) {
+		return _syscall_sysenter(num, arg1, arg2, arg3, arg4);
+	};
+	return _syscall_int80(num, arg1, arg2, arg3, arg4);
+};
+
+static inline int syscall(int num, int arg1, int arg2, int arg3)
+{
+	return syscall4(num, arg1, arg2, arg3, 0);
+};
+
+int syscall_sysenter_supported(void)
+{
+	return _sysenter_probe();
+};
+
+// 1 = SYSENTER (if the CPU has it), 0 = force int 0x80
+void syscall_use_sysenter(int enable)
+{
+	_sysenter = enable ? _sysenter_probe() : 0;
+};
+
 int read(int fd, void* buf, int count)
 {
 	const int ret = syscall(SYS_READ, fd, (int)buf, count);
@@ -38,6 +165,12 @@ int close(int fd)
 	return ret;
 };
 
+int waitpid(int pid, int* status, int options)
+{
+	const int ret = syscall(SYS_WAITPID, pid, (int)status, options);
+	return ret;
+};
+
 int open(const char* path, int flags)
 {
 	const int ret = syscall(SYS_OPEN, (int)path, flags, 0);
@@ -48,4 +181,204 @@ int getdents(int fd, struct dirent* buf, unsigned int count)
 {
 	const int ret = syscall(SYS_GETDENTS, fd, (int)buf, count);
 	return ret;
+};
+
+int taskstat(int index, struct taskstat* buf)
+{
+	const int ret = syscall(SYS_TASKSTAT, index, (int)buf, 0);
+	return ret;
+};
+
+int getpid(void)
+{
+	const int ret = syscall(SYS_GETPID, 0, 0, 0);
+	return ret;
+};
+
+int spawn(const char* path, char* const argv[], char* const envp[])
+{
+	const int ret = syscall(SYS_SPAWN, (int)path, (int)argv, (int)envp);
+	return ret;
+};
+
+int ring_setup(struct ring** ring)
+{
+	const int ret = syscall(SYS_RING_SETUP, (int)ring, 0, 0);
+	return ret;
+};
+
+int ring_enter(unsigned int to_submit)
+{
+	const int ret = syscall(SYS_RING_ENTER, (int)to_submit, 0, 0);
+	return ret;
+};
+
+int syscallstat(int id, struct syscallstat* buf)
+{
+	const int ret = syscall(SYS_SYSCALLSTAT, id, (int)buf, 0);
+	return ret;
+};
+
+int strace(int pid, int flags)
+{
+	const int ret = syscall(SYS_STRACE, pid, flags, 0);
+	return ret;
+};
+
+int strace_read(struct strace_record* buf, int max)
+{
+	const int ret = syscall(SYS_STRACE_READ, (int)buf, max, 0);
+	return ret;
+};
+
+int readv(int fd, const struct iovec* iov, int iovcnt)
+{
+	const int ret = syscall(SYS_READV, fd, (int)iov, iovcnt);
+	return ret;
+};
+
+int writev(int fd, const struct iovec* iov, int iovcnt)
+{
+	const int ret = syscall(SYS_WRITEV, fd, (int)iov, iovcnt);
+	return ret;
+};
+
+int pread(int fd, void* buf, int count, int offset)
+{
+	const int ret = syscall4(SYS_PREAD, fd, (int)buf, count, offset);
+	return ret;
+};
+
+int pwrite(int fd, const void* buf, int count, int offset)
+{
+	const int ret = syscall4(SYS_PWRITE, fd, (int)buf, count, offset);
+	return ret;
+};
+
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+	struct mmap_args args = {
+	    .addr = (unsigned int)addr,
+	    .len = length,
+	    .prot = prot,
+	    .flags = flags,
+	    .fd = fd,
+	    .offset = offset,
+	};
+	const int ret = syscall(SYS_MMAP, (int)&args, 0, 0);
+
+	// Addresses above 2 GiB are negative as well, only -4095..-1 is an error
+	if ((unsigned int)ret >= (unsigned int)-4095) {
+		errno = -ret;
+		return MAP_FAILED;
+	};
+	return (void*)ret;
+};
+
+int munmap(void* addr, size_t length)
+{
+	const int ret = syscall(SYS_MUNMAP, (int)addr, length, 0);
+	return ret;
+};
+
+int mprotect(void* addr, size_t length, int prot)
+{
+	const int ret = syscall(SYS_MPROTECT, (int)addr, length, prot);
+	return ret;
+};
+
+int fsync(int fd)
+{
+	const int ret = syscall(SYS_FSYNC, fd, 0, 0);
+	return ret;
+};
+
+int fcntl(int fd, int cmd, int arg)
+{
+	const int ret = syscall(SYS_FCNTL, fd, cmd, arg);
+	return ret;
+};
+
+int poll(struct pollfd* fds, nfds_t nfds, int timeout)
+{
+	const int ret = syscall(SYS_POLL, (int)fds, nfds, timeout);
+	return ret;
+};
+
+int pipe(int fds[2])
+{
+	const int ret = syscall(SYS_PIPE, (int)fds, 0, 0);
+	return ret;
+};
+
+int shm_open(const char* name, int oflag, int mode)
+{
+	(void)mode;
+	const int ret = syscall(SYS_SHM_OPEN, (int)name, oflag, 0);
+	return ret;
+};
+
+int shm_unlink(const char* name)
+{
+	const int ret = syscall(SYS_SHM_UNLINK, (int)name, 0, 0);
+	return ret;
+};
+
+int port_create(void)
+{
+	const int ret = syscall(SYS_PORT_CREATE, 0, 0, 0);
+	return ret;
+};
+
+int port_destroy(int port)
+{
+	const int ret = syscall(SYS_PORT_DESTROY, port, 0, 0);
+	return ret;
+};
+
+int ipc_send(int port, const struct ipc_msg* msg)
+{
+	const int ret = syscall(SYS_IPC_SEND, port, msg->w[0], msg->w[1]);
+	return ret;
+};
+
+// Returns the sender's badge (> 0), needed for ipc_reply
+int ipc_receive(int port, struct ipc_msg* msg)
+{
+	struct ipc_msg in = {};
+	const int ret = _syscall_ipc(SYS_IPC_RECEIVE, port, 0, 0, 0, &in);
+
+	if (ret > 0) {
+		*msg = in;
+	};
+	return ret;
+};
+
+int ipc_call(int port, struct ipc_msg* msg)
+{
+	struct ipc_msg in = {};
+	const int ret = _syscall_ipc(SYS_IPC_CALL, port, msg->w[0], msg->w[1], 0, &in);
+
+	if (ret == 0) {
+		*msg = in;
+	};
+	return ret;
+};
+
+int ipc_reply(int badge, const struct ipc_msg* msg)
+{
+	const int ret = syscall4(SYS_IPC_REPLY, badge, msg->w[0], msg->w[1], 0);
+	return ret;
+};
+
+// Server loop in one syscall per request: answers badge, then waits for the next message on port
+int ipc_reply_receive(int badge, struct ipc_msg* msg, int port)
+{
+	struct ipc_msg in = {};
+	const int ret = _syscall_ipc(SYS_IPC_REPLY, badge, msg->w[0], msg->w[1], port, &in);
+
+	if (ret > 0) {
+		*msg = in;
+	};
+	return ret;
 };
\ No newline at end of file
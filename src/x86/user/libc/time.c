@@ -0,0 +1,71 @@
+#include "time.h"
+#include "errno.h"
+#include "icarius.h"
+#include <stdint.h>
+
+// Layout of clock_page_t in the kernel (src/x86/include/clock.h), mapped read-only at USER_CLOCK_START
+struct clock_page {
+	volatile uint32_t seq;
+	uint32_t hz;
+	uint64_t ticks;
+	uint64_t tsc_tick;
+	uint32_t tsc_mult;
+	uint32_t tsc_shift;
+	uint32_t mono_sec;
+	uint32_t mono_nsec;
+	uint32_t boot_time;
+	uint32_t tick_nsec;
+};
+
+static inline uint64_t _rdtsc(void)
+{
+	uint32_t lo, hi;
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+};
+
+// No syscall: the kernel updates the page on every timer tick, the TSC fills in between ticks
+int clock_gettime(clockid_t clock_id, struct timespec* tp)
+{
+	const struct clock_page* page = (const struct clock_page*)USER_CLOCK_START;
+
+	if (!tp || (clock_id != CLOCK_MONOTONIC && clock_id != CLOCK_REALTIME)) {
+		errno = EINVAL;
+		return -1;
+	};
+	uint32_t seq, sec, nsec, offset, boot_time;
+
+	do {
+		seq = page->seq;
+		asm volatile("" ::: "memory");
+		sec = page->mono_sec;
+		nsec = page->mono_nsec;
+		boot_time = page->boot_time;
+		offset = 0;
+
+		if (page->tsc_mult) {
+			uint64_t cycles = _rdtsc() - page->tsc_tick;
+			// Keeps the multiplication in 64 bit, the result is clamped to the tick below anyway
+			if (cycles >> 32) {
+				cycles = 0xFFFFFFFF;
+			};
+			offset = (uint32_t)((cycles * page->tsc_mult) >> page->tsc_shift);
+
+			// A late IRQ0 or a calibration that ran high must not get ahead of the next tick
+			if (offset >= page->tick_nsec) {
+				offset = page->tick_nsec - 1;
+			};
+		};
+		asm volatile("" ::: "memory");
+	} while ((seq & 1) || seq != page->seq);
+
+	nsec += offset;
+
+	while (nsec >= 1000000000) {
+		nsec -= 1000000000;
+		sec++;
+	};
+	tp->tv_sec = sec + (clock_id == CLOCK_REALTIME ? boot_time : 0);
+	tp->tv_nsec = nsec;
+	return 0;
+};
\ No newline at end of file